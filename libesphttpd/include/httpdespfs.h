@@ -1,9 +1,9 @@
-#ifndef HTTPDESPFS_H
-#define HTTPDESPFS_H
-
-#include "httpd.h"
-
-int cgiEspFsHook(HttpdConnData *connData);
-int ICACHE_FLASH_ATTR cgiEspFsTemplate(HttpdConnData *connData);
-
+#ifndef HTTPDESPFS_H
+#define HTTPDESPFS_H
+
+#include "httpd.h"
+
+int cgiEspFsHook(HttpdConnData *connData);
+int ICACHE_FLASH_ATTR cgiEspFsTemplate(HttpdConnData *connData);
+
 #endif
\ No newline at end of file
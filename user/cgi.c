@@ -1,76 +1,172 @@
-/*
-Some random cgi routines. Used in the LED example and the page that returns the entire
-flash as a binary. Also handles the hit counter on the main page.
-*/
-
-/*
- * ----------------------------------------------------------------------------
- * "THE BEER-WARE LICENSE" (Revision 42):
- * Jeroen Domburg <jeroen@spritesmods.com> wrote this file. As long as you retain 
- * this notice you can do whatever you want with this stuff. If we meet some day, 
- * and you think this stuff is worth it, you can buy me a beer in return. 
- * ----------------------------------------------------------------------------
- */
-
-
-#include <esp8266.h>
-#include "cgi.h"
-#include "io.h"
-
-
-//cause I can't be bothered to write an ioGetLed()
-static char currLedState=0;
-
-//Cgi that turns the LED on or off according to the 'led' param in the POST data
-int ICACHE_FLASH_ATTR cgiLed(HttpdConnData *connData) {
-	int len;
-	char buff[1024];
-	
-	if (connData->conn==NULL) {
-		//Connection aborted. Clean up.
-		return HTTPD_CGI_DONE;
-	}
-
-	len=httpdFindArg(connData->post->buff, "led", buff, sizeof(buff));
-	if (len!=0) {
-		currLedState=atoi(buff);
-		ioLed(currLedState);
-	}
-
-	httpdRedirect(connData, "led.tpl");
-	return HTTPD_CGI_DONE;
-}
-
-
-
-//Template code for the led page.
-int ICACHE_FLASH_ATTR tplLed(HttpdConnData *connData, char *token, void **arg) {
-	char buff[128];
-	if (token==NULL) return HTTPD_CGI_DONE;
-
-	os_strcpy(buff, "Unknown");
-	if (os_strcmp(token, "ledstate")==0) {
-		if (currLedState) {
-			os_strcpy(buff, "on");
-		} else {
-			os_strcpy(buff, "off");
-		}
-	}
-	httpdSend(connData, buff, -1);
-	return HTTPD_CGI_DONE;
-}
-
-static long hitCounter=0;
-
-//Template code for the counter on the index page.
-int ICACHE_FLASH_ATTR tplCounter(HttpdConnData *connData, char *token, void **arg) {
-	char buff[128];
-	if (token==NULL) return HTTPD_CGI_DONE;
-
-	if (os_strcmp(token, "counter")==0) {
-		hitCounter++;
-		os_sprintf(buff, "%ld", hitCounter);
-	}
-	httpdSend(connData, buff, -1);
-	return HTTPD_CGI_DONE;
-}
+/*
+Some random cgi routines. Used in the LED example and the page that returns the entire
+flash as a binary. Also handles the hit counter on the main page.
+*/
+
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * Jeroen Domburg <jeroen@spritesmods.com> wrote this file. As long as you retain 
+ * this notice you can do whatever you want with this stuff. If we meet some day, 
+ * and you think this stuff is worth it, you can buy me a beer in return. 
+ * ----------------------------------------------------------------------------
+ */
+
+
+#include <esp8266.h>
+#include "cgi.h"
+#include "io.h"
+#include "config.h"
+#include "enc28j60.h"
+#include "spi.h"
+#include "stack.h"
+
+
+//cause I can't be bothered to write an ioGetLed()
+static char currLedState=0;
+
+//Cgi that turns the LED on or off according to the 'led' param in the POST data
+int ICACHE_FLASH_ATTR cgiLed(HttpdConnData *connData) {
+	int len;
+	char buff[1024];
+	
+	if (connData->conn==NULL) {
+		//Connection aborted. Clean up.
+		return HTTPD_CGI_DONE;
+	}
+
+	len=httpdFindArg(connData->post->buff, "led", buff, sizeof(buff));
+	if (len!=0) {
+		currLedState=atoi(buff);
+		ioLed(currLedState);
+	}
+
+	httpdRedirect(connData, "led.tpl");
+	return HTTPD_CGI_DONE;
+}
+
+
+
+//Template code for the led page.
+int ICACHE_FLASH_ATTR tplLed(HttpdConnData *connData, char *token, void **arg) {
+	char buff[128];
+	if (token==NULL) return HTTPD_CGI_DONE;
+
+	os_strcpy(buff, "Unknown");
+	if (os_strcmp(token, "ledstate")==0) {
+		if (currLedState) {
+			os_strcpy(buff, "on");
+		} else {
+			os_strcpy(buff, "off");
+		}
+	}
+	httpdSend(connData, buff, -1);
+	return HTTPD_CGI_DONE;
+}
+
+static long hitCounter=0;
+
+//Template code for the counter on the index page.
+int ICACHE_FLASH_ATTR tplCounter(HttpdConnData *connData, char *token, void **arg) {
+	char buff[128];
+	if (token==NULL) return HTTPD_CGI_DONE;
+
+	if (os_strcmp(token, "counter")==0) {
+		hitCounter++;
+		os_sprintf(buff, "%ld", hitCounter);
+	}
+	httpdSend(connData, buff, -1);
+	return HTTPD_CGI_DONE;
+}
+
+//Cgi that shows the ENC duplex, buffer split and flow control, and changes
+//them according to the 'duplex' (0 auto, 1 half, 2 full), 'txslots' and 'flow'
+//GET params. New settings are saved and applied once the response is out, the
+//response still shows the old ones. Frames in the ENC at the time are lost. 'spi=0' has the SPI clock calibrated again on the next
+//full init
+int ICACHE_FLASH_ATTR cgiEncSetup(HttpdConnData *connData) {
+	char buff[128];
+	int changed=0;
+
+	if (connData->conn==NULL) {
+		//Connection aborted. Clean up.
+		return HTTPD_CGI_DONE;
+	}
+
+	if (httpdFindArg(connData->getArgs, "duplex", buff, sizeof(buff))>0) {
+		sysCfg.enc_duplex=atoi(buff);
+		changed=1;
+	}
+	if (httpdFindArg(connData->getArgs, "txslots", buff, sizeof(buff))>0) {
+		sysCfg.enc_tx_slots=atoi(buff);
+		changed=1;
+	}
+	if (httpdFindArg(connData->getArgs, "flow", buff, sizeof(buff))>0) {
+		sysCfg.enc_flow=atoi(buff);
+		changed=1;
+	}
+	if (httpdFindArg(connData->getArgs, "spi", buff, sizeof(buff))>0 && atoi(buff)==0) {
+		sysCfg.enc_spi_prediv=0;
+		changed=1;
+	}
+	if (changed) {
+		CFG_Save();
+		stack_encConfigure();
+	}
+
+	httpdStartResponse(connData, 200);
+	httpdHeader(connData, "Content-Type", "text/json");
+	httpdEndHeaders(connData);
+	os_sprintf(buff, "{\n \"duplex\": \"%s\",\n \"rxsize\": %d,\n \"txslots\": %d,\n \"flow\": %d,\n \"flowengaged\": %d,\n \"spi_khz\": %d\n}\n",
+			enc_dev[0].full_duplex?"full":"half", ENC_RX_BUFFER_SIZE, (ENC_SRAM_END+1-ENC_RX_BUFFER_SIZE)/ENC_TX_SLOT_SIZE,
+			(sysCfg.enc_flow>1)?ENC_FLOW:sysCfg.enc_flow, (int)enc_dev[0].flow.engaged,
+			(sysCfg.enc_spi_prediv>=ENC_SPI_PREDIV_MIN && sysCfg.enc_spi_prediv<=SPI_CLK_PREDIV)
+			?80000/(sysCfg.enc_spi_prediv*SPI_CLK_CNTDIV):0);
+	httpdSend(connData, buff, -1);
+	return HTTPD_CGI_DONE;
+}
+
+//Cgi for the wired self test. With 'len' and/or 'frames' GET params it starts
+//a run (frames of len bytes through each ENC in loopback), without it shows
+//the results of the last one. Per frame times are in us
+int ICACHE_FLASH_ATTR cgiEncSelfTest(HttpdConnData *connData) {
+	STACK_SELFTEST *st=&stack_selftest;
+	char buff[384];
+	char devok[8*ENC_DEVICES];
+	int len=1000, frames=200, start=0;
+	u32 n, spi;
+	int i;
+
+	if (connData->conn==NULL) {
+		//Connection aborted. Clean up.
+		return HTTPD_CGI_DONE;
+	}
+
+	if (httpdFindArg(connData->getArgs, "len", buff, sizeof(buff))>0) {
+		len=atoi(buff);
+		start=1;
+	}
+	if (httpdFindArg(connData->getArgs, "frames", buff, sizeof(buff))>0) {
+		frames=atoi(buff);
+		start=1;
+	}
+	if (start) stack_selfTestStart(len, frames);
+
+	n=st->frames?st->frames:1;
+	spi=st->spi_tx_us+st->spi_rx_us;
+	devok[0]=0;
+	for (i=0; i<ENC_DEVICES; i++) os_sprintf(devok+os_strlen(devok), i?", %d":"%d", st->dev_ok[i]);
+	httpdStartResponse(connData, 200);
+	httpdHeader(connData, "Content-Type", "text/json");
+	httpdEndHeaders(connData);
+	os_sprintf(buff, "{\n \"running\": %d,\n \"len\": %d,\n \"frames\": %d,\n \"ok\": %d,\n \"bad\": %d,\n \"dev_ok\": [%s],\n"
+			" \"frames_s\": %d,\n \"spi_kbytes_s\": %d,\n \"spi_tx\": %d,\n \"spi_rx\": %d,\n"
+			" \"wire\": %d,\n \"checksum\": %d,\n \"stack\": %d\n}\n",
+			(start||st->running)?1:0, st->frame_len, st->frames, st->frames_ok, st->frames_bad, devok,
+			st->total_us?(int)((u32)st->frames_ok*1000000/st->total_us):0,
+			spi?(int)((u32)st->frames*st->frame_len*2*1000/spi):0,
+			(int)(st->spi_tx_us/n), (int)(st->spi_rx_us/n), (int)(st->wire_us/n),
+			(int)(st->checksum_us/n), (int)(st->stack_us/n));
+	httpdSend(connData, buff, -1);
+	return HTTPD_CGI_DONE;
+}
@@ -1,10 +1,12 @@
-#ifndef CGI_H
-#define CGI_H
-
-#include "httpd.h"
-
-int cgiLed(HttpdConnData *connData);
-int tplLed(HttpdConnData *connData, char *token, void **arg);
-int tplCounter(HttpdConnData *connData, char *token, void **arg);
-
+#ifndef CGI_H
+#define CGI_H
+
+#include "httpd.h"
+
+int cgiLed(HttpdConnData *connData);
+int tplLed(HttpdConnData *connData, char *token, void **arg);
+int tplCounter(HttpdConnData *connData, char *token, void **arg);
+int cgiEncSetup(HttpdConnData *connData);
+int cgiEncSelfTest(HttpdConnData *connData);
+
 #endif
\ No newline at end of file
@@ -1,651 +1,1106 @@
-/*
------------------------------------------------------------------------------------------
-Author:         Mark F (Cicero-MF) mark@cdelec.co.za
-Remarks:        
-Version:        15.05.2016
-Description:    Ethernet device driver for the enc28j60 and an esp8266
-
-  This code was modified for use with the ESP8266, based off a version by Harald Freudenberger 
-  (haraldfreude@arcor.de) - 2009/03/16
-  The base of this code was an enc28j60 device driver by Simon Schulz (avr@auctionant.de)
-  and modifications done by eProfi (2007/08/19).
-
------------------------------------------------------------------------------------------
-License:
-  This program is free software; you can redistribute it and/or modify it under
-  the terms of the GNU General Public License as published by the Free Software
-  Foundation; either version 2 of the License, or (at your option) any later
-  version.
-  This program is distributed in the hope that it will be useful, but
-
-  WITHOUT ANY WARRANTY;
-
-  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
-  PURPOSE. See the GNU General Public License for more details.
-
-  You should have received a copy of the GNU General Public License along with
-  this program; if not, write to the Free Software Foundation, Inc., 51
-  Franklin St, Fifth Floor, Boston, MA 02110, USA
-
-  http://www.gnu.de/gpl-ger.html
------------------------------------------------------------------------------------------*/
-
-#include "esp8266.h"
-#include "globals.h"
-#include "spi.h"
-#include "enc28j60.h"
-#include "gpio.h"
-#include "io.h"
-
-//-----------------------------------------------------------------------------
-
-u8 mymac[6];
-u8 enc_revid = 0;
-
-//-----------------------------------------------------------------------------
-
-static volatile u8 enc_cur_bank           = 0;
-static volatile u16  enc_next_packet_ptr  = 0;
-
-static const u8 enc_configdata[] = {
-
-	// enc registers
-
-	// tx buffer
-	ENC_REG_ETXSTL, LO8(ENC_TX_BUFFER_START),
-	ENC_REG_ETXSTH, HI8(ENC_TX_BUFFER_START),
-	ENC_REG_ETXNDL, LO8(ENC_TX_BUFFER_END),
-	ENC_REG_ETXNDH, HI8(ENC_TX_BUFFER_END),
-
-	// rx buffer
-	ENC_REG_ERXSTL, LO8(ENC_RX_BUFFER_START),
-	ENC_REG_ERXSTH, HI8(ENC_RX_BUFFER_START),
-	ENC_REG_ERXNDL, LO8(ENC_RX_BUFFER_END),
-	ENC_REG_ERXNDH, HI8(ENC_RX_BUFFER_END),
-
-	// push mac out of reset
-	ENC_REG_MACON2, 0x00,
-
-	// mac receive enable, rx and tx pause control frames enable
-	ENC_REG_MACON1, (1<<ENC_BIT_MARXEN) | (1<<ENC_BIT_RXPAUS) | (1<<ENC_BIT_TXPAUS),
-
-	#ifdef FULL_DUPLEX
-	// mac auto padding of small packets, add crc, frame length check, full duplex
-	ENC_REG_MACON3, (1<<ENC_BIT_PADCFG0) | (1<<ENC_BIT_TXCRCEN)
-			 | (1<<ENC_BIT_FRMLNEN) | (1<<ENC_BIT_FULDPX),
-	#else
-	// mac auto padding of small packets, add crc, frame length check, half duplex
-	ENC_REG_MACON3, (1<<ENC_BIT_PADCFG0) | (1<<ENC_BIT_TXCRCEN)
-			 | (1<<ENC_BIT_FRMLNEN),
-	#endif
-
-	// max framelength 1518
-	ENC_REG_MAMXFLL, LO8(1518),
-	ENC_REG_MAMXFLH, HI8(1518),
-
-	#ifdef FULL_DUPLEX
-	// back-to-back inter packet gap delay time (0x15 for full duplex)
-	ENC_REG_MABBIPG, 0x15,
-	#else
-	// back-to-back inter packet gap delay time (0x12 for half duplex)
-	ENC_REG_MABBIPG, 0x12,
-	#endif
-
-	// non back-to-back inter packet gap delay time (should be 0x12)
-	ENC_REG_MAIPGL, 0x12,
-  
-  // enable promiscuous mode
-  //ENC_REG_ERXFCON, 0x00,
-
-	#ifndef FULL_DUPLEX
-	// non back-to-back inter packet gap delay time high (should be 0x0C for half duplex)
-	ENC_REG_MAIPGH, 0x0C,
-	#endif
-  
-  // disable CLKOUT pin
-	ENC_REG_ECOCON, 0x00,
-
-	// our mac address
-	ENC_REG_MAADR5, MYMAC1,
-	ENC_REG_MAADR4, MYMAC2,
-	ENC_REG_MAADR3, MYMAC3,
-	ENC_REG_MAADR2, MYMAC4,
-	ENC_REG_MAADR1, MYMAC5,
-	ENC_REG_MAADR0, MYMAC6,
-
-  0xFF, 0xFF,
-  
-	// now the phy registers (with 2 bytes data each)
-
-	#ifdef FULL_DUPLEX
-	// set the PDPXMD full duplex mode bit on the phy
-	#define ENC_REG_PHCON1_VALUE (0x0000 | (1 << ENC_BIT_PDPXMD))
-	ENC_REG_PHCON1, HI8(ENC_REG_PHCON1_VALUE), LO8(ENC_REG_PHCON1_VALUE),
-	#endif
-
-	#ifndef FULL_DUPLEX
-	// in half duplex do not loop back transmitted data
-	#define ENC_REG_PHCON2_VALUE (0x0000 | (1 << ENC_BIT_HDLDIS))
-	ENC_REG_PHCON2, HI8(ENC_REG_PHCON2_VALUE), LO8(ENC_REG_PHCON2_VALUE),
-	#endif
-
-	// leds: leda (yellow) rx and tx activity, stretch to 40ms
-	//       ledb (green)  link status
-	#define ENC_REG_PHCON_VALUE (0x0000 | (1 << ENC_BIT_STRCH) \
-			     | (7 << ENC_BIT_LACFG0)               \
-			     | (4 << ENC_BIT_LBCFG0))
-	ENC_REG_PHLCON, HI8(ENC_REG_PHCON_VALUE), LO8(ENC_REG_PHCON_VALUE),
-
-	// end of config data marker
-	0xFF, 0xFF
-};
-
-u16 ICACHE_FLASH_ATTR enc_linkup (void) {
-  u16 u;
-  u = enc_read_phyreg(ENC_REG_PHSTAT2);  //ENC_DEBUG("PHSTAT2 %4x\n", u);  
-  if (u & ETHERNET_LINK_UP) {
-    return ETHERNET_LINK_UP;
-  } else {
-    return 0;
-  }
-}
-
-
-
-//-----------------------------------------------------------------------------
-
-static void ICACHE_FLASH_ATTR usdelay( u16 us )
-{
-  os_delay_us(us);
-}
-
-static inline void spi_put( u8 value )
-{
-	//ENC_DEBUG("spi_put(%2x)\n", (unsigned) value );  
-  spi_tx8(SPI_USED, value);
-}
-
-static inline u8 spi_get(void)
-{
-  return (u8)spi_rx8(SPI_USED);
-}
-
-//-----------------------------------------------------------------------------
-static inline void enc_reset(void)
-{
-	enc_select();
-	spi_put( ENC_SPI_OP_SC );
-	enc_deselect();
-
-	// errata #2: wait for at least 300 us
-	usdelay( 1000 );
-}
-
-static void ICACHE_FLASH_ATTR enc_clrbits_reg( u8 reg, u8 bits )
-{
-	// no automatic bank switching in this function !!!
-
-	u8 addr = reg & ENC_REG_ADDR_MASK;
-
-	enc_select();
-  spi_transaction(SPI_USED, 8, (ENC_SPI_OP_BFC | addr), 0, 0, 8, bits, 0, 0);
-	enc_deselect();
-}
-
-static void ICACHE_FLASH_ATTR enc_setbits_reg( u8 reg, u8 bits )
-{
-	// no automatic bank switching in this function !!!
-
-	u8 addr = reg & ENC_REG_ADDR_MASK;
-
-	enc_select();
-  spi_transaction(SPI_USED, 8, (ENC_SPI_OP_BFS | addr), 0, 0, 8, bits, 0, 0);
-	enc_deselect();
-}
-
-static u8 ICACHE_FLASH_ATTR enc_read_reg( u8 reg )
-{
-	u8 value;
-	u8 addr = reg & ENC_REG_ADDR_MASK;
-
-	if( addr < 0x1A ) {
-		u8 bank = (reg & ENC_REG_BANK_MASK) >> ENC_REG_BANK_SHIFT;
-		if( bank != enc_cur_bank ) {
-			// need to switch bank first
-			enc_clrbits_reg( ENC_REG_ECON1, 0x03 << ENC_BIT_BSEL0 );
-			if( bank ) {
-				enc_setbits_reg( ENC_REG_ECON1, bank << ENC_BIT_BSEL0 );
-			}
-			enc_cur_bank = bank;
-		}
-	}
-
-	enc_select();
-  if( reg & ENC_REG_WAIT_MASK ) {
-    value = spi_transaction(SPI_USED, 8, (ENC_SPI_OP_RCR | addr), 0, 0, 8, 0, 8, 0);  
-  } else {
-    value = spi_transaction(SPI_USED, 8, (ENC_SPI_OP_RCR | addr), 0, 0, 0, 0, 8, 0);
-  }
-  
-	enc_deselect();
-
-	return value;
-}
-
-static void ICACHE_FLASH_ATTR enc_write_reg( u8 reg, u8 value )
-{
-	u8 addr = reg & ENC_REG_ADDR_MASK;
-
-	if( addr < 0x1A ) {
-		u8 bank = (reg & ENC_REG_BANK_MASK) >> ENC_REG_BANK_SHIFT;
-		if( bank != enc_cur_bank ) {
-			// need to switch bank first
-			enc_clrbits_reg( ENC_REG_ECON1, 0x03 << ENC_BIT_BSEL0 );
-			if( bank ) {
-				enc_setbits_reg( ENC_REG_ECON1, bank << ENC_BIT_BSEL0 );
-			}
-			enc_cur_bank = bank;
-		}
-	}
-  enc_select();
-  spi_transaction(SPI_USED, 8, (ENC_SPI_OP_WCR | addr), 0, 0, 8, value, 0, 0);
-	enc_deselect();
-}
-
-#if 1
-u16 ICACHE_FLASH_ATTR enc_read_phyreg( u8 phyreg )
-{
-	u16 value;
-
-	enc_write_reg( ENC_REG_MIREGADR, phyreg );
-	enc_write_reg( ENC_REG_MICMD, (1<<ENC_BIT_MIIRD) );
-	usdelay(10);
-	
-  while( enc_read_reg( ENC_REG_MISTAT ) & (1<<ENC_BIT_BUSY) ) ;
-	enc_write_reg( ENC_REG_MICMD, 0x00 );
-	value = (((u16) enc_read_reg( ENC_REG_MIRDH )) << 8);
-	value |= ((u16) enc_read_reg( ENC_REG_MIRDL ));
-
-	return value;
-}
-#endif
-
-static void ICACHE_FLASH_ATTR enc_write_phyreg( u8 phyreg, u16 value )
-{
-  u8 rec;
-	enc_write_reg( ENC_REG_MIREGADR, phyreg );
-	enc_write_reg( ENC_REG_MIWRL, LO8(value) );
-	enc_write_reg( ENC_REG_MIWRH, HI8(value) );
-	usdelay(10);	
-  
-  rec = enc_read_reg( ENC_REG_MISTAT );
-	while( rec & (1<<ENC_BIT_BUSY) ) {
-    rec = enc_read_reg( ENC_REG_MISTAT );   
-    ENC_DEBUG("phy: ENC_REG_MISTAT=%2x\n", rec);
-  }
-}
-
-static void ICACHE_FLASH_ATTR enc_read_buf( u8 *buf, u16 len )
-{
-	//ENC_DEBUG("enc_read_buf: %u bytes\n", len);
-  enc_select();
-	
-	for(; len > 0; len--, buf++ ) {
-		*buf = spi_transaction(SPI_USED, 8, (ENC_SPI_OP_RBM), 0, 0, 0, 0, 8, 0);
-	}
-	enc_deselect();
-}
-
-static void ICACHE_FLASH_ATTR enc_write_buf( u8 *buf, u16 len )
-{
-	enc_select();
-  ENC_DEBUG("enc_wbuf:%u\n", len);
-  spi_transaction(SPI_USED, 8, (ENC_SPI_OP_WBM), 0, 0, 8, 0, 0, 0);
-	for(; len > 0; len--, buf++ ) {
-    spi_transaction(SPI_USED, 8, (ENC_SPI_OP_WBM), 0, 0, 8, *buf, 0, 0);
-	}
-	enc_deselect();
-}
-
-//-----------------------------------------------------------------------------
-
-void ICACHE_FLASH_ATTR enc_send_packet( u16 len, u8 *buf )
-{
-	u16 ms = 100;
-
-	//ENC_DEBUG("enc_send: %u bytes\n", len);
-
-	// wait up to 100 ms for the previos tx to finish
-	while( ms-- ) {
-		if( !(enc_read_reg( ENC_REG_ECON1 ) & (1<<ENC_BIT_TXRTS)) ) break;
-		usdelay( 1000 );
-	}
-
-	#ifdef FULL_DUPLEX
-	// reset tx logic if TXRTS bit is still on
-	if( enc_read_reg( ENC_REG_ECON1 ) & (1<<ENC_BIT_TXRTS) ) {
-	#else
-	// errata #12: reset tx logic
-	if( 1 ) {
-	#endif
-		//ENC_DEBUG("enc_send: reset tx logic\n");
-		enc_setbits_reg( ENC_REG_ECON1, (1<<ENC_BIT_TXRST) );
-		enc_clrbits_reg( ENC_REG_ECON1, (1<<ENC_BIT_TXRST) );
-	}
-
-	// setup write pointer
-	enc_write_reg( ENC_REG_EWRPTL, LO8(ENC_TX_BUFFER_START) );
-	enc_write_reg( ENC_REG_EWRPTH, HI8(ENC_TX_BUFFER_START) );
-
-	// end pointer (points to last byte) to start + len
-	enc_write_reg( ENC_REG_ETXNDL, LO8(ENC_TX_BUFFER_START+len) );
-	enc_write_reg( ENC_REG_ETXNDH, HI8(ENC_TX_BUFFER_START+len) );
-
-	// copy packet to enc buffer
-	enc_write_buf( buf, len );
-
-	// clear TXIF flag
-	enc_clrbits_reg( ENC_REG_EIR, (1<<ENC_BIT_TXIF) );
-
-	// start transmission by setting the TXRTS bit
-	enc_setbits_reg( ENC_REG_ECON1, (1<<ENC_BIT_TXRTS) );
-}
-
-u16 ICACHE_FLASH_ATTR enc_receive_packet( u16 bufsize, u8 *buf )
-{
-	u8 rxheader[6];
-	u16 len, status;
-	u8 u;
-
-	// check rx packet counter
-	u = enc_read_reg( ENC_REG_EPKTCNT );
-	//ENC_DEBUG("enc_receive: EPKTCNT=%u\n", (int) u);
-	if( u == 0 ) {
-		// packetcounter is 0, there is nothing to receive, go back
-		return 0;
-	}
-
-	//set read pointer to next packet
-	enc_write_reg( ENC_REG_ERDPTL, LO8(enc_next_packet_ptr) );
-	enc_write_reg( ENC_REG_ERDPTH, HI8(enc_next_packet_ptr) );
-
-	// read enc rx packet header
-	enc_read_buf( rxheader, sizeof(rxheader) );
-	enc_next_packet_ptr  =             rxheader[0];
-	enc_next_packet_ptr |= (rxheader[1] << 8);
-	len                  =             rxheader[2];
-	len                 |= (rxheader[3] << 8);
-	status               =             rxheader[4];
-	status              |= (rxheader[5] << 8);
-
-	// added by Sjors: reset the ENC when needed
-	// If the receive OK bit is not 1 or the zero bit is not zero, or the packet is larger then the buffer, reset the enc chip and SPI
-	if ((!(status & (1<<7))) || (status & 0x8000))
-	{ 
-    ENC_DEBUG("resetting enc @ enc_receive_packet\r\n");
-		enc_init();
-	}
-	//ENC_DEBUG("enc_receive: status=%4x, %2x,%2x,%2x,%2x,%2x,%2x,\n", status, rxheader[0],rxheader[1],rxheader[2],rxheader[3],rxheader[4],rxheader[5]);
-
-	// skip the checksum (4 bytes) at the end of the buffer
-	len -= 4;
-
-	// if the application buffer is to small, we just truncate
-	if( len > bufsize ) len = bufsize;
-
-	// now read the packet data into buffer
-	enc_read_buf( buf, len );
-
-	// adjust the ERXRDPT pointer (= free this packet in rx buffer)
-	if(    enc_next_packet_ptr-1 > ENC_RX_BUFFER_END
-	    || enc_next_packet_ptr-1 < ENC_RX_BUFFER_START ) {
-		enc_write_reg( ENC_REG_ERXRDPTL, LO8(ENC_RX_BUFFER_END) );
-		enc_write_reg( ENC_REG_ERXRDPTH, HI8(ENC_RX_BUFFER_END) );
-	} else {
-		enc_write_reg( ENC_REG_ERXRDPTL, LO8(enc_next_packet_ptr-1) );
-		enc_write_reg( ENC_REG_ERXRDPTH, HI8(enc_next_packet_ptr-1) );
-	}
-
-	// trigger a decrement of the rx packet counter
-	// this will clear PKTIF if EPKTCNT reaches 0
-	enc_setbits_reg( ENC_REG_ECON2, (1<<ENC_BIT_PKTDEC) );
-
-	// return number of bytes written to the buffer
-	//ENC_DEBUG("enc_receive: %u bytes\n", len);
-	return len;
-}
-
-
-
-//-----------------------------------------------------------------------------
-
-#if 0
-static void ICACHE_FLASH_ATTR enc_regdump(void)
-{
-	u8 v;
-	u16  u;
-
-	v = enc_read_reg(ENC_REG_EIE);         ENC_DEBUG("EIE %2x\n", (unsigned)v);
-	v = enc_read_reg(ENC_REG_EIR);         ENC_DEBUG("EIR %2x\n", (unsigned)v);
-	v = enc_read_reg(ENC_REG_ESTAT);       ENC_DEBUG("ESTAT %2x\n", (unsigned)v);
-	v = enc_read_reg(ENC_REG_ECON2);       ENC_DEBUG("ECON2 %2x\n", (unsigned)v);
-	v = enc_read_reg(ENC_REG_ECON1);       ENC_DEBUG("ECON1 %2x\n", (unsigned)v);
-
-	v = enc_read_reg(ENC_REG_ERDPTH);      u = (((unsigned)(v & 0x1F)) << 8);
-	u |= enc_read_reg(ENC_REG_ERDPTL);     ENC_DEBUG("ERDPT %4x\n", u);
-	v = enc_read_reg(ENC_REG_EWRPTH);      u = (((unsigned)(v & 0x1F)) << 8);
-	u |= enc_read_reg(ENC_REG_EWRPTL);     ENC_DEBUG("EWRPT %4x\n", u);
-	v = enc_read_reg(ENC_REG_ETXSTH);      u = (((unsigned)(v & 0x1F)) << 8);
-	u |= enc_read_reg(ENC_REG_ETXSTL);     ENC_DEBUG("ETXST %4x\n", u);
-	v = enc_read_reg(ENC_REG_ETXNDH);      u = (((unsigned)(v & 0x1F)) << 8);
-	u |= enc_read_reg(ENC_REG_ETXNDL);     ENC_DEBUG("ETXND %4x\n", u);
-	v = enc_read_reg(ENC_REG_ERXSTH);      u = (((unsigned)(v & 0x1F)) << 8);
-	u |= enc_read_reg(ENC_REG_ERXSTL);     ENC_DEBUG("ERXST %4x\n", u);
-	v = enc_read_reg(ENC_REG_ERXNDH);      u = (((unsigned)(v & 0x1F)) << 8);
-	u |= enc_read_reg(ENC_REG_ERXNDL);     ENC_DEBUG("ERXND %4x\n", u);
-	v = enc_read_reg(ENC_REG_ERXRDPTH);    u = (((unsigned)(v & 0x1F)) << 8);
-	u |= enc_read_reg(ENC_REG_ERXRDPTL);   ENC_DEBUG("ERXRDPT %4x\n", u);
-	v = enc_read_reg(ENC_REG_ERXWRPTH);    u = (((unsigned)(v & 0x1F)) << 8);
-	u |= enc_read_reg(ENC_REG_ERXWRPTL);   ENC_DEBUG("ERXWRPT %4x\n", u);
-
-	//v = enc_read_reg(ENC_REG_EDMASTH);     u = (((unsigned)(v & 0x1F)) << 8);
-	//u |= enc_read_reg(ENC_REG_EDMASTL);    ENC_DEBUG("EDMAST %4x\n", u);
-	//v = enc_read_reg(ENC_REG_EDMANDH);     u = (((unsigned)(v & 0x1F)) << 8);
-	//u |= enc_read_reg(ENC_REG_EDMANDL);    ENC_DEBUG("EDMAND %4x\n", u);
-	//v = enc_read_reg(ENC_REG_EDMADSTH);    u = (((unsigned)(v & 0x1F)) << 8);
-	//u |= enc_read_reg(ENC_REG_EDMADSTL);   ENC_DEBUG("EDMADST %4x\n", u);
-	//v = enc_read_reg(ENC_REG_EDMACSH);     u = (((unsigned)(v & 0x1F)) << 8);
-	//u |= enc_read_reg(ENC_REG_EDMACSL);    ENC_DEBUG("EDMACS %4x\n", u);
-
-	//v = enc_read_reg(ENC_REG_EHT0);        ENC_DEBUG("EHT0 %2x\n", (unsigned) v);
-	//v = enc_read_reg(ENC_REG_EHT1);        ENC_DEBUG("EHT1 %2x\n", (unsigned) v);
-	//v = enc_read_reg(ENC_REG_EHT2);        ENC_DEBUG("EHT2 %2x\n", (unsigned) v);
-	//v = enc_read_reg(ENC_REG_EHT3);        ENC_DEBUG("EHT3 %2x\n", (unsigned) v);
-	//v = enc_read_reg(ENC_REG_EHT4);        ENC_DEBUG("EHT4 %2x\n", (unsigned) v);
-	//v = enc_read_reg(ENC_REG_EHT5);        ENC_DEBUG("EHT5 %2x\n", (unsigned) v);
-	//v = enc_read_reg(ENC_REG_EHT6);        ENC_DEBUG("EHT6 %2x\n", (unsigned) v);
-	//v = enc_read_reg(ENC_REG_EHT7);        ENC_DEBUG("EHT7 %2x\n", (unsigned) v);
-
-	//v = enc_read_reg(ENC_REG_EPMM0);       ENC_DEBUG("EPMM0 %2x\n", (unsigned) v);
-	//v = enc_read_reg(ENC_REG_EPMM1);       ENC_DEBUG("EPMM1 %2x\n", (unsigned) v);
-	//v = enc_read_reg(ENC_REG_EPMM2);       ENC_DEBUG("EPMM2 %2x\n", (unsigned) v);
-	//v = enc_read_reg(ENC_REG_EPMM3);       ENC_DEBUG("EPMM3 %2x\n", (unsigned) v);
-	//v = enc_read_reg(ENC_REG_EPMM4);       ENC_DEBUG("EPMM4 %2x\n", (unsigned) v);
-	//v = enc_read_reg(ENC_REG_EPMM5);       ENC_DEBUG("EPMM5 %2x\n", (unsigned) v);
-	//v = enc_read_reg(ENC_REG_EPMM6);       ENC_DEBUG("EPMM6 %2x\n", (unsigned) v);
-	//v = enc_read_reg(ENC_REG_EPMM7);       ENC_DEBUG("EPMM7 %2x\n", (unsigned) v);
-
-	//v = enc_read_reg(ENC_REG_EPMCSH);      u = (((unsigned)(v & 0x1F)) << 8);
-	//u |= enc_read_reg(ENC_REG_EPMCSL);     ENC_DEBUG("EPMCS %4x\n", u);
-	//v = enc_read_reg(ENC_REG_EPMOH);       u = (((unsigned)(v & 0x1F)) << 8);
-	//u |= enc_read_reg(ENC_REG_EPMOL);      ENC_DEBUG("EPMO %4x\n", u);
-
-	//v = enc_read_reg(ENC_REG_EWOLIE);      ENC_DEBUG("EWOLIE %2x\n", (unsigned) v);
-	//v = enc_read_reg(ENC_REG_EWOLIR);      ENC_DEBUG("EWOLIR %2x\n", (unsigned) v);
-
-	v = enc_read_reg(ENC_REG_ERXFCON);     ENC_DEBUG("ERXFCON %2x\n", (unsigned) v);
-	v = enc_read_reg(ENC_REG_EPKTCNT);     ENC_DEBUG("EPKTCNT %2x\n", (unsigned) v);
-
-	v = enc_read_reg(ENC_REG_MACON1);      ENC_DEBUG("MACON1 %2x\n", (unsigned) v);
-	v = enc_read_reg(ENC_REG_MACON2);      ENC_DEBUG("MACON2 %2x\n", (unsigned) v);
-	v = enc_read_reg(ENC_REG_MACON3);      ENC_DEBUG("MACON3 %2x\n", (unsigned) v);
-	v = enc_read_reg(ENC_REG_MACON4);      ENC_DEBUG("MACON4 %2x\n", (unsigned) v);
-	v = enc_read_reg(ENC_REG_MABBIPG);     ENC_DEBUG("MABBIPG %2x\n", (unsigned) v);
-	v = enc_read_reg(ENC_REG_MAIPGH);      u = (((unsigned)(v & 0x1F)) << 8);
-	u |= enc_read_reg(ENC_REG_MAIPGL);     ENC_DEBUG("MAIPG %4x\n", u);
-	v = enc_read_reg(ENC_REG_MACLCON1);    ENC_DEBUG("MACLCON1 %2x\n", (unsigned) v);
-	v = enc_read_reg(ENC_REG_MACLCON2);    ENC_DEBUG("MACLCON2 %2x\n", (unsigned) v);
-
-	v = enc_read_reg(ENC_REG_MAMXFLH);     u = (((unsigned)(v & 0x1F)) << 8);
-	u |= enc_read_reg(ENC_REG_MAMXFLL);    ENC_DEBUG("MAMXFL %4x\n", u);
-	v = enc_read_reg(ENC_REG_MAPHSUP);     ENC_DEBUG("MAPHSUP %2x\n", (unsigned) v);
-
-	v = enc_read_reg(ENC_REG_MICON);       ENC_DEBUG("MICON %2x\n", (unsigned) v);
-
-	//v = enc_read_reg(ENC_REG_MICMD);       ENC_DEBUG("MICMD %2x\n", (unsigned) v);
-	//v = enc_read_reg(ENC_REG_MIREGADR);    ENC_DEBUG("MIREGADR %2x\n", (unsigned) v);
-	//v = enc_read_reg(ENC_REG_MIWRH);       u = (((unsigned)(v & 0x1F)) << 8);
-	//u |= enc_read_reg(ENC_REG_MIWRL);      ENC_DEBUG("MIWR %4x\n", u);
-	//v = enc_read_reg(ENC_REG_MIRDH);       u = (((unsigned)(v & 0x1F)) << 8);
-	//u |= enc_read_reg(ENC_REG_MIRDL);      ENC_DEBUG("MIRD %4x\n", u);
-
-	//v = enc_read_reg(ENC_REG_MAADR5);      ENC_DEBUG("MAADR5 %2x\n", (unsigned) v);
-	//v = enc_read_reg(ENC_REG_MAADR4);      ENC_DEBUG("MAADR4 %2x\n", (unsigned) v);
-	//v = enc_read_reg(ENC_REG_MAADR3);      ENC_DEBUG("MAADR3 %2x\n", (unsigned) v);
-	//v = enc_read_reg(ENC_REG_MAADR2);      ENC_DEBUG("MAADR2 %2x\n", (unsigned) v);
-	//v = enc_read_reg(ENC_REG_MAADR1);      ENC_DEBUG("MAADR1 %2x\n", (unsigned) v);
-	//v = enc_read_reg(ENC_REG_MAADR0);      ENC_DEBUG("MAADR0 %2x\n", (unsigned) v);
-
-	v = enc_read_reg(ENC_REG_EBSTSD);      ENC_DEBUG("EBSTSD %2x\n", (unsigned) v);
-	v = enc_read_reg(ENC_REG_EBSTCON);     ENC_DEBUG("EBSTCON %2x\n", (unsigned) v);
-	v = enc_read_reg(ENC_REG_EBSTCSH);     u = (((unsigned)(v & 0x1F)) << 8);
-	u |= enc_read_reg(ENC_REG_EBSTCSL);    ENC_DEBUG("EBSTCS %4x\n", u);
-
-	v = enc_read_reg(ENC_REG_MISTAT);      ENC_DEBUG("MISTAT %2x\n", (unsigned) v);
-
-	v = enc_read_reg(ENC_REG_EREVID);      ENC_DEBUG("EREVID %2x\n", (unsigned) v);
-	v = enc_read_reg(ENC_REG_ECOCON);      ENC_DEBUG("ECOCON %2x\n", (unsigned) v);
-	v = enc_read_reg(ENC_REG_EFLOCON);     ENC_DEBUG("EFLOCON %2x\n", (unsigned) v);
-	v = enc_read_reg(ENC_REG_EPAUSH);      u = (((unsigned)(v & 0x1F)) << 8);
-	u |= enc_read_reg(ENC_REG_EPAUSL);     ENC_DEBUG("EPAUS %4x\n", u);
-
-	u = enc_read_phyreg(ENC_REG_PHCON1);   ENC_DEBUG("PHCON1 %4x\n", u);
-	u = enc_read_phyreg(ENC_REG_PHSTAT1);  ENC_DEBUG("PHSTAT1 %4x\n", u);
-	u = enc_read_phyreg(ENC_REG_PHID1);    ENC_DEBUG("PHID1 %4x\n", u);
-	u = enc_read_phyreg(ENC_REG_PHID2);    ENC_DEBUG("PHID2 %4x\n", u);
-	u = enc_read_phyreg(ENC_REG_PHCON2);   ENC_DEBUG("PHCON2 %4x\n", u);
-	u = enc_read_phyreg(ENC_REG_PHSTAT2);  ENC_DEBUG("PHSTAT2 %4x\n", u);
-	u = enc_read_phyreg(ENC_REG_PHIE);     ENC_DEBUG("PHIE %4x\n", u);
-	u = enc_read_phyreg(ENC_REG_PHIR);     ENC_DEBUG("PHIR %4x\n", u);
-	u = enc_read_phyreg(ENC_REG_PHLCON);   ENC_DEBUG("PHLCON %4x\n", u);
-}
-#endif
-
-//-----------------------------------------------------------------------------
-
-void ICACHE_FLASH_ATTR enc_init(void)
-{
-	int i=0, j=0;
-	u16 u;
-	u8 r, d;
+/*
+-----------------------------------------------------------------------------------------
+Author:         Mark F (Cicero-MF) mark@cdelec.co.za
+Remarks:        
+Version:        15.05.2016
+Description:    Ethernet device driver for the enc28j60 and an esp8266
+
+  This code was modified for use with the ESP8266, based off a version by Harald Freudenberger 
+  (haraldfreude@arcor.de) - 2009/03/16
+  The base of this code was an enc28j60 device driver by Simon Schulz (avr@auctionant.de)
+  and modifications done by eProfi (2007/08/19).
+
+-----------------------------------------------------------------------------------------
+License:
+  This program is free software; you can redistribute it and/or modify it under
+  the terms of the GNU General Public License as published by the Free Software
+  Foundation; either version 2 of the License, or (at your option) any later
+  version.
+  This program is distributed in the hope that it will be useful, but
+
+  WITHOUT ANY WARRANTY;
+
+  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 51
+  Franklin St, Fifth Floor, Boston, MA 02110, USA
+
+  http://www.gnu.de/gpl-ger.html
+-----------------------------------------------------------------------------------------*/
+
+#include "esp8266.h"
+#include "globals.h"
+#include "spi.h"
+#include "enc28j60.h"
+#include "gpio.h"
+#include "io.h"
+
+//-----------------------------------------------------------------------------
+
+encDev enc_dev[ENC_DEVICES];
+encDev *enc_cur = &enc_dev[0];
+
+// chip select of each device, {gpio, io mux register, gpio function}
+static const struct {
+	u8  gpio;
+	u32 mux;
+	u8  func;
+} enc_cs_pins[ENC_DEVICES] = { ENC_CS_PINS };
+
+// interrupt line of each device, io.c sets them up
+static const struct {
+	u8  gpio;
+	u32 mux;
+	u8  func;
+} enc_int_pins[ENC_DEVICES] = { ENC_INT_PINS };
+
+//-----------------------------------------------------------------------------
+// the device every other function works on until the next call
+void ICACHE_FLASH_ATTR enc_use( u8 n )
+{
+	if( n < ENC_DEVICES ) enc_cur = &enc_dev[n];
+}
+
+static const u8 enc_configdata[] = {
+
+	// enc registers - the buffer split and everything that depends on the
+	// duplex is left to enc_configure
+
+	// push mac out of reset
+	ENC_REG_MACON2, 0x00,
+
+	// mac receive enable, rx and tx pause control frames enable
+	ENC_REG_MACON1, (1<<ENC_BIT_MARXEN) | (1<<ENC_BIT_RXPAUS) | (1<<ENC_BIT_TXPAUS),
+
+	// max framelength 1518
+	ENC_REG_MAMXFLL, LO8(ENC_MAX_FRAMELEN),
+	ENC_REG_MAMXFLH, HI8(ENC_MAX_FRAMELEN),
+
+	// non back-to-back inter packet gap delay time (should be 0x12)
+	ENC_REG_MAIPGL, 0x12,
+  
+  // enable promiscuous mode
+  //ENC_REG_ERXFCON, 0x00,
+
+	// pause time sent by flow control, 0x1000 * 512 bit times = 210ms. Pause
+	// frames are repeated before it runs out until flow control is released
+	ENC_REG_EPAUSL, LO8(ENC_FLOW_PAUSE_TIME),
+	ENC_REG_EPAUSH, HI8(ENC_FLOW_PAUSE_TIME),
+
+  // disable CLKOUT pin
+	ENC_REG_ECOCON, 0x00,
+
+	// our mac address
+	ENC_REG_MAADR5, MYMAC1,
+	ENC_REG_MAADR4, MYMAC2,
+	ENC_REG_MAADR3, MYMAC3,
+	ENC_REG_MAADR2, MYMAC4,
+	ENC_REG_MAADR1, MYMAC5,
+	ENC_REG_MAADR0, MYMAC6,
+
+  0xFF, 0xFF,
+  
+	// now the phy registers (with 2 bytes data each)
+
+	// leds: leda (yellow) rx and tx activity, stretch to 40ms
+	//       ledb (green)  link status
+	#define ENC_REG_PHCON_VALUE (0x0000 | (1 << ENC_BIT_STRCH) \
+			     | (7 << ENC_BIT_LACFG0)               \
+			     | (4 << ENC_BIT_LBCFG0))
+	ENC_REG_PHLCON, HI8(ENC_REG_PHCON_VALUE), LO8(ENC_REG_PHCON_VALUE),
+
+	// end of config data marker
+	0xFF, 0xFF
+};
+
+u16 ICACHE_FLASH_ATTR enc_linkup (void) {
+  u16 u;
+  u = enc_read_phyreg(ENC_REG_PHSTAT2);  //ENC_DEBUG("PHSTAT2 %4x\n", u);  
+  if (u & ETHERNET_LINK_UP) {
+    return ETHERNET_LINK_UP;
+  } else {
+    return 0;
+  }
+}
+
+
+
+//-----------------------------------------------------------------------------
+
+static void ICACHE_FLASH_ATTR usdelay( u16 us )
+{
+  os_delay_us(us);
+}
+
+static inline void spi_put( u8 value )
+{
+	//ENC_DEBUG("spi_put(%2x)\n", (unsigned) value );  
+  spi_tx8(SPI_USED, value);
+}
+
+static inline u8 spi_get(void)
+{
+  return (u8)spi_rx8(SPI_USED);
+}
+
+//-----------------------------------------------------------------------------
+static inline void enc_reset(void)
+{
+	enc_select();
+	spi_put( ENC_SPI_OP_SC );
+	enc_deselect();
+
+	// errata #2: wait for at least 300 us
+	usdelay( 1000 );
+}
+
+static void ICACHE_FLASH_ATTR enc_clrbits_reg( u8 reg, u8 bits )
+{
+	// no automatic bank switching in this function !!!
+
+	u8 addr = reg & ENC_REG_ADDR_MASK;
+
+	enc_select();
+  spi_transaction(SPI_USED, 8, (ENC_SPI_OP_BFC | addr), 0, 0, 8, bits, 0, 0);
+	enc_deselect();
+}
+
+static void ICACHE_FLASH_ATTR enc_setbits_reg( u8 reg, u8 bits )
+{
+	// no automatic bank switching in this function !!!
+
+	u8 addr = reg & ENC_REG_ADDR_MASK;
+
+	enc_select();
+  spi_transaction(SPI_USED, 8, (ENC_SPI_OP_BFS | addr), 0, 0, 8, bits, 0, 0);
+	enc_deselect();
+}
+
+static u8 ICACHE_FLASH_ATTR enc_read_reg( u8 reg )
+{
+	u8 value;
+	u8 addr = reg & ENC_REG_ADDR_MASK;
+
+	if( addr < 0x1A ) {
+		u8 bank = (reg & ENC_REG_BANK_MASK) >> ENC_REG_BANK_SHIFT;
+		if( bank != enc_cur->cur_bank ) {
+			// need to switch bank first
+			enc_clrbits_reg( ENC_REG_ECON1, 0x03 << ENC_BIT_BSEL0 );
+			if( bank ) {
+				enc_setbits_reg( ENC_REG_ECON1, bank << ENC_BIT_BSEL0 );
+			}
+			enc_cur->cur_bank = bank;
+		}
+	}
+
+	enc_select();
+  if( reg & ENC_REG_WAIT_MASK ) {
+    value = spi_transaction(SPI_USED, 8, (ENC_SPI_OP_RCR | addr), 0, 0, 8, 0, 8, 0);  
+  } else {
+    value = spi_transaction(SPI_USED, 8, (ENC_SPI_OP_RCR | addr), 0, 0, 0, 0, 8, 0);
+  }
+  
+	enc_deselect();
+
+	return value;
+}
+
+static void ICACHE_FLASH_ATTR enc_write_reg( u8 reg, u8 value )
+{
+	u8 addr = reg & ENC_REG_ADDR_MASK;
+
+	if( addr < 0x1A ) {
+		u8 bank = (reg & ENC_REG_BANK_MASK) >> ENC_REG_BANK_SHIFT;
+		if( bank != enc_cur->cur_bank ) {
+			// need to switch bank first
+			enc_clrbits_reg( ENC_REG_ECON1, 0x03 << ENC_BIT_BSEL0 );
+			if( bank ) {
+				enc_setbits_reg( ENC_REG_ECON1, bank << ENC_BIT_BSEL0 );
+			}
+			enc_cur->cur_bank = bank;
+		}
+	}
+  enc_select();
+  spi_transaction(SPI_USED, 8, (ENC_SPI_OP_WCR | addr), 0, 0, 8, value, 0, 0);
+	enc_deselect();
+}
+
+#if 1
+u16 ICACHE_FLASH_ATTR enc_read_phyreg( u8 phyreg )
+{
+	u16 value;
+
+	enc_write_reg( ENC_REG_MIREGADR, phyreg );
+	enc_write_reg( ENC_REG_MICMD, (1<<ENC_BIT_MIIRD) );
+	usdelay(10);
 	
-  //ENC Hardware Reset
-  
-  gpio_output_set(0, (1<<ENCRESETGPIO), (1<<ENCRESETGPIO), 0);  
-  os_delay_us(200000);
-  gpio_output_set((1<<ENCRESETGPIO), 0, (1<<ENCRESETGPIO), 0);  
-	os_delay_us(200000);
-  
-	// config enc chip select as output and deselect enc
-  // chip select is configured in spi_init
-  
-	// init spi
-	spi_init(SPI_USED);
-
-	// send a reset command via spi to the enc
-	enc_reset();
-
-	// wait for the CLKRDY bit
-	while( !(enc_read_reg( ENC_REG_ESTAT ) & (1<<ENC_BIT_CLKRDY)) ) ;
-
-	// get enc revision id
-	//enc_revid = enc_read_reg( ENC_REG_EREVID );
-	//ENC_DEBUG("enc revid %x\n", (int) enc_revid);
-  
-  //MAC Address
-  #ifdef USE_SEPARATE_ENC_MAC
-    //MAC Adresse setzen
-    mymac[0] = MYMAC1;
-    mymac[1] = MYMAC2;
-    mymac[2] = MYMAC3;
-    mymac[3] = MYMAC4;
-    mymac[4] = MYMAC5;
-    mymac[5] = MYMAC6;
-  #else
-    wifi_get_macaddr(STATION_IF, mymac);
-    ENC_DEBUG("\""MACSTR"\"\r\n", MAC2STR(mymac));
-	#endif
-
-	// setup enc registers according to the enc_configdata struct
-	while(i < sizeof(enc_configdata)) {
-		r = enc_configdata[i++];    
-		d = enc_configdata[i++];
-		if(r == ENC_REG_MAADR5) break;
-		enc_write_reg( r, d );
-	}
-  
-  // load mac 
-  i-=2;  // to keep with the loading method, ease of understanding
-  for (j=0;j<6;j++) {
-    r = enc_configdata[i]; 
-    d = mymac[j];
-    i+=2;
-    enc_write_reg( r, d );   
-  }
-  
-  //ENC_DEBUG("finished enc registers, cu bank = %u\r\n", enc_cur_bank);
-  
-  //enc_regdump(); 
-  
-	// now the phy registers
-	while(i < sizeof(enc_configdata)) {
-		r = enc_configdata[i++];
-		d = enc_configdata[i++];
-		if( r == 0xFF && d == 0xFF ) break;
-		u = (((u16)d) << 8);
-		d = enc_configdata[i++];
-		u |= d;
-		enc_write_phyreg( r, u );
-	}
-  
-	// setup receive next packet pointer
-	enc_next_packet_ptr = ENC_RX_BUFFER_START;
-
-	// configure the enc interrupt sources
-	enc_write_reg( ENC_REG_EIE, (1 << ENC_BIT_INTIE)  | (1 << ENC_BIT_PKTIE)
-				  | (0 << ENC_BIT_DMAIE)  | (0 << ENC_BIT_LINKIE)
-				  | (0 << ENC_BIT_TXIE)   | (0 << ENC_BIT_WOLIE)
-				  | (0 << ENC_BIT_TXERIE) | (0 << ENC_BIT_RXERIE));
-
-	// enable receive
-	enc_setbits_reg( ENC_REG_ECON1, (1<<ENC_BIT_RXEN) );
-}
-
-//-----------------------------------------------------------------------------
-
-//LED blink test
-void ICACHE_FLASH_ATTR enc28j60_led_blink (u8 a)
-{
-	if(a)
-	{
+  while( enc_read_reg( ENC_REG_MISTAT ) & (1<<ENC_BIT_BUSY) ) ;
+	enc_write_reg( ENC_REG_MICMD, 0x00 );
+	value = (((u16) enc_read_reg( ENC_REG_MIRDH )) << 8);
+	value |= ((u16) enc_read_reg( ENC_REG_MIRDL ));
+
+	return value;
+}
+#endif
+
+static void ICACHE_FLASH_ATTR enc_write_phyreg( u8 phyreg, u16 value )
+{
+  u8 rec;
+	enc_write_reg( ENC_REG_MIREGADR, phyreg );
+	enc_write_reg( ENC_REG_MIWRL, LO8(value) );
+	enc_write_reg( ENC_REG_MIWRH, HI8(value) );
+	usdelay(10);	
+  
+  rec = enc_read_reg( ENC_REG_MISTAT );
+	while( rec & (1<<ENC_BIT_BUSY) ) {
+    rec = enc_read_reg( ENC_REG_MISTAT );   
+    ENC_DEBUG("phy: ENC_REG_MISTAT=%2x\n", rec);
+  }
+}
+
+static void ICACHE_FLASH_ATTR enc_read_buf( u8 *buf, u16 len )
+{
+	//ENC_DEBUG("enc_read_buf: %u bytes\n", len);
+  enc_select();
+	
+	for(; len > 0; len--, buf++ ) {
+		*buf = spi_transaction(SPI_USED, 8, (ENC_SPI_OP_RBM), 0, 0, 0, 0, 8, 0);
+	}
+	enc_deselect();
+}
+
+// more bytes at the write pointer, no control byte
+static void ICACHE_FLASH_ATTR enc_write_data( const u8 *buf, u16 len )
+{
+	enc_select();
+	for(; len > 0; len--, buf++ ) {
+    spi_transaction(SPI_USED, 8, (ENC_SPI_OP_WBM), 0, 0, 8, *buf, 0, 0);
+	}
+	enc_deselect();
+}
+
+// more bytes at the write pointer, read word by word from mapped flash
+static void ICACHE_FLASH_ATTR enc_write_flash( u32 addr, u16 len )
+{
+	u32 word = FLASH_WORD( addr );
+	u8 shift = (addr & 3) << 3;
+
+	enc_select();
+	while( len-- ) {
+    spi_transaction(SPI_USED, 8, (ENC_SPI_OP_WBM), 0, 0, 8, (u8)(word >> shift), 0, 0);
+		addr++;
+		shift += 8;
+		if( shift == 32 && len ) {
+			word = FLASH_WORD( addr );
+			shift = 0;
+		}
+	}
+	enc_deselect();
+}
+
+static void ICACHE_FLASH_ATTR enc_write_buf( u8 *buf, u16 len )
+{
+	enc_select();
+  ENC_DEBUG("enc_wbuf:%u\n", len);
+  spi_transaction(SPI_USED, 8, (ENC_SPI_OP_WBM), 0, 0, 8, 0, 0, 0);
+	enc_deselect();
+	enc_write_data( buf, len );
+}
+
+//-----------------------------------------------------------------------------
+
+// waits for the previous frame to leave, the tx pointers are free again then
+static void ICACHE_FLASH_ATTR enc_tx_wait( void )
+{
+	u16 ms = 100;
+
+	// wait up to 100 ms for the previos tx to finish
+	while( ms-- ) {
+		if( !(enc_read_reg( ENC_REG_ECON1 ) & (1<<ENC_BIT_TXRTS)) ) break;
+		usdelay( 1000 );
+	}
+
+	// reset tx logic if TXRTS bit is still on, in half duplex always
+	// (errata #12)
+	if( !enc_cur->full_duplex || (enc_read_reg( ENC_REG_ECON1 ) & (1<<ENC_BIT_TXRTS)) ) {
+		//ENC_DEBUG("enc_send: reset tx logic\n");
+		enc_setbits_reg( ENC_REG_ECON1, (1<<ENC_BIT_TXRST) );
+		enc_clrbits_reg( ENC_REG_ECON1, (1<<ENC_BIT_TXRST) );
+	}
+}
+
+// sets the buffer up for len bytes. With a second slot the frame is written
+// while the previous one is still going out, with one it has to wait first
+static void ICACHE_FLASH_ATTR enc_tx_begin( u16 len )
+{
+	u16 start;
+
+	if( enc_cur->tx_slots > 1 ) {
+		enc_cur->tx_slot = (enc_cur->tx_slot + 1) % enc_cur->tx_slots;
+	} else {
+		enc_tx_wait();
+	}
+	start = enc_cur->tx_base + enc_cur->tx_slot * ENC_TX_SLOT_SIZE;
+	enc_cur->tx_len = len;
+
+	// setup write pointer
+	enc_write_reg( ENC_REG_EWRPTL, LO8(start) );
+	enc_write_reg( ENC_REG_EWRPTH, HI8(start) );
+}
+
+static void ICACHE_FLASH_ATTR enc_tx_start( void )
+{
+	u16 start = enc_cur->tx_base + enc_cur->tx_slot * ENC_TX_SLOT_SIZE;
+
+	if( enc_cur->tx_slots > 1 ) enc_tx_wait();
+
+	// start and end pointer (points to last byte) to start + len
+	enc_write_reg( ENC_REG_ETXSTL, LO8(start) );
+	enc_write_reg( ENC_REG_ETXSTH, HI8(start) );
+	enc_write_reg( ENC_REG_ETXNDL, LO8(start+enc_cur->tx_len) );
+	enc_write_reg( ENC_REG_ETXNDH, HI8(start+enc_cur->tx_len) );
+
+	// clear TXIF flag
+	enc_clrbits_reg( ENC_REG_EIR, (1<<ENC_BIT_TXIF) );
+
+	// start transmission by setting the TXRTS bit
+	enc_setbits_reg( ENC_REG_ECON1, (1<<ENC_BIT_TXRTS) );
+}
+
+void ICACHE_FLASH_ATTR enc_send_packet( u16 len, u8 *buf )
+{
+	//ENC_DEBUG("enc_send: %u bytes\n", len);
+
+	enc_tx_begin( len );
+
+	// copy packet to enc buffer
+	enc_write_buf( buf, len );
+
+	enc_tx_start();
+}
+
+// frame in two pieces, headers and payload are written one after the other
+// so the payload never has to be copied in front of the headers first
+void ICACHE_FLASH_ATTR enc_send_packet_v( u16 len, u8 *buf, u16 data_len, const u8 *data )
+{
+	enc_tx_begin( len + data_len );
+	enc_write_buf( buf, len );
+	enc_write_data( data, data_len );
+	enc_tx_start();
+}
+
+// same with the payload still in flash, it goes to the enc without being
+// read into ram first
+void ICACHE_FLASH_ATTR enc_send_packet_flash( u16 len, u8 *buf, u16 data_len, u32 flash_addr )
+{
+	enc_tx_begin( len + data_len );
+	enc_write_buf( buf, len );
+	enc_write_flash( flash_addr, data_len );
+	enc_tx_start();
+}
+
+// previous frame still going out?
+u8 ICACHE_FLASH_ATTR enc_tx_busy( void )
+{
+	return (enc_read_reg( ENC_REG_ECON1 ) & (1<<ENC_BIT_TXRTS)) ? 1 : 0;
+}
+
+// link went up or down since the last call? reading PHIR clears LINKIF
+// and with it the interrupt
+u8 ICACHE_FLASH_ATTR enc_link_changed (void) {
+  if (!(enc_read_reg(ENC_REG_EIR) & (1<<ENC_BIT_LINKIF))) {
+    return 0;
+  }
+  enc_read_phyreg(ENC_REG_PHIR);
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+// full duplex: pause frames until released, then one with a zero pause time
+// so the partner goes on at once (FCEN clears itself after it). Half duplex:
+// backpressure, the chip jams whatever the partner starts to send
+static void ICACHE_FLASH_ATTR enc_flow_set( u8 on )
+{
+	if( on ) {
+		enc_write_reg( ENC_REG_EFLOCON, enc_cur->full_duplex ? (1<<ENC_BIT_FCEN1) : (1<<ENC_BIT_FCEN0) );
+		enc_cur->flow.engaged++;
+		enc_cur->flow_since = system_get_time();
+	} else {
+		enc_write_reg( ENC_REG_EFLOCON, enc_cur->full_duplex ? (1<<ENC_BIT_FCEN1) | (1<<ENC_BIT_FCEN0) : 0 );
+		enc_cur->flow.held_ms += (system_get_time() - enc_cur->flow_since) / 1000;
+	}
+	enc_cur->flow_on = on;
+}
+
+static void ICACHE_FLASH_ATTR enc_flow_release( void )
+{
+	if( enc_cur->flow_on ) enc_flow_set( 0 );
+}
+
+// rx ring fill against the watermarks. The stack calls it with the fill at
+// the start and the end of every receive run, the end of a run is what lets
+// a paused partner go again
+void ICACHE_FLASH_ATTR enc_flow_control( u16 used )
+{
+	u16 size = ENC_RX_BUFFER_SIZE;
+
+	if( !enc_cur->flow_enabled ) return;
+	if( used > enc_cur->flow.used_peak ) enc_cur->flow.used_peak = used;
+	if( !enc_cur->flow_on && used > (u32)size * ENC_FLOW_HIGH / 100 ) {
+		enc_flow_set( 1 );
+	} else if( enc_cur->flow_on && used < (u32)size * ENC_FLOW_LOW / 100 ) {
+		enc_flow_set( 0 );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// receive logic back to the state enc_init leaves it in, frames in the ring
+// are lost but nothing else is touched
+static void ICACHE_FLASH_ATTR enc_rx_restart( void )
+{
+	u8 n = 0xFF;
+
+	// the ring is emptied, nothing left to hold the partner off for
+	enc_flow_release();
+	enc_clrbits_reg( ENC_REG_ECON1, (1<<ENC_BIT_RXEN) );
+	enc_setbits_reg( ENC_REG_ECON1, (1<<ENC_BIT_RXRST) );
+	enc_clrbits_reg( ENC_REG_ECON1, (1<<ENC_BIT_RXRST) );
+
+	// writing ERXST puts the write pointer back to the start
+	enc_write_reg( ENC_REG_ERXSTL, LO8(ENC_RX_BUFFER_START) );
+	enc_write_reg( ENC_REG_ERXSTH, HI8(ENC_RX_BUFFER_START) );
+	enc_write_reg( ENC_REG_ERXNDL, LO8(ENC_RX_BUFFER_END) );
+	enc_write_reg( ENC_REG_ERXNDH, HI8(ENC_RX_BUFFER_END) );
+	enc_write_reg( ENC_REG_ERXRDPTL, LO8(ENC_RX_BUFFER_END) );
+	enc_write_reg( ENC_REG_ERXRDPTH, HI8(ENC_RX_BUFFER_END) );
+	enc_cur->next_packet_ptr = ENC_RX_BUFFER_START;
+
+	while( enc_read_reg( ENC_REG_EPKTCNT ) && n-- ) {
+		enc_setbits_reg( ENC_REG_ECON2, (1<<ENC_BIT_PKTDEC) );
+	}
+	enc_clrbits_reg( ENC_REG_EIR, (1<<ENC_BIT_RXERIF) );
+	enc_setbits_reg( ENC_REG_ECON1, (1<<ENC_BIT_RXEN) );
+}
+
+static void ICACHE_FLASH_ATTR enc_rx_reset( void )
+{
+	enc_cur->health.rx_reset++;
+	enc_rx_restart();
+}
+
+// transmit logic, a frame still going out is lost
+static void ICACHE_FLASH_ATTR enc_tx_reset( void )
+{
+	enc_cur->health.tx_reset++;
+	enc_setbits_reg( ENC_REG_ECON1, (1<<ENC_BIT_TXRST) );
+	enc_clrbits_reg( ENC_REG_ECON1, (1<<ENC_BIT_TXRST) );
+	enc_clrbits_reg( ENC_REG_ECON1, (1<<ENC_BIT_TXRTS) );
+	enc_clrbits_reg( ENC_REG_EIR, (1<<ENC_BIT_TXERIF) | (1<<ENC_BIT_TXIF) );
+	// the abort and late collision status bits stay set until cleared
+	enc_clrbits_reg( ENC_REG_ESTAT, (1<<ENC_BIT_TXABRT) | (1<<ENC_BIT_LATECOL) );
+}
+
+//-----------------------------------------------------------------------------
+// mac and phy to one duplex, the two have to agree
+static void ICACHE_FLASH_ATTR enc_duplex_setup( u8 full )
+{
+	u8 macon3 = (1<<ENC_BIT_PADCFG0) | (1<<ENC_BIT_TXCRCEN) | (1<<ENC_BIT_FRMLNEN);
+
+	enc_cur->full_duplex = full;
+	if( full ) {
+		// back-to-back inter packet gap 0x15, MAIPGH is not used
+		enc_write_reg( ENC_REG_MACON3, macon3 | (1<<ENC_BIT_FULDPX) );
+		enc_write_reg( ENC_REG_MABBIPG, 0x15 );
+		enc_write_phyreg( ENC_REG_PHCON1, (1 << ENC_BIT_PDPXMD) );
+		enc_write_phyreg( ENC_REG_PHCON2, 0x0000 );
+	} else {
+		// back-to-back gap 0x12, non back-to-back high byte 0x0C, and the
+		// transmitted data not looped back
+		enc_write_reg( ENC_REG_MACON3, macon3 );
+		enc_write_reg( ENC_REG_MABBIPG, 0x12 );
+		enc_write_reg( ENC_REG_MAIPGH, 0x0C );
+		enc_write_phyreg( ENC_REG_PHCON1, 0x0000 );
+		enc_write_phyreg( ENC_REG_PHCON2, (1 << ENC_BIT_HDLDIS) );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// duplex and sram split from sysCfg. enc_init calls it, and it can be called
+// again whenever sysCfg changed: transmit and receive are stopped, the ring
+// starts over at its new size and mac and phy get the new duplex. Mac
+// address, filters and interrupts are left as they are
+void ICACHE_FLASH_ATTR enc_configure( void )
+{
+	u8 duplex = sysCfg.enc_duplex;
+	u8 slots  = sysCfg.enc_tx_slots;
+	u8 full;
+
+	// never set (erased flash reads 0xFF) or out of range
+	if( duplex > ENC_DUPLEX_FULL ) duplex = ENC_DUPLEX;
+	if( slots < 1 || slots > ENC_TX_SLOTS_MAX ) slots = ENC_TX_SLOTS;
+	enc_cur->flow_enabled = (sysCfg.enc_flow > 1) ? ENC_FLOW : sysCfg.enc_flow;
+
+	// let the partner go in the duplex it was held off in
+	enc_flow_release();
+
+	// the phy can't negotiate - auto takes what the LEDB strap selected
+	if( duplex == ENC_DUPLEX_AUTO ) full = (enc_cur->duplex_strap == ENC_DUPLEX_FULL);
+	else                            full = (duplex == ENC_DUPLEX_FULL);
+
+	enc_clrbits_reg( ENC_REG_ECON1, (1<<ENC_BIT_RXEN) );
+	enc_tx_wait();
+
+	// tx slots at the top of the sram, the ring gets everything below
+	enc_cur->tx_slots = slots;
+	enc_cur->tx_slot  = 0;
+	enc_cur->tx_base  = ENC_SRAM_END + 1 - slots * ENC_TX_SLOT_SIZE;
+	enc_cur->rx_end   = enc_cur->tx_base - 1;
+	enc_write_reg( ENC_REG_ETXSTL, LO8(enc_cur->tx_base) );
+	enc_write_reg( ENC_REG_ETXSTH, HI8(enc_cur->tx_base) );
+	enc_write_reg( ENC_REG_ETXNDL, LO8(ENC_SRAM_END) );
+	enc_write_reg( ENC_REG_ETXNDH, HI8(ENC_SRAM_END) );
+
+	enc_duplex_setup( full );
+	ENC_DEBUG("enc: %s duplex, rx %u bytes, %u tx slots, flow control %s\n",
+	          full ? "full" : "half", ENC_RX_BUFFER_SIZE, slots, enc_cur->flow_enabled ? "on" : "off");
+
+	// ring over at the new size, receive back on
+	enc_rx_restart();
+}
+
+//-----------------------------------------------------------------------------
+// phy loopback for the self test: frames sent come straight back and nothing
+// goes to the wire. The phy needs full duplex for it, the link is forced up
+// so the stack doesn't drop its connections. Off puts duplex and ring back
+// the way sysCfg has them
+void ICACHE_FLASH_ATTR enc_loopback( u8 on )
+{
+	if( !on ) {
+		enc_configure();
+		return;
+	}
+	enc_clrbits_reg( ENC_REG_ECON1, (1<<ENC_BIT_RXEN) );
+	enc_tx_wait();
+	enc_duplex_setup( 1 );
+	enc_write_phyreg( ENC_REG_PHCON1, (1 << ENC_BIT_PDPXMD) | (1 << ENC_BIT_PLOOPBK) );
+	enc_write_phyreg( ENC_REG_PHCON2, (1 << ENC_BIT_FRCLNK) );
+	enc_rx_restart();
+}
+
+//-----------------------------------------------------------------------------
+// looks the chip over and fixes what it can, cheapest first - rewritten
+// registers, a tx or rx logic reset. Returns what was done, ENC_RECOVER_INIT
+// means nothing less than enc_init will do. active says frames came in since
+// the last check, spi evidently works then
+u8 ICACHE_FLASH_ATTR enc_health_check( u8 active )
+{
+	u8  done = 0;
+	u8  econ1, eir, eie, fcon;
+	u16 wr, rd;
+
+	enc_cur->health.checks++;
+
+	// chip gone or spi broken - no point looking any further
+	if( !active ) {
+		u8 rev = enc_read_reg( ENC_REG_EREVID );
+		if( rev == 0x00 || rev == 0xFF || (enc_cur->revid && rev != enc_cur->revid) ) {
+			enc_cur->health.full_init++;
+			return ENC_RECOVER_INIT;
+		}
+	}
+
+	// interrupt sources and receive filter as enc_init set them
+	eie  = enc_read_reg( ENC_REG_EIE );
+	fcon = enc_read_reg( ENC_REG_ERXFCON );
+	if( eie != ENC_EIE_SETUP || fcon != ENC_ERXFCON_SETUP(enc_cur->multicast) ) {
+		enc_write_reg( ENC_REG_EIE, ENC_EIE_SETUP );
+		enc_write_reg( ENC_REG_ERXFCON, ENC_ERXFCON_SETUP(enc_cur->multicast) );
+		enc_cur->health.reg_repair++;
+		done |= ENC_RECOVER_REG;
+	}
+
+	// transmit error or abort - the frame is lost anyway, the logic may hang
+	econ1 = enc_read_reg( ENC_REG_ECON1 );
+	eir   = enc_read_reg( ENC_REG_EIR );
+	if( (eir & (1<<ENC_BIT_TXERIF)) || (enc_read_reg( ENC_REG_ESTAT ) & (1<<ENC_BIT_TXABRT)) ) {
+		enc_tx_reset();
+		done |= ENC_RECOVER_TX;
+	}
+
+	// ring overflowed - frames were dropped, the ring itself is fine
+	if( eir & (1<<ENC_BIT_RXERIF) ) {
+		enc_cur->health.rx_overflow++;
+		enc_clrbits_reg( ENC_REG_EIR, (1<<ENC_BIT_RXERIF) );
+	}
+
+	// receive off, or pointers outside the ring
+	wr  =  enc_read_reg( ENC_REG_ERXWRPTL );
+	wr |= (enc_read_reg( ENC_REG_ERXWRPTH ) << 8);
+	rd  =  enc_read_reg( ENC_REG_ERXRDPTL );
+	rd |= (enc_read_reg( ENC_REG_ERXRDPTH ) << 8);
+	if( !(econ1 & (1<<ENC_BIT_RXEN))
+	    || wr > ENC_RX_BUFFER_END || rd > ENC_RX_BUFFER_END
+	    || enc_cur->next_packet_ptr > ENC_RX_BUFFER_END ) {
+		enc_rx_reset();
+		done |= ENC_RECOVER_RX;
+	}
+	return done;
+}
+
+u16 ICACHE_FLASH_ATTR enc_receive_packet( u16 bufsize, u8 *buf )
+{
+	u8 rxheader[6];
+	u16 len, status;
+	u8 u;
+
+	// check rx packet counter
+	u = enc_read_reg( ENC_REG_EPKTCNT );
+	//ENC_DEBUG("enc_receive: EPKTCNT=%u\n", (int) u);
+	if( u == 0 ) {
+		// packetcounter is 0, there is nothing to receive, go back
+		return 0;
+	}
+
+	//set read pointer to next packet
+	enc_write_reg( ENC_REG_ERDPTL, LO8(enc_cur->next_packet_ptr) );
+	enc_write_reg( ENC_REG_ERDPTH, HI8(enc_cur->next_packet_ptr) );
+
+	// read enc rx packet header
+	enc_read_buf( rxheader, sizeof(rxheader) );
+	enc_cur->next_packet_ptr  =             rxheader[0];
+	enc_cur->next_packet_ptr |= (rxheader[1] << 8);
+	len                  =             rxheader[2];
+	len                 |= (rxheader[3] << 8);
+	status               =             rxheader[4];
+	status              |= (rxheader[5] << 8);
+
+	// header pointing outside the ring or a length no frame can have - the
+	// ring can't be walked any further, start it over
+	if( enc_cur->next_packet_ptr > ENC_RX_BUFFER_END || (enc_cur->next_packet_ptr & 1)
+	    || len < 4 || len > ENC_MAX_FRAMELEN + 4 ) {
+    ENC_DEBUG("enc_receive: bad header, rx reset\r\n");
+		enc_rx_reset();
+		return 0;
+	}
+
+	// receive OK not set or the zero bit set - the frame is bad but the ring
+	// is fine, skip just this one
+	if ((!(status & (1<<7))) || (status & 0x8000))
+	{ 
+    ENC_DEBUG("enc_receive: bad status %4x, skipped\r\n", status);
+		enc_cur->health.rx_skip++;
+		len = 4;
+	}
+	//ENC_DEBUG("enc_receive: status=%4x, %2x,%2x,%2x,%2x,%2x,%2x,\n", status, rxheader[0],rxheader[1],rxheader[2],rxheader[3],rxheader[4],rxheader[5]);
+
+	// skip the checksum (4 bytes) at the end of the buffer
+	len -= 4;
+
+	// if the application buffer is to small, we just truncate
+	if( len > bufsize ) len = bufsize;
+
+	// now read the packet data into buffer
+	enc_read_buf( buf, len );
+
+	// adjust the ERXRDPT pointer (= free this packet in rx buffer)
+	if(    enc_cur->next_packet_ptr-1 > ENC_RX_BUFFER_END
+	    || enc_cur->next_packet_ptr-1 < ENC_RX_BUFFER_START ) {
+		enc_write_reg( ENC_REG_ERXRDPTL, LO8(ENC_RX_BUFFER_END) );
+		enc_write_reg( ENC_REG_ERXRDPTH, HI8(ENC_RX_BUFFER_END) );
+	} else {
+		enc_write_reg( ENC_REG_ERXRDPTL, LO8(enc_cur->next_packet_ptr-1) );
+		enc_write_reg( ENC_REG_ERXRDPTH, HI8(enc_cur->next_packet_ptr-1) );
+	}
+
+	// trigger a decrement of the rx packet counter
+	// this will clear PKTIF if EPKTCNT reaches 0
+	enc_setbits_reg( ENC_REG_ECON2, (1<<ENC_BIT_PKTDEC) );
+
+	// return number of bytes written to the buffer
+	//ENC_DEBUG("enc_receive: %u bytes\n", len);
+	return len;
+}
+
+//-----------------------------------------------------------------------------
+// bytes waiting in the rx ring, between the next packet and the write pointer
+u16 ICACHE_FLASH_ATTR enc_rx_used( void )
+{
+	u16 wr;
+
+	wr  =  enc_read_reg( ENC_REG_ERXWRPTL );
+	wr |= (enc_read_reg( ENC_REG_ERXWRPTH ) << 8);
+
+	if( wr >= enc_cur->next_packet_ptr ) return wr - enc_cur->next_packet_ptr;
+	return ENC_RX_BUFFER_SIZE - (enc_cur->next_packet_ptr - wr);
+}
+
+
+
+//-----------------------------------------------------------------------------
+
+#if 0
+static void ICACHE_FLASH_ATTR enc_regdump(void)
+{
+	u8 v;
+	u16  u;
+
+	v = enc_read_reg(ENC_REG_EIE);         ENC_DEBUG("EIE %2x\n", (unsigned)v);
+	v = enc_read_reg(ENC_REG_EIR);         ENC_DEBUG("EIR %2x\n", (unsigned)v);
+	v = enc_read_reg(ENC_REG_ESTAT);       ENC_DEBUG("ESTAT %2x\n", (unsigned)v);
+	v = enc_read_reg(ENC_REG_ECON2);       ENC_DEBUG("ECON2 %2x\n", (unsigned)v);
+	v = enc_read_reg(ENC_REG_ECON1);       ENC_DEBUG("ECON1 %2x\n", (unsigned)v);
+
+	v = enc_read_reg(ENC_REG_ERDPTH);      u = (((unsigned)(v & 0x1F)) << 8);
+	u |= enc_read_reg(ENC_REG_ERDPTL);     ENC_DEBUG("ERDPT %4x\n", u);
+	v = enc_read_reg(ENC_REG_EWRPTH);      u = (((unsigned)(v & 0x1F)) << 8);
+	u |= enc_read_reg(ENC_REG_EWRPTL);     ENC_DEBUG("EWRPT %4x\n", u);
+	v = enc_read_reg(ENC_REG_ETXSTH);      u = (((unsigned)(v & 0x1F)) << 8);
+	u |= enc_read_reg(ENC_REG_ETXSTL);     ENC_DEBUG("ETXST %4x\n", u);
+	v = enc_read_reg(ENC_REG_ETXNDH);      u = (((unsigned)(v & 0x1F)) << 8);
+	u |= enc_read_reg(ENC_REG_ETXNDL);     ENC_DEBUG("ETXND %4x\n", u);
+	v = enc_read_reg(ENC_REG_ERXSTH);      u = (((unsigned)(v & 0x1F)) << 8);
+	u |= enc_read_reg(ENC_REG_ERXSTL);     ENC_DEBUG("ERXST %4x\n", u);
+	v = enc_read_reg(ENC_REG_ERXNDH);      u = (((unsigned)(v & 0x1F)) << 8);
+	u |= enc_read_reg(ENC_REG_ERXNDL);     ENC_DEBUG("ERXND %4x\n", u);
+	v = enc_read_reg(ENC_REG_ERXRDPTH);    u = (((unsigned)(v & 0x1F)) << 8);
+	u |= enc_read_reg(ENC_REG_ERXRDPTL);   ENC_DEBUG("ERXRDPT %4x\n", u);
+	v = enc_read_reg(ENC_REG_ERXWRPTH);    u = (((unsigned)(v & 0x1F)) << 8);
+	u |= enc_read_reg(ENC_REG_ERXWRPTL);   ENC_DEBUG("ERXWRPT %4x\n", u);
+
+	//v = enc_read_reg(ENC_REG_EDMASTH);     u = (((unsigned)(v & 0x1F)) << 8);
+	//u |= enc_read_reg(ENC_REG_EDMASTL);    ENC_DEBUG("EDMAST %4x\n", u);
+	//v = enc_read_reg(ENC_REG_EDMANDH);     u = (((unsigned)(v & 0x1F)) << 8);
+	//u |= enc_read_reg(ENC_REG_EDMANDL);    ENC_DEBUG("EDMAND %4x\n", u);
+	//v = enc_read_reg(ENC_REG_EDMADSTH);    u = (((unsigned)(v & 0x1F)) << 8);
+	//u |= enc_read_reg(ENC_REG_EDMADSTL);   ENC_DEBUG("EDMADST %4x\n", u);
+	//v = enc_read_reg(ENC_REG_EDMACSH);     u = (((unsigned)(v & 0x1F)) << 8);
+	//u |= enc_read_reg(ENC_REG_EDMACSL);    ENC_DEBUG("EDMACS %4x\n", u);
+
+	//v = enc_read_reg(ENC_REG_EHT0);        ENC_DEBUG("EHT0 %2x\n", (unsigned) v);
+	//v = enc_read_reg(ENC_REG_EHT1);        ENC_DEBUG("EHT1 %2x\n", (unsigned) v);
+	//v = enc_read_reg(ENC_REG_EHT2);        ENC_DEBUG("EHT2 %2x\n", (unsigned) v);
+	//v = enc_read_reg(ENC_REG_EHT3);        ENC_DEBUG("EHT3 %2x\n", (unsigned) v);
+	//v = enc_read_reg(ENC_REG_EHT4);        ENC_DEBUG("EHT4 %2x\n", (unsigned) v);
+	//v = enc_read_reg(ENC_REG_EHT5);        ENC_DEBUG("EHT5 %2x\n", (unsigned) v);
+	//v = enc_read_reg(ENC_REG_EHT6);        ENC_DEBUG("EHT6 %2x\n", (unsigned) v);
+	//v = enc_read_reg(ENC_REG_EHT7);        ENC_DEBUG("EHT7 %2x\n", (unsigned) v);
+
+	//v = enc_read_reg(ENC_REG_EPMM0);       ENC_DEBUG("EPMM0 %2x\n", (unsigned) v);
+	//v = enc_read_reg(ENC_REG_EPMM1);       ENC_DEBUG("EPMM1 %2x\n", (unsigned) v);
+	//v = enc_read_reg(ENC_REG_EPMM2);       ENC_DEBUG("EPMM2 %2x\n", (unsigned) v);
+	//v = enc_read_reg(ENC_REG_EPMM3);       ENC_DEBUG("EPMM3 %2x\n", (unsigned) v);
+	//v = enc_read_reg(ENC_REG_EPMM4);       ENC_DEBUG("EPMM4 %2x\n", (unsigned) v);
+	//v = enc_read_reg(ENC_REG_EPMM5);       ENC_DEBUG("EPMM5 %2x\n", (unsigned) v);
+	//v = enc_read_reg(ENC_REG_EPMM6);       ENC_DEBUG("EPMM6 %2x\n", (unsigned) v);
+	//v = enc_read_reg(ENC_REG_EPMM7);       ENC_DEBUG("EPMM7 %2x\n", (unsigned) v);
+
+	//v = enc_read_reg(ENC_REG_EPMCSH);      u = (((unsigned)(v & 0x1F)) << 8);
+	//u |= enc_read_reg(ENC_REG_EPMCSL);     ENC_DEBUG("EPMCS %4x\n", u);
+	//v = enc_read_reg(ENC_REG_EPMOH);       u = (((unsigned)(v & 0x1F)) << 8);
+	//u |= enc_read_reg(ENC_REG_EPMOL);      ENC_DEBUG("EPMO %4x\n", u);
+
+	//v = enc_read_reg(ENC_REG_EWOLIE);      ENC_DEBUG("EWOLIE %2x\n", (unsigned) v);
+	//v = enc_read_reg(ENC_REG_EWOLIR);      ENC_DEBUG("EWOLIR %2x\n", (unsigned) v);
+
+	v = enc_read_reg(ENC_REG_ERXFCON);     ENC_DEBUG("ERXFCON %2x\n", (unsigned) v);
+	v = enc_read_reg(ENC_REG_EPKTCNT);     ENC_DEBUG("EPKTCNT %2x\n", (unsigned) v);
+
+	v = enc_read_reg(ENC_REG_MACON1);      ENC_DEBUG("MACON1 %2x\n", (unsigned) v);
+	v = enc_read_reg(ENC_REG_MACON2);      ENC_DEBUG("MACON2 %2x\n", (unsigned) v);
+	v = enc_read_reg(ENC_REG_MACON3);      ENC_DEBUG("MACON3 %2x\n", (unsigned) v);
+	v = enc_read_reg(ENC_REG_MACON4);      ENC_DEBUG("MACON4 %2x\n", (unsigned) v);
+	v = enc_read_reg(ENC_REG_MABBIPG);     ENC_DEBUG("MABBIPG %2x\n", (unsigned) v);
+	v = enc_read_reg(ENC_REG_MAIPGH);      u = (((unsigned)(v & 0x1F)) << 8);
+	u |= enc_read_reg(ENC_REG_MAIPGL);     ENC_DEBUG("MAIPG %4x\n", u);
+	v = enc_read_reg(ENC_REG_MACLCON1);    ENC_DEBUG("MACLCON1 %2x\n", (unsigned) v);
+	v = enc_read_reg(ENC_REG_MACLCON2);    ENC_DEBUG("MACLCON2 %2x\n", (unsigned) v);
+
+	v = enc_read_reg(ENC_REG_MAMXFLH);     u = (((unsigned)(v & 0x1F)) << 8);
+	u |= enc_read_reg(ENC_REG_MAMXFLL);    ENC_DEBUG("MAMXFL %4x\n", u);
+	v = enc_read_reg(ENC_REG_MAPHSUP);     ENC_DEBUG("MAPHSUP %2x\n", (unsigned) v);
+
+	v = enc_read_reg(ENC_REG_MICON);       ENC_DEBUG("MICON %2x\n", (unsigned) v);
+
+	//v = enc_read_reg(ENC_REG_MICMD);       ENC_DEBUG("MICMD %2x\n", (unsigned) v);
+	//v = enc_read_reg(ENC_REG_MIREGADR);    ENC_DEBUG("MIREGADR %2x\n", (unsigned) v);
+	//v = enc_read_reg(ENC_REG_MIWRH);       u = (((unsigned)(v & 0x1F)) << 8);
+	//u |= enc_read_reg(ENC_REG_MIWRL);      ENC_DEBUG("MIWR %4x\n", u);
+	//v = enc_read_reg(ENC_REG_MIRDH);       u = (((unsigned)(v & 0x1F)) << 8);
+	//u |= enc_read_reg(ENC_REG_MIRDL);      ENC_DEBUG("MIRD %4x\n", u);
+
+	//v = enc_read_reg(ENC_REG_MAADR5);      ENC_DEBUG("MAADR5 %2x\n", (unsigned) v);
+	//v = enc_read_reg(ENC_REG_MAADR4);      ENC_DEBUG("MAADR4 %2x\n", (unsigned) v);
+	//v = enc_read_reg(ENC_REG_MAADR3);      ENC_DEBUG("MAADR3 %2x\n", (unsigned) v);
+	//v = enc_read_reg(ENC_REG_MAADR2);      ENC_DEBUG("MAADR2 %2x\n", (unsigned) v);
+	//v = enc_read_reg(ENC_REG_MAADR1);      ENC_DEBUG("MAADR1 %2x\n", (unsigned) v);
+	//v = enc_read_reg(ENC_REG_MAADR0);      ENC_DEBUG("MAADR0 %2x\n", (unsigned) v);
+
+	v = enc_read_reg(ENC_REG_EBSTSD);      ENC_DEBUG("EBSTSD %2x\n", (unsigned) v);
+	v = enc_read_reg(ENC_REG_EBSTCON);     ENC_DEBUG("EBSTCON %2x\n", (unsigned) v);
+	v = enc_read_reg(ENC_REG_EBSTCSH);     u = (((unsigned)(v & 0x1F)) << 8);
+	u |= enc_read_reg(ENC_REG_EBSTCSL);    ENC_DEBUG("EBSTCS %4x\n", u);
+
+	v = enc_read_reg(ENC_REG_MISTAT);      ENC_DEBUG("MISTAT %2x\n", (unsigned) v);
+
+	v = enc_read_reg(ENC_REG_EREVID);      ENC_DEBUG("EREVID %2x\n", (unsigned) v);
+	v = enc_read_reg(ENC_REG_ECOCON);      ENC_DEBUG("ECOCON %2x\n", (unsigned) v);
+	v = enc_read_reg(ENC_REG_EFLOCON);     ENC_DEBUG("EFLOCON %2x\n", (unsigned) v);
+	v = enc_read_reg(ENC_REG_EPAUSH);      u = (((unsigned)(v & 0x1F)) << 8);
+	u |= enc_read_reg(ENC_REG_EPAUSL);     ENC_DEBUG("EPAUS %4x\n", u);
+
+	u = enc_read_phyreg(ENC_REG_PHCON1);   ENC_DEBUG("PHCON1 %4x\n", u);
+	u = enc_read_phyreg(ENC_REG_PHSTAT1);  ENC_DEBUG("PHSTAT1 %4x\n", u);
+	u = enc_read_phyreg(ENC_REG_PHID1);    ENC_DEBUG("PHID1 %4x\n", u);
+	u = enc_read_phyreg(ENC_REG_PHID2);    ENC_DEBUG("PHID2 %4x\n", u);
+	u = enc_read_phyreg(ENC_REG_PHCON2);   ENC_DEBUG("PHCON2 %4x\n", u);
+	u = enc_read_phyreg(ENC_REG_PHSTAT2);  ENC_DEBUG("PHSTAT2 %4x\n", u);
+	u = enc_read_phyreg(ENC_REG_PHIE);     ENC_DEBUG("PHIE %4x\n", u);
+	u = enc_read_phyreg(ENC_REG_PHIR);     ENC_DEBUG("PHIR %4x\n", u);
+	u = enc_read_phyreg(ENC_REG_PHLCON);   ENC_DEBUG("PHLCON %4x\n", u);
+}
+#endif
+
+//-----------------------------------------------------------------------------
+
+// one's complement sum as the dma checksum has it, first byte high
+static u16 ICACHE_FLASH_ATTR enc_spi_test_sum( const u8 *buf, u16 len )
+{
+	u32 sum = 0;
+	u16 i;
+
+	for( i = 0; i + 1 < len; i += 2 ) sum += (buf[i] << 8) | buf[i+1];
+	if( len & 1 ) sum += buf[len-1] << 8;
+	while( sum >> 16 ) sum = (sum & 0xFFFF) + (sum >> 16);
+	return ~sum & 0xFFFF;
+}
+
+// writes a pattern to sram and reads it back, the dma checksum checks what
+// actually landed there independent of the read. Receive has to be off
+static u8 ICACHE_FLASH_ATTR enc_spi_test( u8 pass )
+{
+	u8  out[ENC_SPI_TEST_LEN], in[ENC_SPI_TEST_LEN];
+	u32 x = 0x1234 + pass;
+	u16 i, cs;
+	u8  ms = 10;
+
+	// alternating, walking one, walking zero, pseudo random
+	for( i = 0; i < ENC_SPI_TEST_LEN; i++ ) {
+		switch( pass & 3 ) {
+			case 0:  out[i] = (i & 1) ? 0xAA : 0x55; break;
+			case 1:  out[i] = 1 << (i & 7); break;
+			case 2:  out[i] = ~(1 << (i & 7)); break;
+			default: x = x * 1103515245 + 12345; out[i] = x >> 16; break;
+		}
+	}
+
+	enc_write_reg( ENC_REG_EWRPTL, LO8(ENC_SPI_TEST_ADDR) );
+	enc_write_reg( ENC_REG_EWRPTH, HI8(ENC_SPI_TEST_ADDR) );
+	enc_write_data( out, ENC_SPI_TEST_LEN );
+	enc_write_reg( ENC_REG_ERDPTL, LO8(ENC_SPI_TEST_ADDR) );
+	enc_write_reg( ENC_REG_ERDPTH, HI8(ENC_SPI_TEST_ADDR) );
+	enc_read_buf( in, ENC_SPI_TEST_LEN );
+	if( os_memcmp( in, out, ENC_SPI_TEST_LEN ) != 0 ) return 0;
+
+	// register writes read back, then the dma checksum over the pattern
+	enc_write_reg( ENC_REG_EDMASTL, LO8(ENC_SPI_TEST_ADDR) );
+	enc_write_reg( ENC_REG_EDMASTH, HI8(ENC_SPI_TEST_ADDR) );
+	enc_write_reg( ENC_REG_EDMANDL, LO8(ENC_SPI_TEST_ADDR + ENC_SPI_TEST_LEN - 1) );
+	enc_write_reg( ENC_REG_EDMANDH, HI8(ENC_SPI_TEST_ADDR + ENC_SPI_TEST_LEN - 1) );
+	if(    enc_read_reg( ENC_REG_EDMASTL ) != LO8(ENC_SPI_TEST_ADDR)
+	    || enc_read_reg( ENC_REG_EDMANDH ) != HI8(ENC_SPI_TEST_ADDR + ENC_SPI_TEST_LEN - 1) ) {
+		return 0;
+	}
+	enc_setbits_reg( ENC_REG_ECON1, (1<<ENC_BIT_CSUMEN) | (1<<ENC_BIT_DMAST) );
+	while( (enc_read_reg( ENC_REG_ECON1 ) & (1<<ENC_BIT_DMAST)) && ms-- ) usdelay( 1000 );
+	enc_clrbits_reg( ENC_REG_ECON1, (1<<ENC_BIT_CSUMEN) | (1<<ENC_BIT_DMAST) );
+	cs  = enc_read_reg( ENC_REG_EDMACSH ) << 8;
+	cs |= enc_read_reg( ENC_REG_EDMACSL );
+	return cs == enc_spi_test_sum( out, ENC_SPI_TEST_LEN );
+}
+
+// steps the spi clock up from the default until a test fails and settles a
+// step below the fastest that passed every round. Returns the predivider
+static u8 ICACHE_FLASH_ATTR enc_spi_calibrate( void )
+{
+	u8 prediv, best = SPI_CLK_PREDIV, r;
+
+	for( prediv = SPI_CLK_PREDIV; prediv >= ENC_SPI_PREDIV_MIN; prediv-- ) {
+		spi_clock( SPI_USED, prediv, SPI_CLK_CNTDIV );
+		for( r = 0; r < ENC_SPI_CAL_ROUNDS; r++ ) {
+			if( !enc_spi_test( r ) ) break;
+		}
+		ENC_DEBUG("enc spi %u kHz: %s\n", 80000 / (prediv * SPI_CLK_CNTDIV),
+		          r < ENC_SPI_CAL_ROUNDS ? "failed" : "ok");
+		if( r < ENC_SPI_CAL_ROUNDS ) break;
+		best = prediv;
+	}
+	if( best < SPI_CLK_PREDIV ) best++;
+	spi_clock( SPI_USED, best, SPI_CLK_CNTDIV );
+	return best;
+}
+
+//-----------------------------------------------------------------------------
+
+// chip selects driven by hand go back to gpio after spi_init, all of them -
+// one left on the HSPI cs pin would be selected along with every other
+static void ICACHE_FLASH_ATTR enc_cs_setup( void )
+{
+	u8 n;
+
+	for( n = 0; n < ENC_DEVICES; n++ ) {
+		enc_dev[n].cs_gpio  = enc_cs_pins[n].gpio;
+		enc_dev[n].int_gpio = enc_int_pins[n].gpio;
+		if( enc_cs_pins[n].gpio == ENC_CS_HSPI ) continue;
+		PIN_FUNC_SELECT( enc_cs_pins[n].mux, enc_cs_pins[n].func );
+		GPIO_OUTPUT_SET( enc_cs_pins[n].gpio, 1 );
+	}
+}
+
+// inits the current device. The reset line is shared, the hardware reset
+// comes with device 0 only - it takes the others down too, they have to be
+// inited again after it
+void ICACHE_FLASH_ATTR enc_init(void)
+{
+	int i=0, j=0;
+	u16 u;
+	u8 r, d;
+	u8 n = enc_cur - enc_dev;
+	
+  //ENC Hardware Reset
+  if (n == 0) {
+    gpio_output_set(0, (1<<ENCRESETGPIO), (1<<ENCRESETGPIO), 0);  
+    os_delay_us(200000);
+    gpio_output_set((1<<ENCRESETGPIO), 0, (1<<ENCRESETGPIO), 0);  
+    os_delay_us(200000);
+  }
+  
+	// init spi, then the chip selects
+	spi_init(SPI_USED);
+	enc_cs_setup();
+
+	// send a reset command via spi to the enc, it is back in bank 0
+	enc_reset();
+	enc_cur->cur_bank = 0;
+
+	// wait for the CLKRDY bit
+	while( !(enc_read_reg( ENC_REG_ESTAT ) & (1<<ENC_BIT_CLKRDY)) ) ;
+
+	// spi clock from sysCfg, calibrated once if there is none. The bus is
+	// shared, device 0 calibrates it for all. The test patterns went to sram
+	// and registers, the enc is reset again after it
+	if( sysCfg.enc_spi_prediv >= ENC_SPI_PREDIV_MIN && sysCfg.enc_spi_prediv <= SPI_CLK_PREDIV ) {
+		spi_clock( SPI_USED, sysCfg.enc_spi_prediv, SPI_CLK_CNTDIV );
+	} else if( n == 0 ) {
+		sysCfg.enc_spi_prediv = enc_spi_calibrate();
+		ENC_DEBUG("enc spi clock %u kHz\n", 80000 / (sysCfg.enc_spi_prediv * SPI_CLK_CNTDIV));
+		CFG_Save();
+		enc_reset();
+		enc_cur->cur_bank = 0;
+		while( !(enc_read_reg( ENC_REG_ESTAT ) & (1<<ENC_BIT_CLKRDY)) ) ;
+	}
+
+	// the reset turned flow control off
+	enc_cur->flow_on = 0;
+
+	// get enc revision id
+	enc_cur->revid = enc_read_reg( ENC_REG_EREVID );
+	ENC_DEBUG("enc revid %x\n", (int) enc_cur->revid);
+
+	// duplex the LEDB strap selected, before anything writes PHCON1
+	if( enc_cur->duplex_strap == ENC_DUPLEX_AUTO ) {
+		enc_cur->duplex_strap = (enc_read_phyreg( ENC_REG_PHCON1 ) & (1 << ENC_BIT_PDPXMD))
+		                        ? ENC_DUPLEX_FULL : ENC_DUPLEX_HALF;
+	}
+  
+  //MAC Address
+  #ifdef USE_SEPARATE_ENC_MAC
+    //MAC Adresse setzen
+    enc_cur->mac[0] = MYMAC1;
+    enc_cur->mac[1] = MYMAC2;
+    enc_cur->mac[2] = MYMAC3;
+    enc_cur->mac[3] = MYMAC4;
+    enc_cur->mac[4] = MYMAC5;
+    enc_cur->mac[5] = MYMAC6 + n;
+  #else
+    //Station MAC for the first, AP MAC for a second device
+    wifi_get_macaddr(n ? SOFTAP_IF : STATION_IF, enc_cur->mac);
+    ENC_DEBUG("\""MACSTR"\"\r\n", MAC2STR(enc_cur->mac));
+	#endif
+
+	// setup enc registers according to the enc_configdata struct
+	while(i < sizeof(enc_configdata)) {
+		r = enc_configdata[i++];    
+		d = enc_configdata[i++];
+		if(r == ENC_REG_MAADR5) break;
+		enc_write_reg( r, d );
+	}
+  
+  // load mac 
+  i-=2;  // to keep with the loading method, ease of understanding
+  for (j=0;j<6;j++) {
+    r = enc_configdata[i]; 
+    d = enc_cur->mac[j];
+    i+=2;
+    enc_write_reg( r, d );   
+  }
+  
+  //ENC_DEBUG("finished enc registers, cu bank = %u\r\n", enc_cur->cur_bank);
+  
+  //enc_regdump(); 
+  
+	// now the phy registers
+	while(i < sizeof(enc_configdata)) {
+		r = enc_configdata[i++];
+		d = enc_configdata[i++];
+		if( r == 0xFF && d == 0xFF ) break;
+		u = (((u16)d) << 8);
+		d = enc_configdata[i++];
+		u |= d;
+		enc_write_phyreg( r, u );
+	}
+  
+	// buffers and duplex, sets up the receive next packet pointer
+	enc_configure();
+
+	// link changes raise LINKIF, PHIR is read once to clear what the reset left
+	enc_write_phyreg( ENC_REG_PHIE, (1 << ENC_BIT_PLNKIE) | (1 << ENC_BIT_PGEIE) );
+	enc_read_phyreg( ENC_REG_PHIR );
+
+	// configure the enc interrupt sources
+	enc_write_reg( ENC_REG_EIE, ENC_EIE_SETUP );
+
+	enc_rx_multicast(enc_cur->multicast);
+
+	// enable receive
+	enc_setbits_reg( ENC_REG_ECON1, (1<<ENC_BIT_RXEN) );
+}
+
+//-----------------------------------------------------------------------------
+//Receive filter - unicast to us and broadcast always, multicast on request
+//(all groups, the stack sorts out the ones it has joined)
+void ICACHE_FLASH_ATTR enc_rx_multicast( u8 on )
+{
+	enc_cur->multicast = on;
+	enc_write_reg( ENC_REG_ERXFCON, ENC_ERXFCON_SETUP(on) );
+}
+
+//-----------------------------------------------------------------------------
+
+//LED blink test
+void ICACHE_FLASH_ATTR enc28j60_led_blink (u8 a)
+{
+	if(a)
+	{
 		//set up leds: LEDA: link status, LEDB: RX&TX activity, stretch 40ms, stretch enable
-		enc_write_phyreg(ENC_REG_PHLCON, 0x321A);
-	}
-	else
-	{
+		enc_write_phyreg(ENC_REG_PHLCON, 0x321A);
+	}
+	else
+	{
 		//set up leds: LEDA: link status, LEDB: RX&TX activity, stretch 40ms, stretch enable
 		enc_write_phyreg(ENC_REG_PHLCON, 0x347A); //cave: Table3-3: reset value is 0x3422, do not modify the reserved "3"!!
-		//RevA Datasheet page 9: write as '0000', see RevB Datasheet: write 0011!
-	}
-}
-
+		//RevA Datasheet page 9: write as '0000', see RevB Datasheet: write 0011!
+	}
+}
+
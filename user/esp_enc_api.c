@@ -1,104 +1,418 @@
-/*
------------------------------------------------------------------------------------------
-Author:         Mark F (Cicero-MF) mark@cdelec.co.za    
-Known Issues:   none
-Version:        22.05.2016
-Description:    API or 'tunnel' for espconn and enc28j60 stack callbacks and setup
-
------------------------------------------------------------------------------------------
-*/
-#include "esp8266.h"
-#include "httpd.h"
-#include "stack.h"
-#include "esp_enc_api.h"
-
-/* Use this to send data - it looks at the type field to determine interface */
-sint8 esp_enc_api_sendData (struct espconn *conn, u8* dataIn, int len) {
-  if (conn->type != ESPCONN_TCP_WIRED) {
-    return espconn_sent(conn, dataIn, len);
-  } else {
-    return stack_sendData(conn, dataIn, len);
-  }  
-}
- 
-/* Use this to disconnect */
-sint8 esp_enc_api_disconnect (struct espconn *espconn) {
-  if (espconn->type != ESPCONN_TCP_WIRED) {
-    return espconn_disconnect(espconn);
-  } else {
-    stack_connDisconnect (espconn);
-    return 1;
-  }  
-} 
-
-/* Use this to register the correct callback for receiving */
-sint8 esp_enc_api_regist_recvcb (struct espconn *espconn, espconn_recv_callback recv_cb) {
-  if (espconn->type != ESPCONN_TCP_WIRED) {
-    return espconn_regist_recvcb(espconn, recv_cb);
-  } else {
-    espconn->recv_callback = recv_cb;
-    return 1;
-  }  
-}
-  
-
-/* Use this to register the correct callback for receiving */
-sint8 esp_enc_api_regist_reconcb (struct espconn *espconn, espconn_reconnect_callback recon_cb) {
-  if (espconn->type != ESPCONN_TCP_WIRED) {
-    return espconn_regist_reconcb(espconn, recon_cb);
-  } else {
-    espconn->proto.tcp->reconnect_callback = recon_cb;
-    return 1;
-  }  
-}  
-	
-/* Use this to register the disconnect callback */
-sint8 esp_enc_api_regist_disconcb (struct espconn *espconn, espconn_connect_callback discon_cb) {
-  if (espconn->type != ESPCONN_TCP_WIRED) {
-    return espconn_regist_disconcb(espconn, discon_cb);
-  } else {
-    espconn->proto.tcp->disconnect_callback = discon_cb;
-    return 1;
-  }  
-}   
-  
-/* Use this to register the sent callback */
-sint8 esp_enc_api_regist_sentcb (struct espconn *espconn, espconn_sent_callback sent_cb) {
-  if (espconn->type != ESPCONN_TCP_WIRED) {
-    return espconn_regist_sentcb(espconn, sent_cb);
-  } else {
-    espconn->sent_callback = sent_cb;
-    return 1;
-  }  
-}
-
-
-/* Use this to register the connect callback */
-sint8 esp_enc_api_regist_connectcb (struct espconn *espconn, espconn_connect_callback connect_cb) {
-  if (espconn->type != ESPCONN_TCP_WIRED) {
-    return espconn_regist_connectcb(espconn, connect_cb);
-  } else {
-    espconn->proto.tcp->connect_callback = connect_cb;
-    return 1;
-  }  
-}
-
-	
-/* Use this to accept */
-sint8 esp_enc_api_connaccept (struct espconn *espconn, u8 stack_func) {
-  if (espconn->type != ESPCONN_TCP_WIRED) {
-   return espconn_accept(espconn);
-  } else {
-    return stack_register_tcp_accept(espconn, stack_func);
-  }  
-}   
-  
-/* Use this to set max connections allowed */
-sint8 esp_enc_api_tcp_set_max_con_allowed (struct espconn *espconn, uint8 num) {
-  if (espconn->type != ESPCONN_TCP_WIRED) {
-    return espconn_tcp_set_max_con_allow(espconn, num);
-  } else {
-    /* FIXME: Set max conns allowed by stack.c for httpd */
-    return 1;
-  }  
-}     
+/*
+-----------------------------------------------------------------------------------------
+Author:         Mark F (Cicero-MF) mark@cdelec.co.za    
+Known Issues:   none
+Version:        22.05.2016
+Description:    API or 'tunnel' for espconn and enc28j60 stack callbacks and setup
+
+-----------------------------------------------------------------------------------------
+*/
+#include "esp8266.h"
+#include "httpd.h"
+#include "stack.h"
+#include "esp_enc_api.h"
+
+/* Use this to send data - it looks at the type field to determine interface */
+sint8 esp_enc_api_sendData (struct espconn *conn, u8* dataIn, int len) {
+  if (!ESPCONN_IS_WIRED(conn)) {
+    return espconn_sent(conn, dataIn, len);
+  } else if (conn->type == ESPCONN_UDP_WIRED) {
+    return stack_udpSendTo(conn, dataIn, len);
+  } else {
+    return stack_sendData(conn, dataIn, len);
+  }  
+}
+ 
+/* Use this to send data in several pieces as one - the wired side gathers
+  them into its send buffer, wifi needs them in one buffer first */
+sint8 esp_enc_api_sendv (struct espconn *conn, const esp_enc_iovec *iov, u8 iovcnt) {
+  u16 len = 0;
+  u8 *buf, *p;
+  sint8 ret;
+  u8 i;
+  
+  if (conn->type == ESPCONN_TCP_WIRED) {
+    return stack_sendv(conn, iov, iovcnt);
+  }
+  if (iovcnt == 1) {
+    return esp_enc_api_sendData(conn, (u8 *)iov[0].base, iov[0].len);
+  }
+  
+  for (i = 0; i < iovcnt; i++) {
+    len += iov[i].len;
+  }
+  buf = (u8 *)os_malloc(len);
+  if (!buf) {
+    return ESPCONN_MEM;
+  }
+  for (i = 0, p = buf; i < iovcnt; p += iov[i].len, i++) {
+    os_memcpy(p, iov[i].base, iov[i].len);
+  }
+  ret = esp_enc_api_sendData(conn, buf, len);
+  os_free(buf);
+  return ret;
+}
+
+/* Use this to send data straight from flash on a wired connection - it is
+  never read into RAM. Wifi can't do that, read it into a buffer there */
+sint8 esp_enc_api_send_flash (struct espconn *conn, u32 flash_addr, u16 len) {
+  if (conn->type != ESPCONN_TCP_WIRED) {
+    return ESPCONN_ARG;
+  } else {
+    return stack_sendFlash(conn, flash_addr, len);
+  }  
+}
+
+/* Use this to prioritise a connection's data on the wire, wifi has no equivalent */
+sint8 esp_enc_api_set_tx_class (struct espconn *conn, u8 tx_class) {
+  if (conn->type != ESPCONN_TCP_WIRED) {
+    return ESPCONN_ARG;
+  } else {
+    return stack_setTxClass(conn, tx_class);
+  }  
+}
+
+/* Use this to stop data coming in while the app can't take it, and to let it flow again */
+sint8 esp_enc_api_recv_hold (struct espconn *conn) {
+  if (conn->type != ESPCONN_TCP_WIRED) {
+    return espconn_recv_hold(conn);
+  } else {
+    return stack_recvHold(conn, 1);
+  }  
+}
+
+sint8 esp_enc_api_recv_unhold (struct espconn *conn) {
+  if (conn->type != ESPCONN_TCP_WIRED) {
+    return espconn_recv_unhold(conn);
+  } else {
+    return stack_recvHold(conn, 0);
+  }  
+}
+
+/* Use this to disconnect */
+sint8 esp_enc_api_disconnect (struct espconn *espconn) {
+  if (espconn->type != ESPCONN_TCP_WIRED) {
+    return espconn_disconnect(espconn);
+  } else {
+    stack_connDisconnect (espconn);
+    return 1;
+  }  
+} 
+
+/* Use this to register the correct callback for receiving */
+sint8 esp_enc_api_regist_recvcb (struct espconn *espconn, espconn_recv_callback recv_cb) {
+  if (!ESPCONN_IS_WIRED(espconn)) {
+    return espconn_regist_recvcb(espconn, recv_cb);
+  } else {
+    espconn->recv_callback = recv_cb;
+    return 1;
+  }  
+}
+  
+
+/* Use this to register the correct callback for receiving */
+sint8 esp_enc_api_regist_reconcb (struct espconn *espconn, espconn_reconnect_callback recon_cb) {
+  if (espconn->type != ESPCONN_TCP_WIRED) {
+    return espconn_regist_reconcb(espconn, recon_cb);
+  } else {
+    espconn->proto.tcp->reconnect_callback = recon_cb;
+    return 1;
+  }  
+}  
+	
+/* Use this to register the disconnect callback */
+sint8 esp_enc_api_regist_disconcb (struct espconn *espconn, espconn_connect_callback discon_cb) {
+  if (espconn->type != ESPCONN_TCP_WIRED) {
+    return espconn_regist_disconcb(espconn, discon_cb);
+  } else {
+    espconn->proto.tcp->disconnect_callback = discon_cb;
+    return 1;
+  }  
+}   
+  
+/* Use this to register the sent callback */
+sint8 esp_enc_api_regist_sentcb (struct espconn *espconn, espconn_sent_callback sent_cb) {
+  if (!ESPCONN_IS_WIRED(espconn)) {
+    return espconn_regist_sentcb(espconn, sent_cb);
+  } else {
+    espconn->sent_callback = sent_cb;
+    return 1;
+  }  
+}
+
+
+/* Use this to register the connect callback */
+sint8 esp_enc_api_regist_connectcb (struct espconn *espconn, espconn_connect_callback connect_cb) {
+  if (espconn->type != ESPCONN_TCP_WIRED) {
+    return espconn_regist_connectcb(espconn, connect_cb);
+  } else {
+    espconn->proto.tcp->connect_callback = connect_cb;
+    return 1;
+  }  
+}
+
+	
+/* Use this to accept */
+sint8 esp_enc_api_connaccept (struct espconn *espconn, u8 stack_func) {
+  if (espconn->type != ESPCONN_TCP_WIRED) {
+   return espconn_accept(espconn);
+  } else {
+    return stack_register_tcp_accept(espconn, stack_func);
+  }  
+}   
+  
+/* Use this to set how long an idle connection lives - idle_time sec. without a
+   word from the peer, then keepalive_cnt probes keepalive_intvl sec. apart */
+sint8 esp_enc_api_set_idle_policy (struct espconn *espconn, u16 idle_time, u8 keepalive_intvl, u8 keepalive_cnt) {
+  if (espconn->type != ESPCONN_TCP_WIRED) {
+    return espconn_regist_time(espconn, idle_time, 0);
+  } else {
+    return stack_setIdlePolicy(espconn->proto.tcp->local_port, idle_time, keepalive_intvl, keepalive_cnt);
+  }  
+}
+
+/* Use this to connect out, the connect / reconnect callbacks tell how it went */
+sint8 esp_enc_api_connect (struct espconn *espconn) {
+  if (espconn->type != ESPCONN_TCP_WIRED) {
+    return espconn_connect(espconn);
+  } else {
+    return stack_connect(espconn);
+  }  
+}
+
+/* Use this to set max connections allowed */
+sint8 esp_enc_api_tcp_set_max_con_allowed (struct espconn *espconn, uint8 num) {
+  if (espconn->type != ESPCONN_TCP_WIRED) {
+    return espconn_tcp_set_max_con_allow(espconn, num);
+  } else {
+    /* FIXME: Set max conns allowed by stack.c for httpd */
+    return 1;
+  }  
+}     
+
+/* UDP sockets - type ESPCONN_UDP_WIRED for the ENC, proto.udp as for espconn_create.
+   The recv callback finds the sender in proto.udp->remote_ip/remote_port */
+sint8 esp_enc_api_udp_create (struct espconn *espconn) {
+  if (!ESPCONN_IS_WIRED(espconn)) {
+    return espconn_create(espconn);
+  } else {
+    return stack_udpCreate(espconn);
+  }  
+}
+
+sint8 esp_enc_api_udp_delete (struct espconn *espconn) {
+  if (!ESPCONN_IS_WIRED(espconn)) {
+    return espconn_delete(espconn);
+  } else {
+    return stack_udpDelete(espconn);
+  }  
+}
+
+/* Use this to send a datagram to proto.udp->remote_ip/remote_port - broadcast
+   and multicast addresses included */
+sint8 esp_enc_api_sendto (struct espconn *espconn, u8 *dataIn, u16 len) {
+  if (!ESPCONN_IS_WIRED(espconn)) {
+    return espconn_sendto(espconn, dataIn, len);
+  } else {
+    return stack_udpSendTo(espconn, dataIn, len);
+  }  
+}
+
+/* Use this to join / leave a multicast group on the interface of espconn */
+sint8 esp_enc_api_igmp_join (struct espconn *espconn, ip_addr_t *multicast_ip) {
+  struct ip_info info;
+  
+  if (!ESPCONN_IS_WIRED(espconn)) {
+    wifi_get_ip_info(STATION_IF, &info);
+    return espconn_igmp_join(&info.ip, multicast_ip);
+  } else {
+    return stack_igmpJoin(multicast_ip->addr);
+  }  
+}
+
+sint8 esp_enc_api_igmp_leave (struct espconn *espconn, ip_addr_t *multicast_ip) {
+  struct ip_info info;
+  
+  if (!ESPCONN_IS_WIRED(espconn)) {
+    wifi_get_ip_info(STATION_IF, &info);
+    return espconn_igmp_leave(&info.ip, multicast_ip);
+  } else {
+    return stack_igmpLeave(multicast_ip->addr);
+  }  
+}
+
+/* Routing ----------------------------------------------------------------
+  Picks the interface for traffic of ours: a static route if one matches,
+  else the interface whose subnet the destination is on, else the preferred
+  one - as long as it is up. The wire is preferred, wifi is the fallback */
+typedef struct {
+  u32 net;
+  u32 mask;   /* 0 = unused */
+  u8  iface;
+} esp_enc_route;
+
+static esp_enc_route routes[ESP_ENC_ROUTES];
+static struct espconn *routed_sessions[ESP_ENC_SESSIONS];
+static u8 route_preference = ESP_ENC_IF_WIRED;
+static u8 wired_up = 0;
+
+static u8 ICACHE_FLASH_ATTR route_if_up (u8 iface) {
+  if (iface == ESP_ENC_IF_WIRED) {
+    /* Link up and a port with an address */
+    return wired_up && eth_if_route(0) != ETH_IF_NONE;
+  }
+  if (iface == ESP_ENC_IF_WIFI) {
+    return wifi_station_get_connect_status() == STATION_GOT_IP;
+  }
+  return 0;
+}
+
+/* Is dst_ip on the subnet of one of the wired ports? */
+static u8 ICACHE_FLASH_ATTR route_wired_onlink (u32 dst_ip) {
+  u8 n;
+  
+  for (n = 0; n < ENC_DEVICES; n++) {
+    u32 ip   = *((u32 *)&eth_if[n].myip[0]);
+    u32 mask = *((u32 *)&eth_if[n].netmask[0]);
+    
+    if (ip && mask && (dst_ip & mask) == (ip & mask)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* Use this to find the interface to reach dst_ip (network order) over,
+  ESP_ENC_IF_NONE if neither is up */
+u8 esp_enc_api_route (u32 dst_ip) {
+  struct ip_info info;
+  u8 i;
+  
+  for (i = 0; i < ESP_ENC_ROUTES; i++) {
+    if (routes[i].mask && (dst_ip & routes[i].mask) == routes[i].net && route_if_up(routes[i].iface)) {
+      return routes[i].iface;
+    }
+  }
+  
+  /* On-link on either side */
+  if (route_if_up(ESP_ENC_IF_WIRED) && route_wired_onlink(dst_ip)) {
+    return ESP_ENC_IF_WIRED;
+  }
+  if (route_if_up(ESP_ENC_IF_WIFI) && wifi_get_ip_info(STATION_IF, &info) && info.netmask.addr &&
+      (dst_ip & info.netmask.addr) == (info.ip.addr & info.netmask.addr)) {
+    return ESP_ENC_IF_WIFI;
+  }
+  
+  if (route_if_up(route_preference)) {
+    return route_preference;
+  }
+  if (route_preference == ESP_ENC_IF_WIRED) {
+    return route_if_up(ESP_ENC_IF_WIFI) ? ESP_ENC_IF_WIFI : ESP_ENC_IF_NONE;
+  }
+  return route_if_up(ESP_ENC_IF_WIRED) ? ESP_ENC_IF_WIRED : ESP_ENC_IF_NONE;
+}
+
+/* Use this to send net/mask (network order) over iface whenever it is up */
+sint8 esp_enc_api_route_add (u32 net, u32 mask, u8 iface) {
+  u8 i, slot = ESP_ENC_ROUTES;
+  
+  if (!mask || (iface != ESP_ENC_IF_WIRED && iface != ESP_ENC_IF_WIFI)) {
+    return ESPCONN_ARG;
+  }
+  for (i = 0; i < ESP_ENC_ROUTES; i++) {
+    if (routes[i].mask == mask && routes[i].net == (net & mask)) {
+      slot = i;
+      break;
+    }
+    if (!routes[i].mask && slot == ESP_ENC_ROUTES) {
+      slot = i;
+    }
+  }
+  if (slot == ESP_ENC_ROUTES) {
+    return ESPCONN_MEM;
+  }
+  routes[slot].net   = net & mask;
+  routes[slot].mask  = mask;
+  routes[slot].iface = iface;
+  return ESPCONN_OK;
+}
+
+sint8 esp_enc_api_route_del (u32 net, u32 mask) {
+  u8 i;
+  
+  for (i = 0; i < ESP_ENC_ROUTES; i++) {
+    if (routes[i].mask && routes[i].mask == mask && routes[i].net == (net & mask)) {
+      routes[i].mask = 0;
+      return ESPCONN_OK;
+    }
+  }
+  return ESPCONN_ARG;
+}
+
+/* Use this to pick the interface used when no route or subnet decides */
+void esp_enc_api_set_preference (u8 iface) {
+  route_preference = iface;
+}
+
+/* Use this to connect out over whatever esp_enc_api_route picks - the type
+  of espconn is set to match. Connections over the wire are reconnected over
+  wifi if the wire goes, the app gets its connect callback again */
+sint8 esp_enc_api_connect_routed (struct espconn *espconn) {
+  u32 dst_ip;
+  u8 i, slot = ESP_ENC_SESSIONS;
+  
+  os_memcpy(&dst_ip, espconn->proto.tcp->remote_ip, 4);
+  switch (esp_enc_api_route(dst_ip)) {
+    case ESP_ENC_IF_WIFI:
+      espconn->type = ESPCONN_TCP;
+      return espconn_connect(espconn);
+    case ESP_ENC_IF_WIRED:
+      break;
+    default:
+      return ESPCONN_RTE;
+  }
+  
+  /* Follow it, a slot whose connection is gone is free again */
+  for (i = 0; i < ESP_ENC_SESSIONS; i++) {
+    if (routed_sessions[i] == espconn ||
+        (slot == ESP_ENC_SESSIONS && (!routed_sessions[i] || !stack_connAlive(routed_sessions[i])))) {
+      slot = i;
+    }
+  }
+  espconn->type = ESPCONN_TCP_WIRED;
+  if (slot < ESP_ENC_SESSIONS) {
+    routed_sessions[slot] = espconn;
+  }
+  return stack_connect(espconn);
+}
+
+/* Wired link went up or down - the link tracker calls this on a change only */
+void esp_enc_api_link_change (u8 iface, u8 up) {
+  u8 i;
+  
+  if (iface != ESP_ENC_IF_WIRED) {
+    return;
+  }
+  wired_up = up;
+  if (up) {
+    return;
+  }
+  
+  /* Wired client connections can't move, their address is gone with the link.
+    Drop them quietly and connect again over wifi */
+  for (i = 0; i < ESP_ENC_SESSIONS; i++) {
+    struct espconn *conn = routed_sessions[i];
+    
+    routed_sessions[i] = NULL;
+    if (!conn || conn->type != ESPCONN_TCP_WIRED || !stack_connAbort(conn)) {
+      continue;
+    }
+    if (route_if_up(ESP_ENC_IF_WIFI)) {
+      conn->type = ESPCONN_TCP;
+      conn->proto.tcp->local_port = espconn_port();
+      espconn_connect(conn);
+    } else if (conn->proto.tcp->reconnect_callback) {
+      conn->proto.tcp->reconnect_callback(conn, ESPCONN_CONN);
+    }
+  }
+}
@@ -1,38 +1,77 @@
-	/*
------------------------------------------------------------------------------------------
-Author:         Mark F (Cicero-MF) mark@cdelec.co.za    
-Known Issues:   none
-Version:        18.05.2016
-Description:    Header for API or 'tunnel' for espconn and enc28j60 stack callbacks and setup
-
------------------------------------------------------------------------------------------
-*/
-#ifndef _ESP_ENC_API_H
-  #define _ESP_ENC_API_H
-
-  #include "esp8266.h"
-  #include "httpd.h"
-  
-  /* Sneaky addition to the type enum in struct espconn to distinguish ENC conns */
-  #define ESPCONN_TCP_WIRED 0x40
-  
-  /* Module types supported 
-    Add in what ever other module you need here, 
-    and make sure they're used in stack_register_tcp_accept()
-  */
-  #define STACK_NA      0x00
-  #define STACK_HTTPD   0x01
-  #define STACK_MQTT    0x02  
-
-  sint8 esp_enc_api_sendData (struct espconn *conn, u8* dataIn, int len);
-  sint8 esp_enc_api_disconnect (struct espconn *espconn);
-  sint8 esp_enc_api_regist_recvcb (struct espconn *espconn, espconn_recv_callback recv_cb);
-  sint8 esp_enc_api_regist_reconcb (struct espconn *espconn, espconn_reconnect_callback recon_cb);
-  sint8 esp_enc_api_regist_disconcb (struct espconn *espconn, espconn_connect_callback discon_cb);
-  sint8 esp_enc_api_regist_sentcb (struct espconn *espconn, espconn_sent_callback sent_cb);
-  sint8 esp_enc_api_regist_connectcb (struct espconn *espconn, espconn_connect_callback connect_cb);
-  sint8 esp_enc_api_connaccept (struct espconn *espconn, u8 stack_func);
-  sint8 esp_enc_api_tcp_set_max_con_allowed (struct espconn *espconn, uint8 num);
-
-
-#endif /* _ESP_ENC_API_H */
+	/*
+-----------------------------------------------------------------------------------------
+Author:         Mark F (Cicero-MF) mark@cdelec.co.za    
+Known Issues:   none
+Version:        18.05.2016
+Description:    Header for API or 'tunnel' for espconn and enc28j60 stack callbacks and setup
+
+-----------------------------------------------------------------------------------------
+*/
+#ifndef _ESP_ENC_API_H
+  #define _ESP_ENC_API_H
+
+  #include "esp8266.h"
+  #include "httpd.h"
+  
+  /* Sneaky addition to the type enum in struct espconn to distinguish ENC conns */
+  #define ESPCONN_TCP_WIRED 0x40
+  #define ESPCONN_UDP_WIRED 0x41
+  #define ESPCONN_IS_WIRED(espconn) (((espconn)->type & ESPCONN_TCP_WIRED) != 0)
+  
+  /* Module types supported 
+    Add in what ever other module you need here, 
+    and make sure they're used in stack_register_tcp_accept()
+  */
+  #define STACK_NA      0x00
+  #define STACK_HTTPD   0x01
+  #define STACK_MQTT    0x02  
+
+  /* Transmit classes for esp_enc_api_set_tx_class, see txqueue.h */
+  #define ESP_ENC_TX_AUTO         0x00
+  #define ESP_ENC_TX_INTERACTIVE  0x02
+  #define ESP_ENC_TX_BULK         0x03
+
+  /* Interfaces for the routing, see esp_enc_api_route */
+  #define ESP_ENC_IF_NONE   0x00
+  #define ESP_ENC_IF_WIRED  0x01
+  #define ESP_ENC_IF_WIFI   0x02
+  
+  #define ESP_ENC_ROUTES    4   /* static routes */
+  #define ESP_ENC_SESSIONS  4   /* routed connections moved to wifi when the wire goes */
+
+  /* One piece of a gathered send, see esp_enc_api_sendv */
+  typedef struct esp_enc_iovec {
+    const u8 *base;
+    u16 len;
+  } esp_enc_iovec;
+
+  sint8 esp_enc_api_sendData (struct espconn *conn, u8* dataIn, int len);
+  sint8 esp_enc_api_sendv (struct espconn *conn, const esp_enc_iovec *iov, u8 iovcnt);
+  sint8 esp_enc_api_send_flash (struct espconn *conn, u32 flash_addr, u16 len);
+  sint8 esp_enc_api_set_tx_class (struct espconn *conn, u8 tx_class);
+  sint8 esp_enc_api_recv_hold (struct espconn *conn);
+  sint8 esp_enc_api_recv_unhold (struct espconn *conn);
+  sint8 esp_enc_api_set_idle_policy (struct espconn *espconn, u16 idle_time, u8 keepalive_intvl, u8 keepalive_cnt);
+  sint8 esp_enc_api_connect (struct espconn *espconn);
+  sint8 esp_enc_api_disconnect (struct espconn *espconn);
+  sint8 esp_enc_api_regist_recvcb (struct espconn *espconn, espconn_recv_callback recv_cb);
+  sint8 esp_enc_api_regist_reconcb (struct espconn *espconn, espconn_reconnect_callback recon_cb);
+  sint8 esp_enc_api_regist_disconcb (struct espconn *espconn, espconn_connect_callback discon_cb);
+  sint8 esp_enc_api_regist_sentcb (struct espconn *espconn, espconn_sent_callback sent_cb);
+  sint8 esp_enc_api_regist_connectcb (struct espconn *espconn, espconn_connect_callback connect_cb);
+  sint8 esp_enc_api_connaccept (struct espconn *espconn, u8 stack_func);
+  sint8 esp_enc_api_tcp_set_max_con_allowed (struct espconn *espconn, uint8 num);
+  sint8 esp_enc_api_udp_create (struct espconn *espconn);
+  sint8 esp_enc_api_udp_delete (struct espconn *espconn);
+  sint8 esp_enc_api_sendto (struct espconn *espconn, u8 *dataIn, u16 len);
+  sint8 esp_enc_api_igmp_join (struct espconn *espconn, ip_addr_t *multicast_ip);
+  sint8 esp_enc_api_igmp_leave (struct espconn *espconn, ip_addr_t *multicast_ip);
+  u8    esp_enc_api_route (u32 dst_ip);
+  sint8 esp_enc_api_route_add (u32 net, u32 mask, u8 iface);
+  sint8 esp_enc_api_route_del (u32 net, u32 mask);
+  void  esp_enc_api_set_preference (u8 iface);
+  void  esp_enc_api_link_change (u8 iface, u8 up);
+  sint8 esp_enc_api_connect_routed (struct espconn *espconn);
+
+
+#endif /* _ESP_ENC_API_H */
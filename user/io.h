@@ -1,13 +1,33 @@
-#ifndef IO_H
-#define IO_H
-
-#define ENCRESETGPIO  4
-#define ENCINTGPIO    5
-#define BTNGPIO       0
-
-void ICACHE_FLASH_ATTR gpio16_output_set(uint8 value);
-
-void ICACHE_FLASH_ATTR ioLed(int ena);
-void ioInit(void);
-
-#endif
+#ifndef IO_H
+#define IO_H
+
+#include "globals.h"
+
+#define ENCRESETGPIO  4
+#define ENCINTGPIO    5
+#define BTNGPIO       0
+
+//ENC chip selects {gpio, io mux register, gpio function}. A single ENC uses
+//the HSPI cs pin, with more of them every one is a gpio driven by hand
+#if ENC_DEVICES > 1
+  #define ENC_CS_PINS   { 15, PERIPHS_IO_MUX_MTDO_U,  FUNC_GPIO15 }, \
+                        { 2,  PERIPHS_IO_MUX_GPIO2_U, FUNC_GPIO2 }
+#else
+  #define ENC_CS_PINS   { ENC_CS_HSPI, 0, 0 }
+#endif
+
+//ENC interrupt lines, same layout and order. The second one takes the UART0
+//RX pin, serial input is gone with two ENCs
+#if ENC_DEVICES > 1
+  #define ENC_INT_PINS  { ENCINTGPIO, PERIPHS_IO_MUX_GPIO5_U, FUNC_GPIO5 }, \
+                        { 3,          PERIPHS_IO_MUX_U0RXD_U, FUNC_GPIO3 }
+#else
+  #define ENC_INT_PINS  { ENCINTGPIO, PERIPHS_IO_MUX_GPIO5_U, FUNC_GPIO5 }
+#endif
+
+void ICACHE_FLASH_ATTR gpio16_output_set(uint8 value);
+
+void ICACHE_FLASH_ATTR ioLed(int ena);
+void ioInit(void);
+
+#endif
@@ -0,0 +1,209 @@
+/*-----------------------------------------------------------------------------------------
+Description:    IPv4 fragment reassembly for the enc28j60 stack
+
+-----------------------------------------------------------------------------------------
+License:
+  This program is free software; you can redistribute it and/or modify it under
+  the terms of the GNU General Public License as published by the Free Software
+  Foundation; either version 2 of the License, or (at your option) any later
+  version.
+  This program is distributed in the hope that it will be useful, but
+
+  WITHOUT ANY WARRANTY;
+
+  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 51
+  Franklin St, Fifth Floor, Boston, MA 02110, USA
+
+  http://www.gnu.de/gpl-ger.html
+-----------------------------------------------------------------------------------------*/
+#include "esp8266.h"
+#include "globals.h"
+#include "stack.h"
+#include "timer.h"
+#include "ipfrag.h"
+
+#ifdef USE_IP_REASM
+
+static ip_reasm_table ip_reasm_entry[IP_REASM_SLOTS];
+ipReasmStats ip_reasm_stats;
+
+//----------------------------------------------------------------------------
+//Init of the reassembly slots
+void ICACHE_FLASH_ATTR ip_reasm_init (void)
+{
+  os_memset(ip_reasm_entry, 0, sizeof(ip_reasm_entry));
+  os_memset(&ip_reasm_stats, 0, sizeof(ip_reasm_stats));
+}
+
+//----------------------------------------------------------------------------
+//Releases a slot and its share of the memory count
+static void ICACHE_FLASH_ATTR ip_reasm_free (u8 index)
+{
+  tw_cancel(&ip_reasm_entry[index].ip_r_timer);
+  ip_reasm_stats.mem_used -= ip_reasm_entry[index].ip_r_held;
+  ip_reasm_entry[index].ip_r_used = 0;
+}
+
+//----------------------------------------------------------------------------
+//Drops an incomplete datagram that ran out of time
+static void ICACHE_FLASH_ATTR ip_reasm_timeout (void *arg)
+{
+  STACK_DEBUG("IP reassembly timeout\n");
+  ip_reasm_stats.drop_timeout++;
+  ip_reasm_free((ip_reasm_table *)arg - ip_reasm_entry);
+}
+
+//----------------------------------------------------------------------------
+//Finds the slot for this fragment, or opens a new one
+static u8 ICACHE_FLASH_ATTR ip_reasm_slot (IP_Header *ip)
+{
+  u8 i, free_slot = IP_REASM_SLOTS, from_source = 0;
+
+  for (i = 0; i < IP_REASM_SLOTS; i++)
+  {
+    if (!ip_reasm_entry[i].ip_r_used)
+    {
+      if (free_slot == IP_REASM_SLOTS) free_slot = i;
+      continue;
+    }
+    if (ip_reasm_entry[i].ip_r_src == ip->IP_Srcaddr)
+    {
+      if (ip_reasm_entry[i].ip_r_id    == ip->IP_Id &&
+          ip_reasm_entry[i].ip_r_proto == ip->IP_Proto &&
+          ip_reasm_entry[i].ip_r_dst   == ip->IP_Destaddr &&
+          ip_reasm_entry[i].ip_r_if    == ETH_IF_INDEX())
+      {
+        return (i);
+      }
+      from_source++;
+    }
+  }
+
+  if (from_source >= IP_REASM_PER_SOURCE)
+  {
+    ip_reasm_stats.drop_source++;
+    return (IP_REASM_SLOTS);
+  }
+  if (free_slot == IP_REASM_SLOTS)
+  {
+    ip_reasm_stats.drop_nomem++;
+    return (IP_REASM_SLOTS);
+  }
+
+  os_memset(&ip_reasm_entry[free_slot], 0, sizeof(ip_reasm_table) - IP_REASM_MAX_DATA);
+  ip_reasm_entry[free_slot].ip_r_used   = 1;
+  ip_reasm_entry[free_slot].ip_r_src    = ip->IP_Srcaddr;
+  ip_reasm_entry[free_slot].ip_r_dst    = ip->IP_Destaddr;
+  ip_reasm_entry[free_slot].ip_r_id     = ip->IP_Id;
+  ip_reasm_entry[free_slot].ip_r_proto  = ip->IP_Proto;
+  ip_reasm_entry[free_slot].ip_r_if     = ETH_IF_INDEX();
+  tw_arm(&ip_reasm_entry[free_slot].ip_r_timer, IP_REASM_TIMEOUT * 1000,
+         ip_reasm_timeout, &ip_reasm_entry[free_slot]);
+  return (free_slot);
+}
+
+//----------------------------------------------------------------------------
+//Takes the fragment in eth_buffer. Returns 1 once the datagram is complete,
+//it has then been copied back into eth_buffer as one unfragmented packet.
+//Returns 0 if the fragment was stored or dropped - nothing left to process.
+u8 ICACHE_FLASH_ATTR ip_reasm_input (u16 rx_length)
+{
+  IP_Header      *ip = (IP_Header *)&eth_buffer[IP_OFFSET];
+  ip_reasm_table *r;
+  u16 frag, offset, hdr_len, data_len, b;
+  u8  index;
+
+  ip_reasm_stats.frags++;
+
+  frag     = htons(ip->IP_Frag_Offset);
+  offset   = (frag & IP_FRAG_OFS_MASK) << 3;
+  hdr_len  = (ip->IP_Vers_Len & 0x0F) << 2;
+  data_len = htons(ip->IP_Pktlen) - hdr_len;
+
+  //Truncated by the receive buffer, odd sized middle fragment or broken header
+  if (hdr_len < IP_VERS_LEN || htons(ip->IP_Pktlen) <= hdr_len ||
+      ETH_HDR_LEN + htons(ip->IP_Pktlen) > rx_length ||
+      ((frag & IP_FRAG_MF) && (data_len & 7)))
+  {
+    ip_reasm_stats.drop_bad++;
+    return (0);
+  }
+
+  index = ip_reasm_slot(ip);
+  if (index == IP_REASM_SLOTS) return (0);
+  r = &ip_reasm_entry[index];
+
+  if ((u32)offset + data_len > IP_REASM_MAX_DATA ||
+      (!(frag & IP_FRAG_MF) && r->ip_r_total && r->ip_r_total != offset + data_len))
+  {
+    STACK_DEBUG("IP datagram too big to reassemble\n");
+    ip_reasm_stats.drop_oversize++;
+    ip_reasm_free(index);
+    return (0);
+  }
+
+  if (r->ip_r_total && offset + data_len > r->ip_r_total)
+  {
+    ip_reasm_stats.drop_bad++;
+    ip_reasm_free(index);
+    return (0);
+  }
+
+  if (offset == 0)
+  {
+    os_memcpy(r->ip_r_hdr, ip, hdr_len);
+    r->ip_r_hdr_len = hdr_len;
+  }
+  if (!(frag & IP_FRAG_MF))
+  {
+    r->ip_r_total = offset + data_len;
+  }
+
+  //Copy the data, count only blocks not seen before
+  os_memcpy(&r->ip_r_data[offset], &eth_buffer[IP_OFFSET + hdr_len], data_len);
+  for (b = offset >> 3; b < ((offset + data_len + 7) >> 3); b++)
+  {
+    if (!(r->ip_r_map[b >> 3] & (1 << (b & 7))))
+    {
+      u16 block_len = ((b << 3) + 8 > offset + data_len) ? (offset + data_len - (b << 3)) : 8;
+      r->ip_r_map[b >> 3] |= (1 << (b & 7));
+      r->ip_r_held += block_len;
+      ip_reasm_stats.mem_used += block_len;
+    }
+  }
+  if (ip_reasm_stats.mem_used > ip_reasm_stats.mem_peak)
+  {
+    ip_reasm_stats.mem_peak = ip_reasm_stats.mem_used;
+  }
+
+  //Complete?
+  if (r->ip_r_total == 0 || r->ip_r_hdr_len == 0 || r->ip_r_held < r->ip_r_total)
+  {
+    return (0);
+  }
+  if (ETH_HDR_LEN + r->ip_r_hdr_len + r->ip_r_total > ETH_BUFFER_SIZE)
+  {
+    ip_reasm_stats.drop_oversize++;
+    ip_reasm_free(index);
+    return (0);
+  }
+
+  //Rebuild the datagram in eth_buffer, the ethernet header stays as it is
+  os_memcpy(&eth_buffer[IP_OFFSET], r->ip_r_hdr, r->ip_r_hdr_len);
+  os_memcpy(&eth_buffer[IP_OFFSET + r->ip_r_hdr_len], r->ip_r_data, r->ip_r_total);
+  ip->IP_Pktlen      = htons(r->ip_r_hdr_len + r->ip_r_total);
+  ip->IP_Frag_Offset = 0;
+  ip->IP_Hdr_Cksum   = 0;
+  ip->IP_Hdr_Cksum   = htons(checksum(&ip->IP_Vers_Len, r->ip_r_hdr_len, 0));
+
+  STACK_DEBUG("IP datagram reassembled, %u bytes\n", r->ip_r_total);
+  ip_reasm_stats.reassembled++;
+  ip_reasm_free(index);
+  return (1);
+}
+
+#endif //USE_IP_REASM
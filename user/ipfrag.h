@@ -0,0 +1,89 @@
+/*-----------------------------------------------------------------------------------------
+Description:    IPv4 fragment reassembly for the enc28j60 stack
+
+  Fragments are collected in a small fixed pool of slots. A datagram is only
+  handed on once complete, and only if it fits into eth_buffer - anything else
+  is dropped and counted.
+
+  With USE_IP_REASM eth_buffer holds whole frames, so full sized fragments
+  (1514 byte frames) come in complete, and a datagram of up to two of them is
+  rebuilt in eth_buffer and goes on from there like any other.
+
+-----------------------------------------------------------------------------------------
+License:
+  This program is free software; you can redistribute it and/or modify it under
+  the terms of the GNU General Public License as published by the Free Software
+  Foundation; either version 2 of the License, or (at your option) any later
+  version.
+  This program is distributed in the hope that it will be useful, but
+
+  WITHOUT ANY WARRANTY;
+
+  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 51
+  Franklin St, Fifth Floor, Boston, MA 02110, USA
+
+  http://www.gnu.de/gpl-ger.html
+-----------------------------------------------------------------------------------------*/
+
+#ifdef USE_IP_REASM
+#ifndef _IPFRAG_H
+  #define _IPFRAG_H
+  #include "globals.h"
+  #include "stack.h"
+  #include "timerwheel.h"
+
+  #define IP_REASM_SLOTS        2   //datagrams in reassembly at once
+  #define IP_REASM_PER_SOURCE   1   //of which one sender may hold
+  #define IP_REASM_TIMEOUT      5   //sec. until an incomplete datagram is dropped
+
+  //Reassembled datagram has to fit into eth_buffer again
+  #define IP_REASM_MAX_HDR      60
+  #define IP_REASM_MAX_DATA     (ETH_BUFFER_SIZE - ETH_HDR_LEN - IP_VERS_LEN)
+  #define IP_REASM_BLOCKS       ((IP_REASM_MAX_DATA + 7) / 8)
+  #define IP_REASM_MAP_LEN      ((IP_REASM_BLOCKS + 7) / 8)
+
+  //IP_Frag_Offset bits, host order
+  #define IP_FRAG_MF            0x2000
+  #define IP_FRAG_OFS_MASK      0x1FFF
+
+  typedef struct
+  {
+    u32 ip_r_src;
+    u32 ip_r_dst;
+    u16 ip_r_id;
+    u8  ip_r_proto;
+    u8  ip_r_if;                    //interface the fragments came in on
+    u8  ip_r_used;
+    u8  ip_r_hdr_len;               //0 until the first fragment is in
+    u16 ip_r_total;                 //payload length, 0 until the last fragment is in
+    u16 ip_r_held;                  //payload bytes received so far
+    TW_TIMER ip_r_timer;            //drops the datagram when it runs out
+    u8  ip_r_hdr[IP_REASM_MAX_HDR];
+    u8  ip_r_map[IP_REASM_MAP_LEN]; //one bit per 8 byte block received
+    u8  ip_r_data[IP_REASM_MAX_DATA];
+  } ip_reasm_table;
+
+  typedef struct
+  {
+    u32 frags;          //fragments received
+    u32 reassembled;    //datagrams completed
+    u32 drop_timeout;   //incomplete datagrams timed out
+    u32 drop_oversize;  //datagram bigger than eth_buffer
+    u32 drop_nomem;     //no free slot
+    u32 drop_source;    //sender already holds IP_REASM_PER_SOURCE slots
+    u32 drop_bad;       //truncated or malformed fragment
+    u16 mem_used;       //payload bytes currently held
+    u16 mem_peak;
+  } ipReasmStats;
+
+  extern ipReasmStats ip_reasm_stats;
+
+  void ip_reasm_init  (void);
+  u8   ip_reasm_input (u16 rx_length);
+
+#endif //_IPFRAG_H
+#endif //USE_IP_REASM
@@ -1,1524 +1,3660 @@
-/*
------------------------------------------------------------------------------------------
-Author:         Mark F (Cicero-MF) mark@cdelec.co.za    
-Known Issues:   none
-Version:        22.05.2016
-Description:    Simple Ethernet stack for the enc28j60 and an esp8266
-
-  This code was modified for use with the ESP8266, based off an original AVR version by  
-   Author:         Radig Ulrich mailto: mail@ulrichradig.de
-   Version:        24.10.2007
-   Description:    Ethernet Stack
-
------------------------------------------------------------------------------------------
-License:
-  This program is free software; you can redistribute it and/or modify it under
-  the terms of the GNU General Public License as published by the Free Software
-  Foundation; either version 2 of the License, or (at your option) any later
-  version.
-  This program is distributed in the hope that it will be useful, but
-
-  WITHOUT ANY WARRANTY;
-
-  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
-  PURPOSE. See the GNU General Public License for more details.
-
-  You should have received a copy of the GNU General Public License along with
-  this program; if not, write to the Free Software Foundation, Inc., 51
-  Franklin St, Fifth Floor, Boston, MA 02110, USA
-
-  http://www.gnu.de/gpl-ger.html
------------------------------------------------------------------------------------------*/
-#include <esp8266.h>
-#include "globals.h"
-#include "stack.h"
-#include "io.h"
-#include "dhcpc.h"
-#include "esp_enc_api.h"
-
-TCP_PORT_ITEM TCP_PORT_TABLE[MAX_APP_ENTRY] = // TCP port and function pairs
-{
-	{0,0},
-	{0,0},
-	{0,0} 
-};
-
-UDP_PORT_ITEM UDP_PORT_TABLE[MAX_APP_ENTRY] = // UDP port and function pairs
-{
-	{0,0},
-	{0,0},
-	{0,0} 
-};
-
-/* TODO: Rather use sysCfg IP's everywhere instead, with union assignment for -Wall compile */
-u8 myip[4];
-u8 netmask[4];
-u8 router_ip[4];
-u8 broadcast_ip[4];
-u16 IP_id_counter   = 0;
-
-/* Ethernet packet buffers */
-u8 eth_buffer[MTU_SIZE+1];
-
-arp_table arp_entry[MAX_ARP_ENTRY];
-
-//TCP Stack Size
-//+1 so that a connection can be dismissed at full stack
-tcp_table tcp_entry[MAX_TCP_ENTRY+1]; 
-
-PING_STRUCT ping;
-ethStruct eth;
-static ETSTimer ethLoopTimer;
-extern u32 my1secTime;
-
-//----------------------------------------------------------------------------
-//Converts integer variables to network Byte order
-u16 ICACHE_FLASH_ATTR htons(u16 val)
-{
-  return HTONS(val);
-}
-//----------------------------------------------------------------------------
-//Converts integer variables to network Byte order
-u32 ICACHE_FLASH_ATTR htons32(u32 val)
-{
-  return HTONS32(val);
-}
-
-#ifdef ENC28J60
-static void ICACHE_FLASH_ATTR ethLoopCb (void *arg) {
-
-	static u32 time_old = ENC_RESET_TIMEOUT;
-
-  os_timer_disarm(&ethLoopTimer);
-	os_timer_setfn(&ethLoopTimer, ethLoopCb, NULL);
-
-	eth_get_data();
-
-	//Ethernet OK??
-	if(my1secTime > time_old)
-	{
-		//Toggel LED1 on PORTB0
-		if(eth.no_reset)
-		{
-			eth.no_reset = 0;
-		}
-		else
-		{
-			STACK_DEBUG("ENC rst ");
-			ETS_GPIO_INTR_DISABLE();
-			enc_init();
-			enc28j60_led_blink (0);
-			ETS_GPIO_INTR_ENABLE();
-		}
-		time_old = my1secTime+ENC_RESET_TIMEOUT;
-	}
-
-  os_timer_arm(&ethLoopTimer, 1, 0);
-}
-
-#endif
-
-//----------------------------------------------------------------------------
-/* Initialise Stack, pull IP's, and init ENC */
-u32 ICACHE_FLASH_ATTR stack_init (void) {  
-  // Timer init - this is a free running 1sec timed function
-  timer_init();
-  
-	/* ENC init*/
-	STACK_DEBUG("\nInit ENC\n");
-	enc_init();
-  
-  /* Start the DHCP process if setip is 0, else just pass through */
-  if (sysCfg.setipaddr.theint == 0) {
-    dhcp_init();
-  } else {
-    /* Want static IP, so load it in */
-    #ifdef IPS_IN_UNION  
-      sysCfg.ethip.theint = sysCfg.setipaddr.theint;
-    #else
-      
-    #endif
-    stack_startEthTask();
-    stack_updateIPs();
-  }
-}
-
-void ICACHE_FLASH_ATTR stack_startEthTask (void) {
-  #ifdef ENC28J60
-    // this is like a while loop - but this is the closest we can get to that
-    os_timer_disarm(&ethLoopTimer);
-    os_timer_setfn(&ethLoopTimer, ethLoopCb, NULL);
-    os_timer_arm(&ethLoopTimer, 2, 0);
-     enc28j60_led_blink (1);
-  #endif  
-}
-
-void ICACHE_FLASH_ATTR stack_updateIPs (void) {
-  /* Sort out ip's for local stack - eventually want to just use the sysCfg addrs */
-  #ifdef IPS_IN_UNION    
-    memcpy(netmask,sysCfg.netmask.thech,4);
-    memcpy(router_ip,sysCfg.router_ip.thech,4);
-    memcpy(myip,sysCfg.ethip.thech,4);
-  #else
-    memcpy(netmask,sysCfg.netmask,4);
-    memcpy(router_ip,sysCfg.router_ip,4);
-    memcpy(myip,sysCfg.ethip,4);
-  #endif
-
-  /* TODO: Remove these u32 typecasts, use union method
-    Calculate broadcast address for now - if dhcp, this will be overwritten */
-  (*((u32*)&broadcast_ip[0])) = (((*((u32*)&myip[0])) & (*((u32*)&netmask[0]))) | (~(*((u32*)&netmask[0]))));
-}
-
-
-
-//----------------------------------------------------------------------------
-//Management of TCP timer
-void ICACHE_FLASH_ATTR tcp_timer_call (void)
-{
-	for (u8 index = 0;index<MAX_TCP_ENTRY;index++)
-	{
-		if (tcp_entry[index].time == 0)
-		{
-			if (tcp_entry[index].ip != 0)
-			{
-				tcp_entry[index].time = TCP_MAX_ENTRY_TIME;
-				if ((tcp_entry[index].error_count++) > MAX_TCP_ERRORCOUNT)
-				{
-					STACK_DEBUG("Entry is removed MAX_ERROR STACK:%u\n",index);
-					ETS_GPIO_INTR_DISABLE(); //ETH_INT_DISABLE;
-					tcp_entry[index].status =  RST_FLAG | ACK_FLAG;
-					create_new_tcp_packet(0,index);
-					ETS_GPIO_INTR_ENABLE(); //ETH_INT_ENABLE;
-					tcp_index_del(index);
-				}
-				else
-				{
-					STACK_DEBUG("Packet is retransmitted STACK:%u\n",index);
-					find_and_start (index);
-				}
-			}
-		}
-		else
-		{
-			if (tcp_entry[index].time != TCP_TIME_OFF)
-			{
-				tcp_entry[index].time--;
-			}
-		}
-	}
-}
-
-//----------------------------------------------------------------------------
-//Managing the ARP timer
-void ICACHE_FLASH_ATTR arp_timer_call (void)
-{
-	for (u8 a = 0;a<MAX_ARP_ENTRY;a++)
-	{
-		if (arp_entry[a].arp_t_time == 0)
-		{
-			for (u8 b = 0;b<6;b++)
-			{
-				arp_entry[a].arp_t_mac[b]= 0;
-			}
-			arp_entry[a].arp_t_ip = 0;
-		}
-		else
-		{
-			arp_entry[a].arp_t_time--;
-		}
-	}
-}
-
-//----------------------------------------------------------------------------
-// Add TCP PORT / application in application list - returns port_index
-s8 ICACHE_FLASH_ATTR add_tcp_app (u16 port, void(*fp1)(u8, u8), struct espconn *espconn)
-{
-	u8 port_index = 0;
-	//Search free entry in the application list
-	while (TCP_PORT_TABLE[port_index].port)
-	{ 
-		port_index++;
-	}
-	if (port_index >= MAX_APP_ENTRY)
-	{
-		STACK_DEBUG("TCP too many applications have been launched\n");
-		return -1;
-	}
-	STACK_DEBUG("TCP application is entered in list: Entry %u, port = %u\n",port_index, port);
-	TCP_PORT_TABLE[port_index].port     = port;
-	TCP_PORT_TABLE[port_index].fp       = *fp1;
-	TCP_PORT_TABLE[port_index].espconn  = espconn;
-	return port_index;
-}
-
-//Clears TCP application from the application list
-void ICACHE_FLASH_ATTR kill_tcp_app (u16 port)
-{
-    u8 i;
-
-    for (i = 0; i < MAX_APP_ENTRY; i++)
-    {
-        if ( TCP_PORT_TABLE[i].port == port )
-        {
-            TCP_PORT_TABLE[i].port = 0;
-        }
-    }
-    return;
-}
-
-//----------------------------------------------------------------------------
-//Change the TCP PORT / application in application list
-void ICACHE_FLASH_ATTR change_port_tcp_app (u16 port_old, u16 port_new)
-{
-	u8 port_index = 0;
-	//Search for free entry in the application list
-	while (TCP_PORT_TABLE[port_index].port && TCP_PORT_TABLE[port_index].port != port_old)
-	{ 
-		port_index++;
-	}
-	if (port_index >= MAX_APP_ENTRY)
-	{
-		STACK_DEBUG("( Port Change ) Port not found\n");
-		return;
-	}
-	STACK_DEBUG("TCP application Change Port : Entry %i\n",port_index);
-	TCP_PORT_TABLE[port_index].port = port_new;
-	return;
-}
-
-//----------------------------------------------------------------------------
-//Add UDP port/application to list
-void ICACHE_FLASH_ATTR add_udp_app (u16 port, void(*fp1)(u8, u8))
-{
-	u8 port_index = 0;
-	//Search
-	while (UDP_PORT_TABLE[port_index].port)
-	{ 
-		port_index++;
-	}
-	if (port_index >= MAX_APP_ENTRY)
-	{
-		STACK_DEBUG("Too many UDP application were launched\n");
-		return;
-	}
-	STACK_DEBUG("UDP Application is registered in List: Entry %u\n",port_index);
-	UDP_PORT_TABLE[port_index].port = port;
-	UDP_PORT_TABLE[port_index].fp = *fp1;
-	return;
-}
-
-//----------------------------------------------------------------------------
-//Clears UDP application from the application list
-void ICACHE_FLASH_ATTR kill_udp_app (u16 port)
-{
-    u8 i;
-
-    for (i = 0; i < MAX_APP_ENTRY; i++)
-    {
-        if ( UDP_PORT_TABLE[i].port == port )
-        {
-            UDP_PORT_TABLE[i].port = 0;
-        }
-    }
-    return;
-}
-
-//----------------------------------------------------------------------------
-//Interrupt from the ENC
-void ICACHE_FLASH_ATTR stack_encInterrupt (void)
-{
-  u32 gpio_status;
-  ETS_GPIO_INTR_DISABLE();
-  
-  gpio_status = GPIO_REG_READ(GPIO_STATUS_ADDRESS);
-  GPIO_REG_WRITE(GPIO_STATUS_W1TC_ADDRESS, gpio_status);
-  
-	//STACK_DEBUG("sInt\n");
-  eth.data_present = 1;
-	eth.no_reset = 1;
-  
-  gpio_status = GPIO_REG_READ(GPIO_STATUS_ADDRESS);  
-}
-
-//----------------------------------------------------------------------------
-//PORT DONE - ETH get data
-void ICACHE_FLASH_ATTR eth_get_data (void)
-{ 
-	
-	if(eth.timer)
-	{
-		tcp_timer_call();
-		arp_timer_call();
-		eth.timer = 0;
-	}	
-	if(eth.data_present)
-	{
-		while(!GPIO_INPUT_GET(ENCINTGPIO))
-		{	
-			u16 packet_length;
-				  
-			packet_length = ETH_PACKET_RECEIVE(MTU_SIZE,eth_buffer);
-			/*Wenn ein Packet angekommen ist, ist packet_lenght =! 0*/
-			if(packet_length > 0)
-			{
-        /*u16 len;
-        s8 first, second;
-        */
-				eth_buffer[packet_length+1] = 0;
-       
-        /*STACK_DEBUG("Check packet...\n\n");        
-        for (len = 0; len <packet_length; len++) {          
-          hextools_hex2ascii(eth_buffer[len], &first, &second);
-          uart0_write_char(first);
-          uart0_write_char(second);
-        }
-        STACK_DEBUG("\n\nDone packet...\n");
-        */
-        
-				check_packet();
-			}
-		}
-		eth.data_present = 0;
-		ETS_GPIO_INTR_ENABLE();
-	}
-	return;
-}
-
-//----------------------------------------------------------------------------
-//PORT DONE - Check Packet and call Stack for TCP or UDP
-void ICACHE_FLASH_ATTR check_packet (void)
-{
-  Ethernet_Header *ethernet;    
-  IP_Header       *ip;         
-  ICMP_Header     *icmp;       
-
-  ethernet = (Ethernet_Header *)&eth_buffer[ETHER_OFFSET];
-  ip       = (IP_Header       *)&eth_buffer[IP_OFFSET];
-  icmp     = (ICMP_Header     *)&eth_buffer[ICMP_OFFSET];
-  
-  //ARP or not?
-  if(ethernet->EnetPacketType == HTONS(0x0806) ) {
-    arp_reply(); // check arp packet request/reply
-  } else {
-    // if IP
-    if( ethernet->EnetPacketType == HTONS(0x0800) ) {         
-      //STACK_DEBUG("if IP, %u\n",ip->IP_Destaddr);
-      // if my IP address 
-      if( ip->IP_Destaddr == *((u32*)&myip[0]) ) {
-        //STACK_DEBUG("if my IP\n");
-        arp_entry_add(); 
-        if(ip->IP_Proto == PROT_ICMP) {
-          switch ( icmp->ICMP_Type ) {
-            case (8): //Ping reqest
-              STACK_DEBUG("ping request\n");
-              icmp_send(ip->IP_Srcaddr,0,0,icmp->ICMP_SeqNum,icmp->ICMP_Id); 
-              break;
-
-            case (0): //Ping reply
-              STACK_DEBUG("ping reply\n");
-              if ((*((u32*)&ping.ip1[0])) == ip->IP_Srcaddr) {
-                ping.result |= 0x01;
-              }
-              STACK_DEBUG("%u",    (ip->IP_Srcaddr&0x000000FF)     );
-              STACK_DEBUG(".%u",  ((ip->IP_Srcaddr&0x0000FF00)>>8 ));
-              STACK_DEBUG(".%u",  ((ip->IP_Srcaddr&0x00FF0000)>>16));
-              STACK_DEBUG(".%u :",((ip->IP_Srcaddr&0xFF000000)>>24));
-              break;
-          }
-          return;
-        } else {
-          if( ip->IP_Proto == PROT_TCP ) tcp_socket_process();
-          if( ip->IP_Proto == PROT_UDP ) udp_socket_process();
-        }
-      } else {        
-        // if broadcast
-        if (ip->IP_Destaddr == (u32)0xffffffff || ip->IP_Destaddr == *((u32*)&broadcast_ip[0]) ) {
-          //STACK_DEBUG("Broadcast address\n");
-          if( ip->IP_Proto == PROT_UDP ) { 
-            //STACK_DEBUG("Calling UDP app\n");
-            udp_socket_process();
-          }
-        }
-      }
-    }
-  }
-  return;
-}
-
-//----------------------------------------------------------------------------
-//PORT DONE - creates an ARP - entry if not yet available 
-void ICACHE_FLASH_ATTR arp_entry_add (void)
-{
-    Ethernet_Header *ethernet;
-    ARP_Header      *arp;
-    IP_Header       *ip;
-      
-    ethernet = (Ethernet_Header *)&eth_buffer[ETHER_OFFSET];
-    arp      = (ARP_Header      *)&eth_buffer[ARP_OFFSET];
-    ip       = (IP_Header       *)&eth_buffer[IP_OFFSET];
-        
-    //STACK_DEBUG("ARP entry add\n");
-    
-    //Entry already exists ?
-    for (u8 b = 0; b<MAX_ARP_ENTRY; b++)
-    {
-        if( ethernet->EnetPacketType == HTONS(0x0806) ) //If ARP
-        {
-           
-          if(arp_entry[b].arp_t_ip == arp->ARP_SIPAddr)
-          {
-          // Time refresh
-          for(u8 a = 0; a < 6; a++) {
-            arp_entry[b].arp_t_mac[a] = ethernet->EnetPacketSrc[a];
-          }
-          arp_entry[b].arp_t_ip   = arp->ARP_SIPAddr;
-          arp_entry[b].arp_t_time = ARP_MAX_ENTRY_TIME;
-          return;
-          }
-        } 
-        
-        if( ethernet->EnetPacketType == HTONS(0x0800) ) //If IP
-        {
-          if(arp_entry[b].arp_t_ip == ip->IP_Srcaddr)
-          {
-            //Time refresh
-            for(u8 a = 0; a < 6; a++) {
-              arp_entry[b].arp_t_mac[a] = ethernet->EnetPacketSrc[a];
-            }
-            arp_entry[b].arp_t_ip   = ip->IP_Srcaddr;
-            arp_entry[b].arp_t_time = ARP_MAX_ENTRY_TIME;
-            return;
-          }
-        }
-    }
-  
-    //Find entry
-    for (u8 b = 0; b<MAX_ARP_ENTRY; b++)
-    {
-        if(arp_entry[b].arp_t_ip == 0)
-        {
-            if( ethernet->EnetPacketType == HTONS(0x0806) ) //if ARP
-            {
-                for(u8 a = 0; a < 6; a++)
-                {
-                    arp_entry[b].arp_t_mac[a] = ethernet->EnetPacketSrc[a]; 
-                }
-                arp_entry[b].arp_t_ip   = arp->ARP_SIPAddr;
-                arp_entry[b].arp_t_time = ARP_MAX_ENTRY_TIME;
-                return;
-            }
-            if( ethernet->EnetPacketType == HTONS(0x0800) ) //if IP
-            {
-                for(u8 a = 0; a < 6; a++)
-                {
-                    arp_entry[b].arp_t_mac[a] = ethernet->EnetPacketSrc[a]; 
-                }
-                arp_entry[b].arp_t_ip   = ip->IP_Srcaddr;
-                arp_entry[b].arp_t_time = ARP_MAX_ENTRY_TIME;
-                return;
-            }
-            STACK_DEBUG("No ARP or IP packet!\n");
-            return;
-        }
-    }    
-    STACK_DEBUG("ARP entry table full!\n");
-    return;
-}
-
-//----------------------------------------------------------------------------
-//PORT DONE - This routine search by IP ARP entry
-char ICACHE_FLASH_ATTR arp_entry_search (u32 dest_ip)
-{
-	for (u8 b = 0;b<MAX_ARP_ENTRY;b++)
-	{
-		if(arp_entry[b].arp_t_ip == dest_ip)
-		{
-			return(b);
-		}
-	}
-	return (MAX_ARP_ENTRY);
-}
-
-//----------------------------------------------------------------------------
-//PORT DONE - This routine creates a new ethernet header 
-void ICACHE_FLASH_ATTR new_eth_header (u8 *buffer,u32 dest_ip)
-{
-  u8 b;
-  u8 a;
-  
-	Ethernet_Header *ethernet;
-	ethernet = (Ethernet_Header *)&buffer[ETHER_OFFSET];
-  	
-	b = arp_entry_search (dest_ip);
-	if (b != MAX_ARP_ENTRY) //found entry if not equal
-	{
-		for(u8 a = 0; a < 6; a++)
-		{			
-			ethernet->EnetPacketDest[a] = arp_entry[b].arp_t_mac[a];			
-			ethernet->EnetPacketSrc[a] = mymac[a];
-		}
-		return;
-	}
-    
-	STACK_DEBUG("ARP entry is not found*\n");
-	for(a = 0; a < 6; a++)
-	{	
-
-		ethernet->EnetPacketDest[a] = 0xFF;
-		//My MAC address is written in the source address
-		ethernet->EnetPacketSrc[a] = mymac[a];
-	}
-	return;
-
-}
-
-//----------------------------------------------------------------------------
-//PORT DONE - This routine responds to an ARP packet
-void ICACHE_FLASH_ATTR arp_reply (void)
-{
-    u8 b;
-    u8 a;
-    u16 len;
-    char first, second;
-    
-    Ethernet_Header *ethernet;
-    ARP_Header      *arp;
-    
-    arp      = (ARP_Header      *)&eth_buffer[ARP_OFFSET];
-    ethernet = (Ethernet_Header *)&eth_buffer[ETHER_OFFSET];
-    
-    //STACK_DEBUG("arp reply\n"); 
-
-    if( arp->ARP_HWType  == HTONS(0x0001)  &&             // Hardware Typ:   Ethernet
-        arp->ARP_PRType  == HTONS(0x0800)  &&             // Protocol Typ:  IP
-        arp->ARP_HWLen   == 0x06           &&             
-        arp->ARP_PRLen   == 0x04           &&             
-        arp->ARP_TIPAddr == *((u32*)&myip[0])) // For us?
-    {
-        if (arp->ARP_Op == HTONS(0x0001) )                  // Request?
-        {
-            arp_entry_add(); 
-            new_eth_header (eth_buffer, arp->ARP_SIPAddr); // Creates new ethernet header
-            ethernet->EnetPacketType = HTONS(0x0806);      // 0x0800=IP Datagramm;0x0806 = ARP
-      
-            b = arp_entry_search (arp->ARP_SIPAddr);
-            if (b < MAX_ARP_ENTRY)                        
-            {
-              for(a = 0; a < 6; a++)
-              {
-                  arp->ARP_THAddr[a] = arp_entry[b].arp_t_mac[a];
-                  arp->ARP_SHAddr[a] = mymac[a];
-              }              
-            }
-            else
-            {
-                STACK_DEBUG("ARP Entry not found\n");        
-            }
-            
-	  
-            arp->ARP_Op      = HTONS(0x0002);                   // ARP op = ECHO  
-            arp->ARP_TIPAddr = arp->ARP_SIPAddr;                // ARP Target IP Adresse 
-            arp->ARP_SIPAddr = *((u32 *)&myip[0]);   // Meine IP Adresse = ARP Source
-                        
-            //STACK_DEBUG("Sending packet...\n\n");        
-            /*for (len = 0; len <ARP_REPLY_LEN; len++) {          
-              hextools_hex2ascii(eth_buffer[len], &first, &second);
-              uart0_write_char(first);
-              uart0_write_char(second);
-            }
-            //STACK_DEBUG("\n\nDone send packet...\n");
-            */
-            STACK_DEBUG("Sending ARP reply\n"); 
-            ETH_PACKET_SEND(ARP_REPLY_LEN,eth_buffer);          // ARP Reply senden...
-            eth.no_reset = 1;
-            return;
-        }
-
-        if ( arp->ARP_Op == HTONS(0x0002) )                    // REPLY from another client
-        {
-            arp_entry_add();
-            STACK_DEBUG("ARP REPLY RECEIVED!\n");
-        }
-    }
-    return;
-}
-
-//----------------------------------------------------------------------------
-//FIXME: Use this to request the gateway MAC
-/*
-  char ICACHE_FLASH_ATTR arp_request (u32 dest_ip)
-  {
-      u8 buffer[ARP_REQUEST_LEN];
-      u8 index = 0;
-      u8 index_tmp;
-      u8 count;
-      u32 a;
-      u32 dest_ip_store;
-
-      Ethernet_Header *ethernet;
-      ARP_Header *arp;
-
-      STACK_DEBUG("arp request\n");  
-      ethernet = (Ethernet_Header *)&buffer[ETHER_OFFSET];
-      arp      = (ARP_Header      *)&buffer[ARP_OFFSET];
-
-      dest_ip_store = dest_ip;
-
-      if ( (dest_ip & (*((u32 *)&netmask[0])))==
-         ((*((u32 *)&myip[0]))&(*((u32 *)&netmask[0]))) )
-      {
-          STACK_DEBUG("MY NETWORK!\n");
-      }
-      else
-      {
-          STACK_DEBUG("ROUTING!\n");
-          dest_ip = (*((u32 *)&router_ip[0]));
-      }
-
-      ethernet->EnetPacketType = HTONS(0x0806);          // Nutzlast 0x0800=IP Datagramm;0x0806 = ARP
-    
-      new_eth_header (buffer,dest_ip);
-    
-      arp->ARP_SIPAddr = *((u32 *)&myip[0]);   // MyIP = ARP Source IP
-      arp->ARP_TIPAddr = dest_ip;                         // Dest IP 
-    
-      for(count = 0; count < 6; count++)
-      {
-          arp->ARP_SHAddr[count] = mymac[count];
-          arp->ARP_THAddr[count] = 0;
-      }
-    
-      arp->ARP_HWType = HTONS(0x0001);
-      arp->ARP_PRType = HTONS(0x0800);
-      arp->ARP_HWLen  = 0x06;
-      arp->ARP_PRLen  = 0x04;
-      arp->ARP_Op     = HTONS(0x0001);
-
-      ETH_PACKET_SEND(ARP_REQUEST_LEN, buffer);        //send....
-    eth.no_reset = 1;
-    
-      for(count = 0; count<20; count++)
-      {
-          index_tmp = arp_entry_search(dest_ip_store);
-          index = arp_entry_search(dest_ip);
-          if (index < MAX_ARP_ENTRY || index_tmp < MAX_ARP_ENTRY)
-          {
-              STACK_DEBUG("ARP EINTRAG GEFUNDEN!\n");
-              if (index_tmp < MAX_ARP_ENTRY) return(1);//OK
-              arp_entry[index].arp_t_ip = dest_ip_store;
-              return(1);//OK
-          }
-          os_delay_us(1000);
-          eth_get_data();
-          STACK_DEBUG("**KEINEN ARP EINTRAG GEFUNDEN**\n");
-      }
-      return(0);//keine Antwort
-  }
-*/
-
-
-//----------------------------------------------------------------------------
-//PORT DONE - This routine creates a new ICMP Packet
-void ICACHE_FLASH_ATTR icmp_send (u32 dest_ip, u8 icmp_type, 
-                u8 icmp_code, u16 icmp_sn, 
-                u16 icmp_id)
-{
-  u16 result16;  //Checksum
-  IP_Header   *ip;
-  ICMP_Header *icmp;
-  
-  
-  ip   = (IP_Header   *)&eth_buffer[IP_OFFSET];
-  icmp = (ICMP_Header *)&eth_buffer[ICMP_OFFSET];
-
-  STACK_DEBUG("icmp_send()\n");  
-  
-  //This is an Echo Reply Packet
-  icmp->ICMP_Type   = icmp_type;
-  icmp->ICMP_Code   = icmp_code;
-  icmp->ICMP_Id     = icmp_id;
-  icmp->ICMP_SeqNum = icmp_sn;
-  icmp->ICMP_Cksum  = 0;
-  ip->IP_Pktlen     = HTONS(0x0054);   // 0x54 = 84 
-  ip->IP_Proto      = PROT_ICMP;
-  make_ip_header (eth_buffer,dest_ip);
-
-  //Berechnung der ICMP Header lnge
-  result16 = htons(ip->IP_Pktlen);
-  result16 = result16 - ((ip->IP_Vers_Len & 0x0F) << 2);
-
-  //pointer wird auf das erste Paket im ICMP Header gesetzt
-  //jetzt wird die Checksumme berechnet
-  result16 = checksum (&icmp->ICMP_Type, result16, 0);
- 
-  //schreibt Checksumme ins Packet
-  icmp->ICMP_Cksum = htons(result16);
-   
-  //Sendet das erzeugte ICMP Packet 
-  ETH_PACKET_SEND(ICMP_REPLY_LEN,eth_buffer);
-  eth.no_reset = 1;
-}
-
-//----------------------------------------------------------------------------
-//PORT DONE - This routine create a checksum
-u16 ICACHE_FLASH_ATTR checksum (u8 *pointer,u16 result16,u32 result32)
-{
-	u16 result16_1 = 0x0000;
-	u8 DataH;
-	u8 DataL;
-  
-  //Jetzt werden alle Packete in einer While Schleife addiert
-	while(result16 > 1)
-	{
-		//schreibt Inhalt Pointer nach DATAH danach inc Pointer
-		DataH=*pointer++;
-
-		//schreibt Inhalt Pointer nach DATAL danach inc Pointer
-		DataL=*pointer++;
-
-		//erzeugt Int aus Data L und Data H
-		result16_1 = ((DataH << 8)+DataL);
-		//Addiert packet mit vorherigen
-		result32 = result32 + result16_1;
-		//decrimiert Lnge von TCP Headerschleife um 2
-		result16 -=2;
-	}
-
-	//Ist der Wert result16 ungerade ist DataL = 0
-	if(result16 > 0)
-	{
-		//schreibt Inhalt Pointer nach DATAH danach inc Pointer
-		DataH=*pointer;
-		//erzeugt Int aus Data L ist 0 (ist nicht in der Berechnung) und Data H
-		result16_1 = (DataH << 8);
-		//Addiert packet mit vorherigen
-		result32 = result32 + result16_1;
-	}
-	
-	//Komplementbildung (addiert Long INT_H Byte mit Long INT L Byte)
-	result32 = ((result32 & 0x0000FFFF)+ ((result32 & 0xFFFF0000) >> 16));
-	result32 = ((result32 & 0x0000FFFF)+ ((result32 & 0xFFFF0000) >> 16));	
-	result16 =~(result32 & 0x0000FFFF);
-	
-	return (result16);
-}
-
-//----------------------------------------------------------------------------
-//PORT DONE - This routine creates an IP packet
-void ICACHE_FLASH_ATTR make_ip_header (u8 *buffer,u32 dest_ip)
-{
-  u16 result16;  //Checksum
-  Ethernet_Header *ethernet;
-  IP_Header       *ip;
-
-  ethernet = (Ethernet_Header *)&buffer[ETHER_OFFSET];
-  ip       = (IP_Header       *)&eth_buffer[IP_OFFSET];
-  
-  //STACK_DEBUG("make ip header\n");  
-  new_eth_header (buffer, dest_ip);         //Erzeugt einen neuen Ethernetheader
-
-  ethernet->EnetPacketType = HTONS(0x0800); //Payload 0x0800=IP
-  IP_id_counter++;
-
-  ip->IP_Frag_Offset = 0x0040;  //don't fragment
-  ip->IP_ttl         = 128;      //max. hops
-  ip->IP_Id          = htons(IP_id_counter);
-  ip->IP_Vers_Len    = 0x45;  //4 BIT Die Versionsnummer von IP, 
-  ip->IP_Tos         = 0;
-  ip->IP_Destaddr    = dest_ip;
-  ip->IP_Srcaddr     = *((u32 *)&myip[0]);
-  ip->IP_Hdr_Cksum   = 0;
-
-  //Berechnung der IP Header lnge  
-  result16 = (ip->IP_Vers_Len & 0x0F) << 2;
-
-  //jetzt wird die Checksumme berechnet
-  result16 = checksum (&ip->IP_Vers_Len, result16, 0);
-
-  //schreibt Checksumme ins Packet
-  ip->IP_Hdr_Cksum = htons(result16);
-  return;
-}
-
-//----------------------------------------------------------------------------
-//Diese Routine verwaltet TCP-Eintrge
-void ICACHE_FLASH_ATTR tcp_entry_add (u8 *buffer)
-{
-  u32 result32;
-  u8 port_index;
-
-  TCP_Header *tcp;
-  IP_Header  *ip;
-
-  tcp = (TCP_Header *)&buffer[TCP_OFFSET];
-  ip  = (IP_Header  *)&buffer[IP_OFFSET];
-
-  //Entry already exists?
-  for (u8 index = 0;index<(MAX_TCP_ENTRY);index++)
-  {
-      if( (tcp_entry[index].ip       == ip->IP_Srcaddr  ) &&
-          (tcp_entry[index].src_port == tcp->TCP_SrcPort)    )
-      {
-          //Record found Time refresh
-          tcp_entry[index].ack_counter = tcp->TCP_Acknum;
-          tcp_entry[index].seq_counter = tcp->TCP_Seqnum;
-          tcp_entry[index].status      = tcp->TCP_HdrFlags;
-          if ( tcp_entry[index].time != TCP_TIME_OFF )
-          {
-              tcp_entry[index].time = TCP_MAX_ENTRY_TIME;
-          }
-          result32 = htons(ip->IP_Pktlen) - IP_VERS_LEN - ((tcp->TCP_Hdrlen& 0xF0) >>2);
-          result32 = result32 + htons32(tcp_entry[index].seq_counter);
-          tcp_entry[index].seq_counter = htons32(result32);
-    
-          STACK_DEBUG("\t - TCP Entry found %u\n",index);
-          return;
-      }
-  }
-
-  //Find outdoor entry
-  for (u8 index = 0;index<(MAX_TCP_ENTRY);index++)
-  {
-      if(tcp_entry[index].ip == 0)
-      {
-          tcp_entry[index].ip          = ip->IP_Srcaddr;
-          tcp_entry[index].src_port    = tcp->TCP_SrcPort;
-          tcp_entry[index].dest_port   = tcp->TCP_DestPort;
-          tcp_entry[index].ack_counter = tcp->TCP_Acknum;
-          tcp_entry[index].seq_counter = tcp->TCP_Seqnum;
-          tcp_entry[index].status      = tcp->TCP_HdrFlags;
-          tcp_entry[index].app_status  = 0;
-          tcp_entry[index].time        = TCP_MAX_ENTRY_TIME;
-          tcp_entry[index].error_count = 0;
-          tcp_entry[index].first_ack   = 0;
-          
-          /* New listing - but if SrcPort is our app port, then copy in espconn data */
-          // Perform TCP Port with Port Dest application list
-          port_index= 0;
-          while (TCP_PORT_TABLE[port_index].port && TCP_PORT_TABLE[port_index].port!=(htons(tcp->TCP_DestPort)))
-          { 
-            port_index++;
-          }          
-          // If index is too large , then quit any existing application for Port
-          // Starts from a client what ? Will a client application to open a port ?
-          if (TCP_PORT_TABLE[port_index].port) { 
-            /* Only populate the encconn struct if its for an ESP application */
-            union {
-              u32 theint;
-              u8 thech[4];
-            } unionip;
-            
-            STACK_DEBUG("Connection to registered ESP app\n");
-            /* Copy in TCP data for our connection now - link this to the espconn */
-            tcp_entry[index].tcp_data.remote_port         = tcp_entry[index].src_port;
-            tcp_entry[index].tcp_data.local_port          = tcp_entry[index].dest_port;
-            unionip.theint                                = tcp_entry[index].ip;
-            memcpy(tcp_entry[index].tcp_data.remote_ip, unionip.thech, 4);     
-            memcpy(tcp_entry[index].tcp_data.local_ip, myip, 4);  
-
-            tcp_entry[index].tcp_data.connect_callback    = TCP_PORT_TABLE[port_index].espconn->proto.tcp->connect_callback;
-            tcp_entry[index].tcp_data.reconnect_callback  = TCP_PORT_TABLE[port_index].espconn->proto.tcp->reconnect_callback;
-            tcp_entry[index].tcp_data.disconnect_callback = TCP_PORT_TABLE[port_index].espconn->proto.tcp->disconnect_callback;
-            tcp_entry[index].tcp_data.write_finish_fn     = TCP_PORT_TABLE[port_index].espconn->proto.tcp->write_finish_fn;
-
-            /* Do the connection encconn as well */
-            tcp_entry[index].encconn.type                 = TCP_PORT_TABLE[port_index].espconn->type;
-            tcp_entry[index].encconn.state                = ESPCONN_LISTEN; /* FIXME: Figure this out */           
-            tcp_entry[index].encconn.proto.tcp            = &tcp_entry[index].tcp_data;  
-            tcp_entry[index].encconn.recv_callback        = TCP_PORT_TABLE[port_index].espconn->recv_callback;
-            tcp_entry[index].encconn.sent_callback        = TCP_PORT_TABLE[port_index].espconn->sent_callback;
-            tcp_entry[index].encconn.link_cnt             = TCP_PORT_TABLE[port_index].espconn->link_cnt; /* FIXME: Figure this out */
-            tcp_entry[index].encconn.reverse              = TCP_PORT_TABLE[port_index].espconn->reverse;  /* FIXME: Figure this out */
-          }
-          
-          STACK_DEBUG("TCP NewListing %u\n",index);
-          return;  
-      }
-  }
-  //Entry could not be included
-  STACK_DEBUG("Server Busy (NO MORE CONNECTIONS)!\n");
-  return;
-}
-
-//----------------------------------------------------------------------------
-//Diese Routine sucht den etntry eintrag
-char ICACHE_FLASH_ATTR tcp_entry_search (u32 dest_ip,u16 SrcPort)
-{
-	for (u8 index = 0;index<MAX_TCP_ENTRY;index++)
-	{
-    //STACK_DEBUG("\t - Search %u, ip = %u, scrPort = %u\n",index, tcp_entry[index].ip, htons(tcp_entry[index].src_port));
-		if(	tcp_entry[index].ip == dest_ip &&
-			tcp_entry[index].src_port == SrcPort)
-		{
-			return(index);
-		}
-	}
-	return (MAX_TCP_ENTRY);
-}
-
-//----------------------------------------------------------------------------
-//This routine manages the UDP ports
-void ICACHE_FLASH_ATTR udp_socket_process(void)
-{
-	u8 port_index = 0;	
-	UDP_Header *udp;
-	u8 len;
-    
-	udp = (UDP_Header *)&eth_buffer[UDP_OFFSET];
-
-  while (UDP_PORT_TABLE[port_index].port && UDP_PORT_TABLE[port_index].port!=(htons(udp->udp_DestPort)))
-	{ 
-		port_index++;
-	}
-	
-	// If index is too big , then quit any existing application for the Port
-	if (!UDP_PORT_TABLE[port_index].port)
-	{ 
-		//No existing application found (END)
-		//STACK_DEBUG("UDP No app found!\n");
-		return;
-	}
-  STACK_DEBUG("Calling UDP app\n");
-	//zugehrige Anwendung ausfhren
-	UDP_PORT_TABLE[port_index].fp(0, port_index); 
-	return;
-}
-
-//----------------------------------------------------------------------------
-//Diese Routine Erzeugt ein neues UDP Packet
-void ICACHE_FLASH_ATTR create_new_udp_packet( u16  data_length,
-                            u16  src_port,
-                            u16  dest_port,
-                            u32 dest_ip)
-{
-  u16  result16;
-  u32 result32;
-
-  UDP_Header *udp;
-  IP_Header  *ip;
-  
-  udp = (UDP_Header *)&eth_buffer[UDP_OFFSET];
-  ip  = (IP_Header  *)&eth_buffer[IP_OFFSET];
-
-  //STACK_DEBUG("create_new_udp_packet()\n");  
-  
-  udp->udp_SrcPort  = htons(src_port);
-  udp->udp_DestPort = htons(dest_port);
-
-  data_length     += UDP_HDR_LEN;                //UDP Packetlength
-  udp->udp_Hdrlen = htons(data_length);
-
-  data_length     += IP_VERS_LEN;                //IP Headerlnge + UDP Headerlnge
-  ip->IP_Pktlen = htons(data_length);
-  data_length += ETH_HDR_LEN;
-  ip->IP_Proto = PROT_UDP;
-  make_ip_header (eth_buffer,dest_ip);
-
-  udp->udp_Chksum = 0;
-
-  //Berechnet Headerlnge und Addiert Pseudoheaderlnge 2XIP = 8
-  result16 = htons(ip->IP_Pktlen) + 8;
-  result16 = result16 - ((ip->IP_Vers_Len & 0x0F) << 2);
-  result32 = result16 + 0x09;
-
-  //Routine berechnet die Checksumme
-  result16 = checksum ((&ip->IP_Vers_Len+12), result16, result32);
-  udp->udp_Chksum = htons(result16);
-
-  ETH_PACKET_SEND(data_length,eth_buffer); //send...
-  eth.no_reset = 1;
-  return;
-}
-
-//----------------------------------------------------------------------------
-//This routine manages the TCP ports
-void ICACHE_FLASH_ATTR tcp_socket_process(void)
-{
-	u8 index = 0;
-	u8 port_index = 0;
-	u32 result32 = 0;
-
-	TCP_Header *tcp;
-	tcp = (TCP_Header *)&eth_buffer[TCP_OFFSET];
-
-	IP_Header *ip; 	
-	ip = (IP_Header *)&eth_buffer[IP_OFFSET];
-
-	// Perform TCP Port with Port Dest application list
-	while (TCP_PORT_TABLE[port_index].port && TCP_PORT_TABLE[port_index].port!=(htons(tcp->TCP_DestPort)))
-	{ 
-		port_index++;
-	}
-	
-	// If index is too large , then quit any existing application for Port
-  // Starts from a client what ? Will a client application to open a port ?
-	if (!TCP_PORT_TABLE[port_index].port)
-	{ 
-		//No existing application available! (END)
-		STACK_DEBUG("TCP No application found!\n");
-		return;
-	}
-
-  STACK_DEBUG("Received Flags (Remote Port=%u) = ", htons(tcp->TCP_SrcPort));	
-  if(tcp->TCP_HdrFlags & SYN_FLAG)
-	{	
-		STACK_DEBUG("SYN ");	
-	}
-  if(tcp->TCP_HdrFlags & ACK_FLAG)
-	{	
-		STACK_DEBUG("ACK ");	
-	}
-  if(tcp->TCP_HdrFlags & RST_FLAG)
-	{	
-		STACK_DEBUG("RST ");	
-	}
-  if(tcp->TCP_HdrFlags & PSH_FLAG)
-	{	
-		STACK_DEBUG("PSH ");	
-	}
-  if(tcp->TCP_HdrFlags & FIN_FLAG)
-	{	
-		STACK_DEBUG("FIN ");	
-	}
-  STACK_DEBUG("\n");	
-  
-	//Server opens port - SYNACK
-	if((tcp->TCP_HdrFlags & SYN_FLAG) && (tcp->TCP_HdrFlags & ACK_FLAG))
-	{	
-		STACK_DEBUG("SYN ACK received\n");
-    
-    // Takes on entry as it is a client - are applying for the port
-		tcp_entry_add (eth_buffer);
-		// Was the listing successful?
-		index = tcp_entry_search (ip->IP_Srcaddr,tcp->TCP_SrcPort);
-    
-    tcp_entry[index].time        = TCP_TIME_OFF;
-		if (index >= MAX_TCP_ENTRY) //Found entry if not equal
-		{
-			STACK_DEBUG("TCP entry not successful!\n");
-			return;
-		}
-	
-		//tcp_entry[index].time = MAX_TCP_PORT_OPEN_TIME;
-		STACK_DEBUG("TCP port has been opened by the server STACK:%u\n",index);
-		result32 = htons32(tcp_entry[index].seq_counter) + 1;
-		tcp_entry[index].seq_counter = htons32(result32);
-		tcp_entry[index].status =  ACK_FLAG;
-    STACK_DEBUG("Sending ACK\n");
-		create_new_tcp_packet(0,index);
-		//Server port has been opened app . can now send data !
-		tcp_entry[index].app_status = 1;
-		return;
-	}
-	
-	// Connecting to us - SYN
-	if (tcp->TCP_HdrFlags == SYN_FLAG)
-	{
-		//Takes on entry as it is a server - are applying for the port
-		tcp_entry_add (eth_buffer);
-		//Was the listing successful?
-		index = tcp_entry_search (ip->IP_Srcaddr,tcp->TCP_SrcPort);
-		if (index >= MAX_TCP_ENTRY) //Found entry if not equal
-		{
-			STACK_DEBUG("TCP entry not successful!\n");
-			return;
-		}
-	
-		STACK_DEBUG("TCP New SERVER Conn:STACK:%u, SrcPort=%u\n",index, tcp->TCP_SrcPort);
-		
-		tcp_entry[index].status =  ACK_FLAG | SYN_FLAG;
-		create_new_tcp_packet(0,index);
-		return;
-	}
-
-	//Find Packet entry in the TCP stack !
-	index = tcp_entry_search (ip->IP_Srcaddr,tcp->TCP_SrcPort);
-	
-	if (index >= MAX_TCP_ENTRY) //Entry not found
-	{
-		STACK_DEBUG("TCP entry not found\n");
-    
-    if (tcp->TCP_HdrFlags == ACK_FLAG)
-    {
-      /* Could be a response to a FINACK flag sent by us, so ignore 
-        FIXME: Do this better, pretty sure this isn't right */
-      STACK_DEBUG("\t - Seemingly random ACK packet - ignoring\n");
-      return;
-    }
-		tcp_entry_add (eth_buffer);
-		if(tcp->TCP_HdrFlags & FIN_FLAG || tcp->TCP_HdrFlags & RST_FLAG)
-		{	
-      index = tcp_entry_search (ip->IP_Srcaddr,tcp->TCP_SrcPort);
-			result32 = htons32(tcp_entry[index].seq_counter) + 1;
-			tcp_entry[index].seq_counter = htons32(result32);
-			
-			if (tcp_entry[index].status & FIN_FLAG)
-			{
-        //STACK_DEBUG("Sending FIN/ACK to FIN\n");
-        STACK_DEBUG("Sending ACK to FIN\n");
-				tcp_entry[index].status = ACK_FLAG;
-				//tcp_entry[index].status = ACK_FLAG|FIN_FLAG;
-				create_new_tcp_packet(0,index);
-			}
-			tcp_index_del(index);
-			STACK_DEBUG("A->Deleted TCP stack entry! STACK:%u\n",index);
-			return;
-		}
-		return;
-	}
-
-
-	//Refresh the entry
-	tcp_entry_add (eth_buffer);
-	index = tcp_entry_search (ip->IP_Srcaddr,tcp->TCP_SrcPort);
-  
-	//Host wants to end connection! - FIN or RST
-	if(tcp_entry[index].status & FIN_FLAG || tcp_entry[index].status & RST_FLAG)
-	{	
-		result32 = htons32(tcp_entry[index].seq_counter) + 1;
-		tcp_entry[index].seq_counter = htons32(result32);
-		
-		if (tcp_entry[index].status & FIN_FLAG)
-		{
-      STACK_DEBUG("Calling function with FIN flag...\n");
-			// Announce the end of the application !
-			TCP_PORT_TABLE[port_index].fp(index, port_index);
-      STACK_DEBUG("B->ACKing FIN flag\n");
-			tcp_entry[index].status = ACK_FLAG;
-			create_new_tcp_packet(0,index);
-		}
-		tcp_index_del(index);
-		STACK_DEBUG("B->Deleted TCP stack entry! STACK:%u\n",index);
-		return;
-	}
-	
-	// Data for application - PSH && ACK
-	if((tcp_entry[index].status & PSH_FLAG) && 
-		(tcp_entry[index].status & ACK_FLAG))
-	{
-		// Run associated application
-		if(tcp_entry[index].app_status < 0xFFFE) tcp_entry[index].app_status++;	
-		//tcp_entry[index].status =  ACK_FLAG | PSH_FLAG;
-		tcp_entry[index].status =  ACK_FLAG;
-		TCP_PORT_TABLE[port_index].fp(index, port_index); 
-		return;
-	}
-	
-	//No data received packet was co nfirmed for application
-  //z.B . after the connection ( SYN packet )
-	if((tcp_entry[index].status & ACK_FLAG) && (tcp_entry[index].first_ack == 0))
-	{
-    union {
-    u32 theint;
-    u8 thech[4];
-  } remoteip; 
-    STACK_DEBUG("First ACK\n");
-		//No further action
-		tcp_entry[index].first_ack = 1;
-    /* If this is the first time we're in here, call connectcb */
-    STACK_DEBUG("serveHTTPD - call connectcb!\n");
-    tcp_entry[index].encconn.proto.tcp->connect_callback(&tcp_entry[index].encconn);
-		return;
-	}
-	
-	//Acknowledgment of receipt of a signal sent from the application package ( END )
-	if((tcp_entry[index].status & ACK_FLAG) && (tcp_entry[index].first_ack == 1))
-	{
-		//ACK for Connection release
-		if(tcp_entry[index].app_status == 0xFFFF)
-		{
-			return;
-		}
-    
-		// Run associated application
-		tcp_entry[index].status =  ACK_FLAG;
-		if(tcp_entry[index].app_status < 0xFFFE) tcp_entry[index].app_status++;
-		TCP_PORT_TABLE[port_index].fp(index, port_index); 
-		return;
-	}
-  
-	return;
-}
-
-sint8 stack_register_tcp_accept(struct espconn *espconn, u8 stack_func) {
-  u8 port_index;
-  
-  /* Register corresponding function to stack, and link to orig espconn */
-  switch (stack_func) {
-    case STACK_HTTPD:
-      port_index = add_tcp_app (espconn->proto.tcp->local_port, (void(*)(u8,u8))serveHTTPD, espconn);
-      break;
-    case STACK_MQTT:
-      break;
-    // Add in what ever other module you need here
-    default:
-      return 0;
-      break;
-  }
-  if (port_index < 0) {
-    return 0;
-  } 
-  return 1;  
-}
-
-void ICACHE_FLASH_ATTR serveHTTPD (u8 index, u8 port_index) { 
-  u16 dat_p;
-
-  if(tcp_entry[index].status & FIN_FLAG) {
-    // FIXME: Mark for destruction...
-    tcp_entry[index].encconn.state = ESPCONN_CLOSE;
-    tcp_entry[index].encconn.proto.tcp->disconnect_callback(&tcp_entry[index].encconn);
-    return;
-  }  
-  
-  STACK_DEBUG("appS==%u\n", tcp_entry[index].app_status);
-  if (tcp_entry[index].app_status == 1) { 
-    dat_p=TCP_DATA_END_VAR - TCP_DATA_START_VAR;
-    tcp_entry[index].encconn.recv_callback(&tcp_entry[index].encconn, 
-                                          (char *)&(eth_buffer[TCP_DATA_START]), 
-                                          dat_p);
-  }
-  
-  if (tcp_entry[index].app_status > 1) {
-    if(tcp_entry[index].status & ACK_FLAG) {
-      /* ACK to sent data - so call the sent callback */
-      tcp_entry[index].encconn.sent_callback (&tcp_entry[index].encconn);           
-    }      
-  } 
-}
-
-sint8 ICACHE_FLASH_ATTR stack_connDisconnect(struct espconn *conn) {
-   union {
-    u32 theint;
-    u8 thech[4];
-  } unionip;
-  u8 index;
-  
-  STACK_DEBUG("stack_connDisconnect - send FINACK\n");
-  
-  memcpy(unionip.thech, conn->proto.tcp->remote_ip,4);
-  index = tcp_entry_search (unionip.theint,conn->proto.tcp->remote_port);
-  
-  if (index >= MAX_TCP_ENTRY) {
-    STACK_DEBUG("HOUSTON WE HAVE A PROBLEM - no index found for sendData\r\n!");
-    // TODO: Catch this properly
-    conn = NULL;
-    return 0;
-  }
-  tcp_entry[index].encconn.state = ESPCONN_CLOSE;
-  tcp_entry[index].encconn.proto.tcp->disconnect_callback(&tcp_entry[index].encconn);
-  tcp_entry[index].status = ACK_FLAG | FIN_FLAG;          
-  create_new_tcp_packet(0,index);
-  tcp_index_del(index);
-  return 1;
-}
-
-sint8 ICACHE_FLASH_ATTR stack_sendData(struct espconn *conn, uint8_t *dataIn, u16 data_length) {
-  union {
-    u32 theint;
-    u8 thech[4];
-  } unionip;
-  u8 index;
-  
-  //STACK_DEBUG("sendData - searching for IP\n");
-  //STACK_DEBUG("LENGTH IS %u\n",data_length);
-  
-  /* Copy into send buffer the IP */
-  os_memcpy(&eth_buffer[TCP_DATA_START], dataIn, data_length);
-  
-  memcpy(unionip.thech, conn->proto.tcp->remote_ip,4);
-  index = tcp_entry_search (unionip.theint,conn->proto.tcp->remote_port);
-  if (index >= MAX_TCP_ENTRY) {
-    STACK_DEBUG("HOUSTON WE HAVE A PROBLEM - no index found for sendData\r\n!");
-    //FIXME: Catch this properly
-    return 0;
-  }
-  
-  tcp_entry[index].status = ACK_FLAG;  
-  create_new_tcp_packet(data_length,index);
-  return 1;
-}
-
-//----------------------------------------------------------------------------
-//This routine creates a new TCP Packet
-void ICACHE_FLASH_ATTR create_new_tcp_packet(u16 data_length,u8 index)
-{
-  u16  result16;
-  u32 result32;
-  u16  bufferlen;
-  
-  TCP_Header *tcp;
-  IP_Header  *ip;
-
-  tcp = (TCP_Header *)&eth_buffer[TCP_OFFSET];
-  ip  = (IP_Header  *)&eth_buffer[IP_OFFSET];
-
-  tcp->TCP_SrcPort   = tcp_entry[index].dest_port;
-  tcp->TCP_DestPort  = tcp_entry[index].src_port;
-  tcp->TCP_UrgentPtr = 0;
-  tcp->TCP_Window    = htons(MAX_WINDOWS_SIZE);
-  tcp->TCP_Hdrlen    = 0x50;
-
-  STACK_DEBUG("Sending to TCP Port %u\n", htons(tcp->TCP_DestPort));
-
-  result32 = htons32(tcp_entry[index].seq_counter); 
-
-  tcp->TCP_HdrFlags = tcp_entry[index].status;
-  
-  STACK_DEBUG("\t - Sending Flags= ");	
-  if(tcp->TCP_HdrFlags & SYN_FLAG) {	
-		STACK_DEBUG("SYN ");	
-	}
-  if(tcp->TCP_HdrFlags & ACK_FLAG) {	
-		STACK_DEBUG("ACK ");	
-	}
-  if(tcp->TCP_HdrFlags & RST_FLAG) {	
-		STACK_DEBUG("RST ");	
-	}
-  if(tcp->TCP_HdrFlags & PSH_FLAG) {	
-		STACK_DEBUG("PSH ");	
-	}
-  if(tcp->TCP_HdrFlags & FIN_FLAG) {	
-		STACK_DEBUG("FIN ");	
-	}
-  STACK_DEBUG("\n");
-  
-  //if (hackMACflag == 0) {
-    //Connection is established
-    if(tcp_entry[index].status & SYN_FLAG)
-    {
-        result32++;
-        // MSS-Option (siehe RFC 879) wil.
-        eth_buffer[TCP_DATA_START]   = 2;
-        eth_buffer[TCP_DATA_START+1] = 4;
-        eth_buffer[TCP_DATA_START+2] = (MAX_WINDOWS_SIZE >> 8) & 0xff;
-        eth_buffer[TCP_DATA_START+3] = MAX_WINDOWS_SIZE & 0xff;
-        data_length                  = 0x04;
-        tcp->TCP_Hdrlen              = 0x60;
-    }
-  //}
-
-  tcp->TCP_Acknum = htons32(result32);
-  tcp->TCP_Seqnum = tcp_entry[index].ack_counter;
-
-  bufferlen = IP_VERS_LEN + TCP_HDR_LEN + data_length;    //IP Headerlnge + TCP Headerlnge
-  ip->IP_Pktlen = htons(bufferlen);                      //Hier wird erstmal der IP Header neu erstellt
-  bufferlen += ETH_HDR_LEN;
-  ip->IP_Proto = PROT_TCP;
-  make_ip_header (eth_buffer,tcp_entry[index].ip);
-
-  tcp->TCP_Chksum = 0;
-
-  //Berechnet Headerlnge und Addiert Pseudoheaderlnge 2XIP = 8
-  result16 = htons(ip->IP_Pktlen) + 8;
-  result16 = result16 - ((ip->IP_Vers_Len & 0x0F) << 2);
-  result32 = result16 - 2;
-
-  //Checksum
-  result16 = checksum ((&ip->IP_Vers_Len+12), result16, result32);
-  tcp->TCP_Chksum = htons(result16);
-   
-  //Send the TCP packet
-  ETH_PACKET_SEND(bufferlen,eth_buffer);
-  eth.no_reset = 1;
-
-  //for Retransmission
-  tcp_entry[index].status = 0;
-  return;
-}
-
-//----------------------------------------------------------------------------
-//Diese Routine schliet einen offenen TCP-Port
-void ICACHE_FLASH_ATTR tcp_Port_close (u8 index)
-{
-	STACK_DEBUG("Port is closed in TCP stack STACK:%u\n",index);
-	tcp_entry[index].app_status = 0xFFFF;
-	tcp_entry[index].status =  ACK_FLAG | FIN_FLAG;
-	create_new_tcp_packet(0,index);
-	return;
-}
-
-//----------------------------------------------------------------------------
-//This routine finds the application using the TCP ports
-void ICACHE_FLASH_ATTR find_and_start (u8 index)
-{
-    u8 port_index = 0;
-
-    //site search with application in the list
-    while ( (TCP_PORT_TABLE[port_index].port!=(htons(tcp_entry[index].dest_port))) &&
-          (port_index < MAX_APP_ENTRY)                                                 )
-    { 
-        port_index++;
-    }
-    if (port_index >= MAX_APP_ENTRY) return;
-  
-    //associated application run ( Send repeat )
-    TCP_PORT_TABLE[port_index].fp(index, port_index);
-    return;
-}
-
-//----------------------------------------------------------------------------
-//This routine opens a TCP port
-void ICACHE_FLASH_ATTR tcp_port_open (u32 dest_ip,u16 port_dst,u16 port_src)
-{
-	u8 index;
-    
-	ETS_GPIO_INTR_DISABLE();
-		
-	//Find entry
-	for (index = 0;index<MAX_TCP_ENTRY;index++)
-	{
-		if(tcp_entry[index].ip == 0)
-		{
-			tcp_index_del(index);
-			tcp_entry[index].ip = dest_ip;
-			tcp_entry[index].src_port = port_dst;
-			tcp_entry[index].dest_port = port_src;
-			tcp_entry[index].ack_counter = 1234;
-			tcp_entry[index].seq_counter = 2345;
-			tcp_entry[index].time = MAX_TCP_PORT_OPEN_TIME;
-			STACK_DEBUG("TCP Open New Listing %u\n",index);
-			break;
-		}
-	}
-	if (index >= MAX_TCP_ENTRY)
-	{
-		//Entry could not be included
-		STACK_DEBUG("Busy (NO MORE CONNECTIONS)!\n");
-	}
-	
-	tcp_entry[index].status =  SYN_FLAG;
-	create_new_tcp_packet(0,index);
-	ETS_GPIO_INTR_ENABLE();
-	return;
-}
-
-//----------------------------------------------------------------------------
-//Diese Routine lscht einen Eintrag
-void ICACHE_FLASH_ATTR tcp_index_del (u8 index)
-{
-	if (index<MAX_TCP_ENTRY + 1)
-	{
-		tcp_entry[index].ip = 0;
-		tcp_entry[index].src_port = 0;
-		tcp_entry[index].dest_port = 0;
-		tcp_entry[index].ack_counter = 0;
-		tcp_entry[index].seq_counter = 0;
-		tcp_entry[index].status = 0;
-		tcp_entry[index].app_status = 0;
-		tcp_entry[index].time = 0;
-		tcp_entry[index].first_ack = 0;
-	}
-	return;
-}
-
-//----------------------------------------------------------------------------
-//End of file: stack.c
-
-
-
-
-
-
-
+/*
+-----------------------------------------------------------------------------------------
+Author:         Mark F (Cicero-MF) mark@cdelec.co.za    
+Known Issues:   none
+Version:        22.05.2016
+Description:    Simple Ethernet stack for the enc28j60 and an esp8266
+
+  This code was modified for use with the ESP8266, based off an original AVR version by  
+   Author:         Radig Ulrich mailto: mail@ulrichradig.de
+   Version:        24.10.2007
+   Description:    Ethernet Stack
+
+-----------------------------------------------------------------------------------------
+License:
+  This program is free software; you can redistribute it and/or modify it under
+  the terms of the GNU General Public License as published by the Free Software
+  Foundation; either version 2 of the License, or (at your option) any later
+  version.
+  This program is distributed in the hope that it will be useful, but
+
+  WITHOUT ANY WARRANTY;
+
+  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 51
+  Franklin St, Fifth Floor, Boston, MA 02110, USA
+
+  http://www.gnu.de/gpl-ger.html
+-----------------------------------------------------------------------------------------*/
+#include <esp8266.h>
+#include "globals.h"
+#include "stack.h"
+#include "io.h"
+#include "dhcpc.h"
+#include "ipfrag.h"
+#include "txqueue.h"
+#include "esp_enc_api.h"
+
+TCP_PORT_ITEM TCP_PORT_TABLE[MAX_APP_ENTRY] = // TCP port and function pairs
+{
+	{0},
+	{0},
+	{0} 
+};
+
+static void tcp_idle_touch (u8 index);
+static void tcp_packet_send (u16 data_length, u8 index, const u8 *data, u32 flash_addr);
+static void tcp_app_closed (u8 index, sint8 err);
+static void tcp_app_run (u8 index, u8 port_index);
+static u16 tcp_local_port (void);
+static void udp_packet_send (u8 *buffer, u16 data_length, u16 src_port, u16 dest_port, u32 dest_ip);
+static u8 udp_mcast_index (u32 group);
+static void igmp_input (void);
+
+UDP_PORT_ITEM UDP_PORT_TABLE[MAX_APP_ENTRY] = // UDP port and function pairs
+{
+	{0},
+	{0},
+	{0} 
+};
+
+/* Interfaces, one per ENC - addresses are loaded from sysCfg by stack_updateIPs */
+ethIf eth_if[ENC_DEVICES];
+ethIf *eth_cur = &eth_if[0];
+u16 IP_id_counter   = 0;
+
+/* Ethernet packet buffers */
+u8 eth_buffer[ETH_BUFFER_SIZE+1];
+
+arp_table arp_entry[MAX_ARP_ENTRY];
+
+//TCP Stack Size
+//+1 so that a connection can be dismissed at full stack
+tcp_table tcp_entry[MAX_TCP_ENTRY+1]; 
+
+PING_STRUCT ping;
+ethStruct eth;
+STACK_STATS stack_stats;
+static TOKEN_BUCKET icmp_bucket;
+static TOKEN_BUCKET rst_bucket;
+static ETSTimer ethLoopTimer;
+static os_event_t ethTaskQueue[ETH_TASK_QUEUE_LEN];
+static u16 eth_rx_length;
+extern u32 my1secTime;
+
+static void arp_probe_check (void);
+static u8 token_take (TOKEN_BUCKET *bucket, u8 rate, u8 burst);
+
+//----------------------------------------------------------------------------
+//Converts integer variables to network Byte order
+u16 ICACHE_FLASH_ATTR htons(u16 val)
+{
+  return HTONS(val);
+}
+//----------------------------------------------------------------------------
+//Converts integer variables to network Byte order
+u32 ICACHE_FLASH_ATTR htons32(u32 val)
+{
+  return HTONS32(val);
+}
+
+//----------------------------------------------------------------------------
+//Selects interface n and its ENC for everything that follows
+void ICACHE_FLASH_ATTR eth_if_use (u8 n)
+{
+	if (n >= ENC_DEVICES) return;
+	eth_cur = &eth_if[n];
+	ETH_USE(n);
+}
+
+//----------------------------------------------------------------------------
+//Interface to reach dest_ip (network order) over: the one whose subnet it is
+//on, else the first with a router. ETH_IF_NONE if no interface has an address
+u8 ICACHE_FLASH_ATTR eth_if_route (u32 dest_ip)
+{
+	u8 n, any = ETH_IF_NONE, gw = ETH_IF_NONE;
+
+	for (n = 0; n < ENC_DEVICES; n++)
+	{
+		u32 ip   = *((u32 *)&eth_if[n].myip[0]);
+		u32 mask = *((u32 *)&eth_if[n].netmask[0]);
+
+		if (ip == 0) continue;
+		if ((dest_ip & mask) == (ip & mask)) return n;
+		if (any == ETH_IF_NONE) any = n;
+		if (gw == ETH_IF_NONE && *((u32 *)&eth_if[n].router_ip[0]) != 0) gw = n;
+	}
+	return (gw != ETH_IF_NONE) ? gw : any;
+}
+
+//----------------------------------------------------------------------------
+//Receive task, posted by stack_encInterrupt. Drains the ENC up to the
+//budget and posts itself again if frames are left, so the SDK gets to run
+static void ICACHE_FLASH_ATTR ethTask (os_event_t *events)
+{
+	if (eth_get_data())
+	{
+		system_os_post(ETH_TASK_PRIO, ETH_SIG_RX, 0);
+	}
+}
+
+#ifdef ENC28J60
+static TW_TIMER encWatchdogTimer;
+
+//----------------------------------------------------------------------------
+//Inits all ENCs, device 0 first - its hardware reset takes the others down
+//too, so they always follow it
+static void ICACHE_FLASH_ATTR eth_init (void)
+{
+	u8 n;
+
+	for (n = 0; n < ENC_DEVICES; n++)
+	{
+		eth_if_use(n);
+		ETH_INIT();
+	}
+	eth_if_use(0);
+}
+
+//----------------------------------------------------------------------------
+//Ethernet OK?? - picks up a link change whose interrupt got lost and has the
+//driver look the ENC over. It fixes what it can itself, a full init is left
+//for when nothing less will do. A quiet wire alone is no reason for a reset
+static void ICACHE_FLASH_ATTR encWatchdogCb (void *arg)
+{
+	u8 done, n;
+
+	//The ENC is in loopback for the self test, nothing to look at until then
+	if(stack_selftest.running)
+	{
+		tw_arm(&encWatchdogTimer, ENC_HEALTH_TIME * 1000, encWatchdogCb, NULL);
+		return;
+	}
+	for(n = 0; n < ENC_DEVICES; n++)
+	{
+		eth_if_use(n);
+		stack_linkCheck();
+		//the link change may have run an app on another interface
+		eth_if_use(n);
+		done = ETH_HEALTH_CHECK(eth_cur->no_reset);
+		eth_cur->no_reset = 0;
+		if(done & ENC_RECOVER_INIT)
+		{
+			STACK_DEBUG("ENC%u rst ", n);
+			ETS_GPIO_INTR_DISABLE();
+			if(n == 0)
+			{
+				eth_init();
+			}
+			else
+			{
+				ETH_INIT();
+			}
+			enc28j60_led_blink (0);
+			ETS_GPIO_INTR_ENABLE();
+			//device 0 took the others with it, they are fresh
+			if(n == 0) break;
+		}
+		else if(done)
+		{
+			STACK_DEBUG("ENC%u recovered %x\n", n, done);
+		}
+	}
+	tw_arm(&encWatchdogTimer, ENC_HEALTH_TIME * 1000, encWatchdogCb, NULL);
+}
+
+//----------------------------------------------------------------------------
+//Applies the ENC settings in sysCfg. A CGI over the wire runs inside the
+//receive loop, and enc_configure starts the RX ring over - it has to wait
+//until the run is done and the response is out
+static TW_TIMER encConfigureTimer;
+
+static void ICACHE_FLASH_ATTR encConfigureCb (void *arg)
+{
+	if (stack_selftest.running)
+	{
+		tw_arm(&encConfigureTimer, ETH_CONFIGURE_DELAY, encConfigureCb, NULL);
+		return;
+	}
+	ETS_GPIO_INTR_DISABLE();
+	for (u8 n = 0; n < ENC_DEVICES; n++)
+	{
+		eth_if_use(n);
+		enc_configure();
+	}
+	if (!eth.data_present) ETS_GPIO_INTR_ENABLE();
+}
+
+void ICACHE_FLASH_ATTR stack_encConfigure (void)
+{
+	tw_arm(&encConfigureTimer, ETH_CONFIGURE_DELAY, encConfigureCb, NULL);
+}
+
+static void ICACHE_FLASH_ATTR ethLoopCb (void *arg) {
+
+	//INT is edge triggered - a frame that came in just as the interrupt was
+	//re-enabled leaves the line low without an edge, and a budget run out
+	//outside ethTask is not re-posted. Pick both up here, on every ENC
+	if(stack_selftest.running) return;
+	for(u8 n = 0; n < ENC_DEVICES; n++)
+	{
+		if(!GPIO_INPUT_GET(enc_dev[n].int_gpio))
+		{
+			ETS_GPIO_INTR_DISABLE();
+			eth.data_present = 1;
+			system_os_post(ETH_TASK_PRIO, ETH_SIG_RX, 0);
+			return;
+		}
+	}
+}
+
+#endif
+
+#ifdef ETH_LOSS_TEST
+static TW_TIMER lossReportTimer;
+
+//----------------------------------------------------------------------------
+//Loss test report - goodput is app data acked by the peers
+static void ICACHE_FLASH_ATTR lossReportCb (void *arg)
+{
+	static u32 acked_old;
+
+	os_printf("Loss %u%%: goodput %u B/s, dropped rx %u tx %u, rexmit fast %u partial %u rto %u\n",
+	          ETH_LOSS_TEST, (stack_stats.tcp_tx_acked - acked_old) * 1000 / ETH_LOSS_REPORT,
+	          stack_stats.loss_rx, stack_stats.loss_tx, stack_stats.tcp_fast_rexmit,
+	          stack_stats.tcp_partial_ack, stack_stats.tcp_rto_rexmit);
+	acked_old = stack_stats.tcp_tx_acked;
+	tw_arm(&lossReportTimer, ETH_LOSS_REPORT, lossReportCb, NULL);
+}
+#endif
+
+//----------------------------------------------------------------------------
+/* Initialise Stack, pull IP's, and init ENC */
+u32 ICACHE_FLASH_ATTR stack_init (void) {  
+  // Timer init - this is a free running 1sec timed function
+  timer_init();
+  // Timer wheel for the stack timers, millisecond resolution
+  tw_init();
+  #ifdef ETH_LOSS_TEST
+    tw_arm(&lossReportTimer, ETH_LOSS_REPORT, lossReportCb, NULL);
+  #endif
+  
+	arp_table_init();
+	system_os_task(ethTask, ETH_TASK_PRIO, ethTaskQueue, ETH_TASK_QUEUE_LEN);
+	#ifdef USE_IP_REASM
+		ip_reasm_init();
+	#endif
+
+	/* ENC init*/
+	STACK_DEBUG("\nInit ENC\n");
+	eth_init();
+  
+  /* Start the DHCP process if setip is 0, else just pass through */
+  if (sysCfg.setipaddr.theint == 0) {
+    dhcp_init();
+  } else {
+    /* Want static IP, so load it in */
+    #ifdef IPS_IN_UNION  
+      sysCfg.ethip.theint = sysCfg.setipaddr.theint;
+    #else
+      
+    #endif
+    stack_startEthTask();
+    stack_updateIPs();
+  }
+}
+
+void ICACHE_FLASH_ATTR stack_startEthTask (void) {
+  #ifdef ENC28J60
+    // receive is driven by the ENC interrupt, this only does the housekeeping
+    os_timer_disarm(&ethLoopTimer);
+    os_timer_setfn(&ethLoopTimer, ethLoopCb, NULL);
+    os_timer_arm(&ethLoopTimer, ETH_HOUSEKEEPING_TIME, 1);
+    tw_arm(&encWatchdogTimer, ENC_HEALTH_TIME * 1000, encWatchdogCb, NULL);
+     enc28j60_led_blink (1);
+  #endif  
+}
+
+void ICACHE_FLASH_ATTR stack_updateIPs (void) {
+  u8 n;
+  
+  /* Sort out ip's for local stack - eventually want to just use the sysCfg addrs.
+    The first interface has the DHCP/main ones, further ports their own */
+  #ifdef IPS_IN_UNION    
+    memcpy(eth_if[0].netmask,sysCfg.netmask.thech,4);
+    memcpy(eth_if[0].router_ip,sysCfg.router_ip.thech,4);
+    memcpy(eth_if[0].myip,sysCfg.ethip.thech,4);
+  #else
+    memcpy(eth_if[0].netmask,sysCfg.netmask,4);
+    memcpy(eth_if[0].router_ip,sysCfg.router_ip,4);
+    memcpy(eth_if[0].myip,sysCfg.ethip,4);
+  #endif
+  #if ENC_DEVICES > 1
+    for (n = 1; n < ENC_DEVICES; n++) {
+      memcpy(eth_if[n].netmask,&sysCfg.if_netmask[n-1],4);
+      memcpy(eth_if[n].router_ip,&sysCfg.if_router_ip[n-1],4);
+      memcpy(eth_if[n].myip,&sysCfg.if_ip[n-1],4);
+    }
+  #endif
+
+  for (n = 0; n < ENC_DEVICES; n++) {
+    eth_if_use(n);
+    /* TODO: Remove these u32 typecasts, use union method
+      Calculate broadcast address for now - if dhcp, this will be overwritten */
+    (*((u32*)&eth_cur->broadcast_ip[0])) = (((*((u32*)&eth_cur->myip[0])) & (*((u32*)&eth_cur->netmask[0]))) | (~(*((u32*)&eth_cur->netmask[0]))));
+
+    /* New address - make sure it is ours and let the LAN know (DHCP already probed it) */
+    if (*((u32*)&eth_cur->myip[0]) != arp_probe_ip()) {
+      arp_probe_start(*((u32*)&eth_cur->myip[0]));
+    }
+  }
+  eth_if_use(0);
+}
+
+/* Link of the current interface came (back) up - re-probe and announce its address */
+void ICACHE_FLASH_ATTR stack_linkUp (void) {
+  STACK_DEBUG("Link up %u\n", ETH_IF_INDEX());
+  if (*((u32*)&eth_cur->myip[0]) != 0 &&
+      arp_probe_state() != ARP_PROBE_PROBING && arp_probe_state() != ARP_PROBE_ANNOUNCING) {
+    arp_probe_start(*((u32*)&eth_cur->myip[0]));
+  }
+}
+
+/* Wired is up as long as one of the ports is */
+static u8 ICACHE_FLASH_ATTR stack_linksUp (void) {
+  u8 n;
+  
+  for (n = 0; n < ENC_DEVICES; n++) {
+    if (eth_if[n].link_up) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* Link state of the current interface as the PHY has it now, called for
+  LINKIF and by the watchdog in case an interrupt got lost. Up announces our
+  address and checks the DHCP lease, down drops the TCP connections over it -
+  the peers can't be told, the apps are. Routed client connections go over
+  to wifi first when the last port is down */
+void ICACHE_FLASH_ATTR stack_linkCheck (void) {
+  u8 up = ETH_LINK_UP() ? 1 : 0;
+  u8 iface = ETH_IF_INDEX();
+  u8 index;
+  
+  if (up == eth_cur->link_up) {
+    return;
+  }
+  eth_cur->link_up = up;
+  
+  if (up) {
+    stack_stats.link_up++;
+    stack_linkUp();
+    #ifdef USE_DHCP
+      if (sysCfg.setipaddr.theint == 0 && iface == 0) {
+        dhcp_link_up();
+      }
+    #endif
+    esp_enc_api_link_change(ESP_ENC_IF_WIRED, 1);
+    return;
+  }
+  
+  STACK_DEBUG("Link down %u\n", iface);
+  stack_stats.link_down++;
+  esp_enc_api_link_change(ESP_ENC_IF_WIRED, stack_linksUp());
+  for (index = 0; index < MAX_TCP_ENTRY; index++) {
+    if (tcp_entry[index].ip == 0 || tcp_entry[index].iface != iface) {
+      continue;
+    }
+    stack_stats.tcp_link_abort++;
+    tcp_app_closed(index, ESPCONN_CONN);
+    tcp_index_del(index);
+  }
+}
+
+
+
+static void tcp_output (u8 index);
+
+//----------------------------------------------------------------------------
+//Retransmit timeout of a TCP entry ran out
+static void ICACHE_FLASH_ATTR tcp_entry_timeout (void *arg)
+{
+	u8 index = (tcp_table *)arg - tcp_entry;
+
+	if (tcp_entry[index].ip == 0) return;
+	eth_if_use(tcp_entry[index].iface);
+
+	tcp_entry_timer(index, TCP_MAX_ENTRY_TIME);
+	if (tcp_entry[index].client && !tcp_entry[index].first_ack)
+	{
+		//Connect of ours - SYN again until MAX_TCP_PORT_OPEN_TIME is up
+		if (++tcp_entry[index].error_count * TCP_MAX_ENTRY_TIME >= MAX_TCP_PORT_OPEN_TIME)
+		{
+			STACK_DEBUG("Connect timed out STACK:%u\n",index);
+			tcp_app_closed(index, ESPCONN_TIMEOUT);
+			tcp_index_del(index);
+			return;
+		}
+		tcp_entry[index].status = SYN_FLAG;
+		create_new_tcp_packet(0,index);
+		return;
+	}
+	if ((tcp_entry[index].error_count++) > MAX_TCP_ERRORCOUNT)
+	{
+		STACK_DEBUG("Entry is removed MAX_ERROR STACK:%u\n",index);
+		ETS_GPIO_INTR_DISABLE(); //ETH_INT_DISABLE;
+		tcp_entry[index].status =  RST_FLAG | ACK_FLAG;
+		create_new_tcp_packet(0,index);
+		ETS_GPIO_INTR_ENABLE(); //ETH_INT_ENABLE;
+		tcp_app_closed(index, ESPCONN_TIMEOUT);
+		tcp_index_del(index);
+	}
+	else if (tcp_tx_pending(index))
+	{
+		//Go back to the oldest unacked byte and send it all again
+		STACK_DEBUG("Packet is retransmitted STACK:%u\n",index);
+		stack_stats.tcp_rto_rexmit++;
+		tcp_entry[index].snd_nxt     = tcp_entry[index].snd_una;
+		tcp_entry[index].dupacks     = 0;
+		tcp_entry[index].in_recovery = 0;
+		tcp_entry[index].tx_rexmit   = 0;
+		tcp_output(index);
+	}
+	else if (tcp_entry[index].app_status == 0xFFFF)
+	{
+		//Our FIN is still unanswered
+		tcp_entry[index].status = ACK_FLAG | FIN_FLAG;
+		create_new_tcp_packet(0,index);
+	}
+	else
+	{
+		find_and_start (index);
+	}
+}
+
+//----------------------------------------------------------------------------
+//Management of TCP timer - (re)starts the timeout of an entry in seconds,
+//0 or TCP_TIME_OFF stops it
+void ICACHE_FLASH_ATTR tcp_entry_timer (u8 index, u8 time)
+{
+	tcp_entry[index].time = time;
+	if (time == 0 || time == TCP_TIME_OFF)
+	{
+		tw_cancel(&tcp_entry[index].timer);
+	}
+	else
+	{
+		tw_arm(&tcp_entry[index].timer, (u32)time * 1000, tcp_entry_timeout, &tcp_entry[index]);
+	}
+}
+
+//----------------------------------------------------------------------------
+//Receive window of an entry, out of the free ENC RX ring. Less than a full
+//segment counts as closed (no silly windows), so does an app holding data
+static u16 ICACHE_FLASH_ATTR tcp_rx_window (u8 index)
+{
+	u16 used = ETH_RX_USED();
+	u16 window;
+
+	if (tcp_entry[index].rx_hold || used + TCP_RX_RESERVE + TCP_MSS > ENC_RX_BUFFER_SIZE)
+	{
+		return 0;
+	}
+	window = ENC_RX_BUFFER_SIZE - TCP_RX_RESERVE - used;
+	return (window > TCP_RX_WINDOW_MAX) ? TCP_RX_WINDOW_MAX : window;
+}
+
+//----------------------------------------------------------------------------
+//Out of order queue - bytes held in it, all connections
+static u16 tcp_ooo_bytes;
+
+static void ICACHE_FLASH_ATTR tcp_ooo_free (u8 index)
+{
+	TCP_OOO_SEG *seg;
+
+	while ((seg = tcp_entry[index].ooo) != NULL)
+	{
+		tcp_entry[index].ooo = seg->next;
+		tcp_ooo_bytes -= seg->len;
+		os_free(seg);
+	}
+}
+
+//----------------------------------------------------------------------------
+//Keeps a segment that arrived ahead of a gap, sorted in by seq
+static void ICACHE_FLASH_ATTR tcp_ooo_store (u8 index, u32 seq, u8 *data, u16 len)
+{
+	TCP_OOO_SEG **link = &tcp_entry[index].ooo;
+	TCP_OOO_SEG *seg;
+
+	while (*link && (s32)((*link)->seq - seq) < 0) link = &(*link)->next;
+	if (*link && (*link)->seq == seq && (*link)->len >= len)
+	{
+		stack_stats.tcp_rx_dup++;
+		return;
+	}
+	if (tcp_ooo_bytes + len > TCP_OOO_MAX ||
+	    (seg = (TCP_OOO_SEG *)os_malloc(sizeof(TCP_OOO_SEG) + len)) == NULL)
+	{
+		stack_stats.tcp_rx_ooo_drop++;
+		return;
+	}
+	seg->seq  = seq;
+	seg->len  = len;
+	os_memcpy(seg->data, data, len);
+	seg->next = *link;
+	*link     = seg;
+	tcp_ooo_bytes += len;
+	stack_stats.tcp_rx_ooo++;
+}
+
+//----------------------------------------------------------------------------
+//Sorts a segment of an established connection by its sequence number. In
+//order goes on as it is, old data in front is cut off, anything ahead of a
+//gap is queued. Duplicates and gaps are acked at once, so the peer's fast
+//retransmit gets going. Returns 0 if there is nothing more to do with it
+static u8 ICACHE_FLASH_ATTR tcp_rx_sequence (u8 index, u16 *data_len)
+{
+	TCP_Header *tcp = (TCP_Header *)&eth_buffer[TCP_OFFSET];
+	IP_Header  *ip  = (IP_Header  *)&eth_buffer[IP_OFFSET];
+	u32 seq     = htons32(tcp->TCP_Seqnum);
+	u32 rcv_nxt = htons32(tcp_entry[index].seq_counter);
+	u16 trim;
+
+	if (seq == rcv_nxt) return 1;
+
+	if ((s32)(seq - rcv_nxt) < 0 && (s32)(seq + *data_len - rcv_nxt) > 0)
+	{
+		//Retransmit overlapping what we have - keep only the new part
+		trim = rcv_nxt - seq;
+		stack_stats.tcp_rx_trim++;
+		os_memmove(&eth_buffer[TCP_DATA_START_VAR], &eth_buffer[TCP_DATA_START_VAR + trim], *data_len - trim);
+		ip->IP_Pktlen   = htons(htons(ip->IP_Pktlen) - trim);
+		tcp->TCP_Seqnum = htons32(rcv_nxt);
+		*data_len -= trim;
+		return 1;
+	}
+
+	if ((s32)(seq - rcv_nxt) > 0 && *data_len)
+	{
+		//Ahead of a gap - a FIN on it comes again with the retransmit
+		tcp_ooo_store(index, seq, &eth_buffer[TCP_DATA_START_VAR], *data_len);
+	}
+	else if (*data_len || (tcp->TCP_HdrFlags & FIN_FLAG))
+	{
+		stack_stats.tcp_rx_dup++;
+	}
+	stack_stats.tcp_dupack++;
+	tcp_entry[index].status = ACK_FLAG;
+	create_new_tcp_packet(0,index);
+	return 0;
+}
+
+//----------------------------------------------------------------------------
+//Hands the queued segments the last one connected up with to the app, each
+//rebuilt in eth_buffer as if it had just come in. Returns the bytes delivered
+static u16 ICACHE_FLASH_ATTR tcp_ooo_deliver (u8 index, u8 port_index)
+{
+	TCP_Header *tcp = (TCP_Header *)&eth_buffer[TCP_OFFSET];
+	IP_Header  *ip  = (IP_Header  *)&eth_buffer[IP_OFFSET];
+	TCP_OOO_SEG *seg;
+	u32 rcv_nxt;
+	u16 off, len, total = 0;
+
+	while (tcp_entry[index].ip && (seg = tcp_entry[index].ooo) != NULL)
+	{
+		rcv_nxt = htons32(tcp_entry[index].seq_counter);
+		if ((s32)(seg->seq - rcv_nxt) > 0) break;   //still a gap
+
+		tcp_entry[index].ooo = seg->next;
+		tcp_ooo_bytes -= seg->len;
+		off = rcv_nxt - seg->seq;
+		if (off < seg->len)
+		{
+			len = seg->len - off;
+			ip->IP_Vers_Len    = 0x45;
+			ip->IP_Pktlen      = htons(IP_VERS_LEN + TCP_HDR_LEN + len);
+			ip->IP_Srcaddr     = tcp_entry[index].ip;
+			tcp->TCP_SrcPort   = tcp_entry[index].src_port;
+			tcp->TCP_DestPort  = tcp_entry[index].dest_port;
+			tcp->TCP_Seqnum    = htons32(rcv_nxt);
+			tcp->TCP_Hdrlen    = 0x50;
+			tcp->TCP_HdrFlags  = ACK_FLAG | PSH_FLAG;
+			os_memcpy(&eth_buffer[TCP_DATA_START], &seg->data[off], len);
+
+			stack_stats.tcp_rx_ooo_fill++;
+			tcp_entry[index].seq_counter = htons32(rcv_nxt + len);
+			tcp_entry[index].status = ACK_FLAG;
+			if(tcp_entry[index].app_status < 0xFFFE) tcp_entry[index].app_status++;
+			tcp_app_run(index, port_index);
+			total += len;
+		}
+		os_free(seg);
+	}
+	return total;
+}
+
+//----------------------------------------------------------------------------
+//Data was given to the app - acknowledge it unless the app already has,
+//piggybacked on whatever it sent back
+static void ICACHE_FLASH_ATTR tcp_ack_data (u8 index, u16 data_len)
+{
+	if (data_len == 0 || tcp_entry[index].ip == 0) return;
+	if (tcp_entry[index].rx_edge - tcp_entry[index].rx_window == htons32(tcp_entry[index].seq_counter)) return;
+
+	tcp_entry[index].status = ACK_FLAG;
+	create_new_tcp_packet(0,index);
+}
+
+//----------------------------------------------------------------------------
+//Sends len bytes of the send buffer starting at seq. ack_counter is left at
+//the next new sequence number, segments without data carry that
+static void ICACHE_FLASH_ATTR tcp_send_segment (u8 index, u32 seq, u16 len)
+{
+	u32 snd_nxt = ((s32)(seq + len - tcp_entry[index].snd_nxt) > 0) ? seq + len : tcp_entry[index].snd_nxt;
+
+	tcp_entry[index].ack_counter = htons32(seq);
+	tcp_entry[index].status = ACK_FLAG;
+	if (seq + len == tcp_entry[index].tx_seq + tcp_entry[index].tx_len)
+	{
+		tcp_entry[index].status |= PSH_FLAG;
+	}
+	if (tcp_entry[index].tx_buf)
+	{
+		tcp_packet_send(len, index, &tcp_entry[index].tx_buf[seq - tcp_entry[index].tx_seq], 0);
+	}
+	else
+	{
+		tcp_packet_send(len, index, NULL, tcp_entry[index].tx_flash + (seq - tcp_entry[index].tx_seq));
+	}
+	tcp_entry[index].ack_counter = htons32(snd_nxt);
+	tcp_entry_timer(index, TCP_MAX_ENTRY_TIME);
+}
+
+//----------------------------------------------------------------------------
+//Sends an ACK one byte behind what the peer has acked - it has to answer
+//with an ACK of its own, carrying its current window. Used as zero window
+//and as keepalive probe
+static void ICACHE_FLASH_ATTR tcp_send_probe (u8 index)
+{
+	u32 seq = tcp_entry[index].ack_counter;
+
+	tcp_entry[index].ack_counter = htons32(htons32(seq) - 1);
+	tcp_entry[index].status = ACK_FLAG;
+	create_new_tcp_packet(0,index);
+	tcp_entry[index].ack_counter = seq;
+}
+
+//----------------------------------------------------------------------------
+//Zero window probe
+static void ICACHE_FLASH_ATTR tcp_persist_timeout (void *arg)
+{
+	u8 index = (tcp_table *)arg - tcp_entry;
+
+	if (tcp_entry[index].ip == 0 || !tcp_tx_pending(index)) return;
+	eth_if_use(tcp_entry[index].iface);
+
+	stack_stats.tcp_persist_probe++;
+	tcp_send_probe(index);
+
+	if (tcp_entry[index].persist_time < TCP_PERSIST_MAX / 2)
+	{
+		tcp_entry[index].persist_time <<= 1;
+	}
+	else
+	{
+		tcp_entry[index].persist_time = TCP_PERSIST_MAX;
+	}
+	tw_arm(&tcp_entry[index].persist_timer, tcp_entry[index].persist_time, tcp_persist_timeout, arg);
+}
+
+//----------------------------------------------------------------------------
+//The app listening on a local port (host order), MAX_APP_ENTRY if none
+static u8 ICACHE_FLASH_ATTR tcp_app_index_port (u16 port)
+{
+	u8 port_index;
+
+	for (port_index = 0; port_index < MAX_APP_ENTRY; port_index++)
+	{
+		if (TCP_PORT_TABLE[port_index].port && TCP_PORT_TABLE[port_index].port == port)
+		{
+			break;
+		}
+	}
+	return port_index;
+}
+
+//The app the entry belongs to, MAX_APP_ENTRY if none
+static u8 ICACHE_FLASH_ATTR tcp_app_index (u8 index)
+{
+	if (tcp_entry[index].client) return MAX_APP_ENTRY;
+	return tcp_app_index_port(htons(tcp_entry[index].dest_port));
+}
+
+//----------------------------------------------------------------------------
+//Connection is gone without a FIN - tell the app, so it can let go of it
+//(httpd frees the connData slot on the disconnect callback). A connect of
+//ours that never came up gets the reconnect callback with err instead,
+//like espconn_connect
+static void ICACHE_FLASH_ATTR tcp_app_closed (u8 index, sint8 err)
+{
+	u8 port_index = tcp_app_index(index);
+
+	if (!tcp_entry[index].client &&
+	    (port_index >= MAX_APP_ENTRY || !TCP_PORT_TABLE[port_index].espconn)) return;
+	if (tcp_entry[index].encconn.proto.tcp != &tcp_entry[index].tcp_data) return;
+
+	tcp_entry[index].encconn.state = ESPCONN_CLOSE;
+	if (tcp_entry[index].client && !tcp_entry[index].first_ack)
+	{
+		stack_stats.tcp_connect_fail++;
+		if (tcp_entry[index].tcp_data.reconnect_callback)
+		{
+			tcp_entry[index].tcp_data.reconnect_callback(&tcp_entry[index].encconn, err);
+		}
+		return;
+	}
+	if (tcp_entry[index].tcp_data.disconnect_callback)
+	{
+		tcp_entry[index].tcp_data.disconnect_callback(&tcp_entry[index].encconn);
+	}
+}
+
+//----------------------------------------------------------------------------
+//Runs the app behind an entry - the one listening on its port, connects of
+//ours are plain espconns and get the same dispatch as the httpd
+static void ICACHE_FLASH_ATTR tcp_app_run (u8 index, u8 port_index)
+{
+	if (tcp_entry[index].client)
+	{
+		serveHTTPD(index, port_index);
+	}
+	else
+	{
+		TCP_PORT_TABLE[port_index].fp(index, port_index);
+	}
+}
+
+//----------------------------------------------------------------------------
+//Nothing heard from the peer for a while - probe it, and drop the entry once
+//the probes have gone unanswered
+static void ICACHE_FLASH_ATTR tcp_idle_timeout (void *arg)
+{
+	u8 index = (tcp_table *)arg - tcp_entry;
+	u8 port_index = tcp_app_index(index);
+	u8 intvl = TCP_KEEPALIVE_INTVL;
+	u8 cnt = TCP_KEEPALIVE_CNT;
+
+	if (tcp_entry[index].ip == 0) return;
+	eth_if_use(tcp_entry[index].iface);
+	if (port_index < MAX_APP_ENTRY)
+	{
+		intvl = TCP_PORT_TABLE[port_index].keepalive_intvl;
+		cnt   = TCP_PORT_TABLE[port_index].keepalive_cnt;
+	}
+
+	if (tcp_entry[index].ka_probes < cnt)
+	{
+		STACK_DEBUG("Keepalive probe STACK:%u\n",index);
+		stack_stats.tcp_ka_probe++;
+		tcp_entry[index].ka_probes++;
+		tcp_send_probe(index);
+		tw_arm(&tcp_entry[index].idle_timer, (u32)intvl * 1000, tcp_idle_timeout, arg);
+		return;
+	}
+
+	STACK_DEBUG("Idle entry is removed STACK:%u\n",index);
+	stack_stats.tcp_reaped++;
+	tcp_entry[index].status = RST_FLAG | ACK_FLAG;
+	create_new_tcp_packet(0,index);
+	tcp_app_closed(index, ESPCONN_TIMEOUT);
+	tcp_index_del(index);
+}
+
+//----------------------------------------------------------------------------
+//Something came in from the peer - restart the idle timeout of the entry
+static void ICACHE_FLASH_ATTR tcp_idle_touch (u8 index)
+{
+	u8 port_index = tcp_app_index(index);
+	u16 idle = TCP_IDLE_TIME;
+
+	if (port_index < MAX_APP_ENTRY) idle = TCP_PORT_TABLE[port_index].idle_time;
+
+	tcp_entry[index].ka_probes = 0;
+	if (idle)
+	{
+		tw_arm(&tcp_entry[index].idle_timer, (u32)idle * 1000, tcp_idle_timeout, &tcp_entry[index]);
+	}
+	else
+	{
+		tw_cancel(&tcp_entry[index].idle_timer);
+	}
+}
+
+//----------------------------------------------------------------------------
+//Sends as much of the send buffer as the peer's window takes, a segment at
+//a time. A closed window with nothing in flight starts the zero window
+//probes, retransmit timeouts are off meanwhile - a peer answering the
+//probes is still there
+static void ICACHE_FLASH_ATTR tcp_output (u8 index)
+{
+	u32 end;
+	u16 flight, room, len;
+
+	if (!tcp_tx_pending(index)) return;
+	end = tcp_entry[index].tx_seq + tcp_entry[index].tx_len;
+
+	while (tcp_entry[index].snd_nxt != end)
+	{
+		flight = tcp_entry[index].snd_nxt - tcp_entry[index].snd_una;
+		room   = (tcp_entry[index].tx_window > flight) ? tcp_entry[index].tx_window - flight : 0;
+		len    = end - tcp_entry[index].snd_nxt;
+		if (len > TCP_MSS) len = TCP_MSS;
+
+		if (room < len)
+		{
+			if (flight) break;  //acks in flight will open it
+			if (room == 0)
+			{
+				if (!tw_active(&tcp_entry[index].persist_timer))
+				{
+					STACK_DEBUG("Zero window, holding %u bytes STACK:%u\n", end - tcp_entry[index].snd_nxt, index);
+					stack_stats.tcp_persist++;
+					tcp_entry_timer(index, TCP_TIME_OFF);
+					tcp_entry[index].persist_time = TCP_PERSIST_MIN;
+					tw_arm(&tcp_entry[index].persist_timer, TCP_PERSIST_MIN, tcp_persist_timeout, &tcp_entry[index]);
+				}
+				break;
+			}
+			len = room;
+		}
+		tw_cancel(&tcp_entry[index].persist_timer);
+		tcp_send_segment(index, tcp_entry[index].snd_nxt, len);
+		tcp_entry[index].snd_nxt += len;
+	}
+}
+
+//----------------------------------------------------------------------------
+//Resends the oldest unacked segment
+static void ICACHE_FLASH_ATTR tcp_retransmit (u8 index)
+{
+	u32 len = tcp_entry[index].tx_seq + tcp_entry[index].tx_len - tcp_entry[index].snd_una;
+
+	if (len > TCP_MSS) len = TCP_MSS;
+	if (len) tcp_send_segment(index, tcp_entry[index].snd_una, len);
+}
+
+//----------------------------------------------------------------------------
+//ACK processing for the send buffer. New data acked moves snd_una on, dup
+//acks (no data, same window) start a fast retransmit and NewReno recovery:
+//partial acks retransmit the next hole until everything up to recover is
+//acked. Sending is left to tcp_poll, eth_buffer still holds this segment.
+//Returns 1 once the whole buffer is acked - the app gets its sent callback
+static u8 ICACHE_FLASH_ATTR tcp_ack_input (u8 index, u32 ack, u16 data_len, u16 old_window)
+{
+	u32 flight;
+	u8 thresh;
+
+	if ((s32)(ack - tcp_entry[index].snd_una) > 0 && (s32)(ack - tcp_entry[index].snd_nxt) <= 0)
+	{
+		stack_stats.tcp_tx_acked += ack - tcp_entry[index].snd_una;
+		tcp_entry[index].snd_una     = ack;
+		tcp_entry[index].dupacks     = 0;
+		tcp_entry[index].error_count = 0;
+
+		if (tcp_entry[index].in_recovery)
+		{
+			if ((s32)(ack - tcp_entry[index].recover) >= 0)
+			{
+				tcp_entry[index].in_recovery = 0;
+			}
+			else
+			{
+				stack_stats.tcp_partial_ack++;
+				tcp_entry[index].tx_rexmit = 1;
+			}
+		}
+
+		if (ack == tcp_entry[index].tx_seq + tcp_entry[index].tx_len)
+		{
+			tcp_entry_timer(index, TCP_TIME_OFF);
+			if (tcp_entry[index].tx_buf) os_free(tcp_entry[index].tx_buf);
+			tcp_entry[index].tx_buf      = NULL;
+			tcp_entry[index].tx_flash    = 0;
+			tcp_entry[index].in_recovery = 0;
+			tcp_entry[index].tx_rexmit   = 0;
+			return 1;
+		}
+		return 0;
+	}
+
+	flight = tcp_entry[index].snd_nxt - tcp_entry[index].snd_una;
+	if (ack != tcp_entry[index].snd_una || data_len || flight == 0 ||
+	    tcp_entry[index].tx_window != old_window)
+	{
+		return 0;
+	}
+
+	//Too few segments in flight for three dup acks - lower the threshold
+	//(early retransmit), a single segment is left to the timeout
+	flight = (flight + TCP_MSS - 1) / TCP_MSS;
+	if (flight < 2) return 0;
+	thresh = (flight > TCP_DUPACK_THRESH) ? TCP_DUPACK_THRESH : flight - 1;
+
+	if (++tcp_entry[index].dupacks == thresh && !tcp_entry[index].in_recovery)
+	{
+		STACK_DEBUG("Fast retransmit STACK:%u\n",index);
+		stack_stats.tcp_fast_rexmit++;
+		tcp_entry[index].in_recovery = 1;
+		tcp_entry[index].recover     = tcp_entry[index].snd_nxt;
+		tcp_entry[index].tx_rexmit   = 1;
+	}
+	return 0;
+}
+
+//----------------------------------------------------------------------------
+//Once the RX rings have been drained: retransmits and new segments for the
+//send buffers, window updates for connections whose receive window had
+//closed and has room again
+void ICACHE_FLASH_ATTR tcp_poll (void)
+{
+	for (u8 index = 0; index < MAX_TCP_ENTRY; index++)
+	{
+		if (tcp_entry[index].ip == 0) continue;
+		eth_if_use(tcp_entry[index].iface);
+
+		if (tcp_tx_pending(index))
+		{
+			if (tcp_entry[index].tx_rexmit)
+			{
+				tcp_entry[index].tx_rexmit = 0;
+				tcp_retransmit(index);
+			}
+			tcp_output(index);
+		}
+
+		if (tcp_entry[index].rx_window == 0 && tcp_entry[index].first_ack && tcp_rx_window(index))
+		{
+			stack_stats.tcp_wnd_update++;
+			tcp_entry[index].status = ACK_FLAG;
+			create_new_tcp_packet(0,index);
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+//ARP cache - entries hang off arp_hash[] by IP, and are kept in a LRU list
+//(head = most recently used) so a full table evicts the oldest peer instead of
+//refusing new ones. Entries carry an expiry timestamp, stale ones are dropped
+//when they are looked up, so there is no periodic scan of the table. The
+//table is shared by the interfaces, an entry is for the one it was learned on
+static u8 arp_hash[ARP_HASH_SIZE];
+static u8 arp_free_head;
+static u8 arp_lru_head;
+static u8 arp_lru_tail;
+
+static u8 ICACHE_FLASH_ATTR arp_hash_ip (u32 ip)
+{
+	ip ^= (ip >> 16);
+	ip ^= (ip >> 8);
+	return (ip & (ARP_HASH_SIZE-1));
+}
+
+//Set up empty hash buckets, LRU list and the free list
+void ICACHE_FLASH_ATTR arp_table_init (void)
+{
+	u8 a;
+
+	for (a = 0; a < ARP_HASH_SIZE; a++)
+	{
+		arp_hash[a] = ARP_NO_ENTRY;
+	}
+	for (a = 0; a < MAX_ARP_ENTRY; a++)
+	{
+		os_memset((void *)&arp_entry[a], 0, sizeof(arp_table));
+		arp_entry[a].arp_t_hnext = (a+1 < MAX_ARP_ENTRY) ? a+1 : ARP_NO_ENTRY;
+		arp_entry[a].arp_t_lprev = ARP_NO_ENTRY;
+		arp_entry[a].arp_t_lnext = ARP_NO_ENTRY;
+	}
+	arp_free_head = 0;
+	arp_lru_head  = ARP_NO_ENTRY;
+	arp_lru_tail  = ARP_NO_ENTRY;
+}
+
+static void ICACHE_FLASH_ATTR arp_lru_unlink (u8 b)
+{
+	if (arp_entry[b].arp_t_lprev != ARP_NO_ENTRY)
+		arp_entry[arp_entry[b].arp_t_lprev].arp_t_lnext = arp_entry[b].arp_t_lnext;
+	else
+		arp_lru_head = arp_entry[b].arp_t_lnext;
+
+	if (arp_entry[b].arp_t_lnext != ARP_NO_ENTRY)
+		arp_entry[arp_entry[b].arp_t_lnext].arp_t_lprev = arp_entry[b].arp_t_lprev;
+	else
+		arp_lru_tail = arp_entry[b].arp_t_lprev;
+
+	arp_entry[b].arp_t_lprev = ARP_NO_ENTRY;
+	arp_entry[b].arp_t_lnext = ARP_NO_ENTRY;
+}
+
+static void ICACHE_FLASH_ATTR arp_lru_touch (u8 b)
+{
+	if (arp_lru_head == b) return;
+	arp_lru_unlink(b);
+	arp_entry[b].arp_t_lnext = arp_lru_head;
+	if (arp_lru_head != ARP_NO_ENTRY) arp_entry[arp_lru_head].arp_t_lprev = b;
+	arp_lru_head = b;
+	if (arp_lru_tail == ARP_NO_ENTRY) arp_lru_tail = b;
+}
+
+//Unlink from hash chain + LRU and give the entry back to the free list
+static void ICACHE_FLASH_ATTR arp_entry_free (u8 b)
+{
+	u8 *link = &arp_hash[arp_hash_ip(arp_entry[b].arp_t_ip)];
+
+	while (*link != ARP_NO_ENTRY)
+	{
+		if (*link == b)
+		{
+			*link = arp_entry[b].arp_t_hnext;
+			break;
+		}
+		link = (u8 *)&arp_entry[*link].arp_t_hnext;
+	}
+	arp_lru_unlink(b);
+	arp_entry[b].arp_t_ip      = 0;
+	arp_entry[b].arp_t_hnext   = arp_free_head;
+	arp_free_head              = b;
+}
+
+//Hash lookup on the current interface, stale entries are freed on the way
+static u8 ICACHE_FLASH_ATTR arp_entry_find (u32 ip)
+{
+	u8 b = arp_hash[arp_hash_ip(ip)];
+
+	while (b != ARP_NO_ENTRY)
+	{
+		if (arp_entry[b].arp_t_ip == ip && arp_entry[b].arp_t_if == ETH_IF_INDEX())
+		{
+			if ((s32)(my1secTime - arp_entry[b].arp_t_expire) >= 0)
+			{
+				arp_entry_free(b);
+				return ARP_NO_ENTRY;
+			}
+			return b;
+		}
+		b = arp_entry[b].arp_t_hnext;
+	}
+	return ARP_NO_ENTRY;
+}
+
+//Insert or refresh a mapping - evicts the least recently used entry if full
+static void ICACHE_FLASH_ATTR arp_entry_update (u32 ip, volatile u8 *mac)
+{
+	u8 b;
+	u8 h;
+
+	if (ip == 0) return;
+
+	b = arp_entry_find(ip);
+	if (b == ARP_NO_ENTRY)
+	{
+		if (arp_free_head == ARP_NO_ENTRY)
+		{
+			STACK_DEBUG("ARP table full, evicting LRU entry %u\n", arp_lru_tail);
+			arp_entry_free(arp_lru_tail);
+		}
+		b = arp_free_head;
+		arp_free_head = arp_entry[b].arp_t_hnext;
+
+		h = arp_hash_ip(ip);
+		arp_entry[b].arp_t_ip    = ip;
+		arp_entry[b].arp_t_if    = ETH_IF_INDEX();
+		arp_entry[b].arp_t_hnext = arp_hash[h];
+		arp_hash[h]              = b;
+	}
+	for(u8 a = 0; a < 6; a++)
+	{
+		arp_entry[b].arp_t_mac[a] = mac[a];
+	}
+	arp_entry[b].arp_t_expire  = my1secTime + ARP_MAX_ENTRY_TIME;
+	arp_entry[b].arp_t_refresh = 0;
+	arp_lru_touch(b);
+}
+
+//----------------------------------------------------------------------------
+// Add TCP PORT / application in application list - returns port_index
+s8 ICACHE_FLASH_ATTR add_tcp_app (u16 port, void(*fp1)(u8, u8), struct espconn *espconn)
+{
+	u8 port_index = 0;
+	//Search free entry in the application list
+	while (TCP_PORT_TABLE[port_index].port)
+	{ 
+		port_index++;
+	}
+	if (port_index >= MAX_APP_ENTRY)
+	{
+		STACK_DEBUG("TCP too many applications have been launched\n");
+		return -1;
+	}
+	STACK_DEBUG("TCP application is entered in list: Entry %u, port = %u\n",port_index, port);
+	TCP_PORT_TABLE[port_index].port     = port;
+	TCP_PORT_TABLE[port_index].fp       = *fp1;
+	TCP_PORT_TABLE[port_index].espconn  = espconn;
+	TCP_PORT_TABLE[port_index].idle_time       = TCP_IDLE_TIME;
+	TCP_PORT_TABLE[port_index].keepalive_intvl = TCP_KEEPALIVE_INTVL;
+	TCP_PORT_TABLE[port_index].keepalive_cnt   = TCP_KEEPALIVE_CNT;
+	return port_index;
+}
+
+//Sets the idle policy of a TCP application, see TCP_PORT_ITEM
+sint8 ICACHE_FLASH_ATTR stack_setIdlePolicy (u16 port, u16 idle_time, u8 keepalive_intvl, u8 keepalive_cnt)
+{
+	for (u8 i = 0; i < MAX_APP_ENTRY; i++)
+	{
+		if (TCP_PORT_TABLE[i].port == port)
+		{
+			TCP_PORT_TABLE[i].idle_time       = idle_time;
+			TCP_PORT_TABLE[i].keepalive_intvl = keepalive_intvl;
+			TCP_PORT_TABLE[i].keepalive_cnt   = keepalive_cnt;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+//Clears TCP application from the application list
+void ICACHE_FLASH_ATTR kill_tcp_app (u16 port)
+{
+    u8 i;
+
+    for (i = 0; i < MAX_APP_ENTRY; i++)
+    {
+        if ( TCP_PORT_TABLE[i].port == port )
+        {
+            TCP_PORT_TABLE[i].port = 0;
+        }
+    }
+    return;
+}
+
+//----------------------------------------------------------------------------
+//Change the TCP PORT / application in application list
+void ICACHE_FLASH_ATTR change_port_tcp_app (u16 port_old, u16 port_new)
+{
+	u8 port_index = 0;
+	//Search for free entry in the application list
+	while (TCP_PORT_TABLE[port_index].port && TCP_PORT_TABLE[port_index].port != port_old)
+	{ 
+		port_index++;
+	}
+	if (port_index >= MAX_APP_ENTRY)
+	{
+		STACK_DEBUG("( Port Change ) Port not found\n");
+		return;
+	}
+	STACK_DEBUG("TCP application Change Port : Entry %i\n",port_index);
+	TCP_PORT_TABLE[port_index].port = port_new;
+	return;
+}
+
+//----------------------------------------------------------------------------
+//Add UDP port/application to list, returns its entry or -1
+s8 ICACHE_FLASH_ATTR add_udp_app (u16 port, void(*fp1)(u8, u8))
+{
+	u8 port_index = 0;
+	//Search
+	while (port_index < MAX_APP_ENTRY && UDP_PORT_TABLE[port_index].port)
+	{ 
+		port_index++;
+	}
+	if (port_index >= MAX_APP_ENTRY)
+	{
+		STACK_DEBUG("Too many UDP application were launched\n");
+		return -1;
+	}
+	STACK_DEBUG("UDP Application is registered in List: Entry %u\n",port_index);
+	UDP_PORT_TABLE[port_index].port = port;
+	UDP_PORT_TABLE[port_index].fp = *fp1;
+	UDP_PORT_TABLE[port_index].espconn = NULL;
+	return port_index;
+}
+
+//----------------------------------------------------------------------------
+//Clears UDP application from the application list
+void ICACHE_FLASH_ATTR kill_udp_app (u16 port)
+{
+    u8 i;
+
+    for (i = 0; i < MAX_APP_ENTRY; i++)
+    {
+        if ( UDP_PORT_TABLE[i].port == port )
+        {
+            UDP_PORT_TABLE[i].port = 0;
+        }
+    }
+    return;
+}
+
+//----------------------------------------------------------------------------
+//Interrupt from the ENC
+void ICACHE_FLASH_ATTR stack_encInterrupt (void)
+{
+  u32 gpio_status;
+  u8 n;
+  ETS_GPIO_INTR_DISABLE();
+  
+  gpio_status = GPIO_REG_READ(GPIO_STATUS_ADDRESS);
+  GPIO_REG_WRITE(GPIO_STATUS_W1TC_ADDRESS, gpio_status);
+  
+	//STACK_DEBUG("sInt\n");
+  eth.data_present = 1;
+  for (n = 0; n < ENC_DEVICES; n++) {
+    if (gpio_status & BIT(enc_dev[n].int_gpio)) eth_if[n].no_reset = 1;
+  }
+  
+  gpio_status = GPIO_REG_READ(GPIO_STATUS_ADDRESS);  
+  // the interrupt stays off until ethTask has emptied the ENCs
+  system_os_post(ETH_TASK_PRIO, ETH_SIG_RX, 0);
+}
+
+//----------------------------------------------------------------------------
+//Frame budget for one receive run, scaled with the ENC RX ring fill so a
+//filling ring gets drained harder before it overflows
+static u8 ICACHE_FLASH_ATTR eth_rx_budget (void)
+{
+	u16 used = ETH_RX_USED();
+
+	if (used > stack_stats.rx_ring_peak) stack_stats.rx_ring_peak = used;
+	ETH_FLOW_CONTROL(used);
+	return ETH_RX_BUDGET_MIN +
+	       (u32)(ETH_RX_BUDGET_MAX - ETH_RX_BUDGET_MIN) * used / ENC_RX_BUFFER_SIZE;
+}
+
+//----------------------------------------------------------------------------
+//Drains the current ENC up to its frame and time budget. Returns 1 if it
+//ran out with frames still waiting
+static u8 ICACHE_FLASH_ATTR eth_if_receive (void)
+{
+	u8 iface = ETH_IF_INDEX();
+	u8 budget;
+	u32 start;
+
+	budget = eth_rx_budget();
+	start  = system_get_time();
+	while(ETH_INT_PENDING())
+	{	
+		u16 packet_length;
+
+		if(budget-- == 0 || (system_get_time() - start) > ETH_RX_TIME_BUDGET)
+		{
+			stack_stats.rx_yield++;
+			return 1;
+		}
+		stack_stats.rx_frames++;
+		packet_length = ETH_PACKET_RECEIVE(ETH_BUFFER_SIZE,eth_buffer);
+		#ifdef ETH_LOSS_TEST
+			if(packet_length > 0 && ETH_LOSS_DROP())
+			{
+				stack_stats.loss_rx++;
+				continue;
+			}
+		#endif
+		//INT low without a frame - the link changed, a bad frame was
+		//skipped, or nothing we know of
+		if(packet_length == 0)
+		{
+			if(ETH_LINK_CHANGED()) stack_linkCheck();
+			else if(!ETH_RX_USED()) break;
+			eth_if_use(iface);
+			continue;
+		}
+		/*Wenn ein Packet angekommen ist, ist packet_lenght =! 0*/
+		eth_buffer[packet_length+1] = 0;
+		eth_rx_length = packet_length;
+		check_packet();
+		//An app run from check_packet may have sent over another interface
+		eth_if_use(iface);
+	}
+	//Ring drained - lets a paused partner go again
+	ETH_FLOW_CONTROL(ETH_RX_USED());
+	return 0;
+}
+
+//----------------------------------------------------------------------------
+//PORT DONE - ETH get data
+//Every ENC gets its own budget. Returns 1 if one of them ran out with frames
+//still waiting - the interrupt then stays off until the caller comes back
+u8 ICACHE_FLASH_ATTR eth_get_data (void)
+{ 
+	u8 n, more = 0;
+
+	//The self test reads the ring itself, the run is picked up after it
+	if(eth.data_present && !stack_selftest.running)
+	{
+		for(n = 0; n < ENC_DEVICES; n++)
+		{
+			eth_if_use(n);
+			more |= eth_if_receive();
+		}
+		if(more) return 1;
+		eth.data_present = 0;
+		ETS_GPIO_INTR_ENABLE();
+		tcp_poll();
+	}
+	return 0;
+}
+
+//----------------------------------------------------------------------------
+//Wired self test. UDP frames from 0.0.0.0 (no ARP entry made for it) to
+//ourselves go out through the ENC in PHY loopback, are read back into
+//eth_buffer and run through check_packet to a handler on SELFTEST_PORT.
+//Every ENC gets the same run in turn, with its own mac and address - a
+//frame only counts if the handler sees it on the interface it went out of.
+//Each stage is timed on its own. It runs from the timer wheel in batches of
+//SELFTEST_BATCH_TIME, the SDK and WiFi get their turn in between. Receive
+//stays off for the whole test, frames in the ENCs are lost
+STACK_SELFTEST stack_selftest;
+static TW_TIMER selfTestTimer;
+static u16 selftest_seen;
+static u16 selftest_frames;   //to send, per ENC
+static u8  selftest_dev;      //ENC the frames go through now
+static u8 *selftest_frame;
+
+static void ICACHE_FLASH_ATTR selftest_rx (u8 unused, u8 port_index)
+{
+	if (ETH_IF_INDEX() != selftest_dev) return;
+	selftest_seen++;
+	stack_selftest.dev_ok[selftest_dev]++;
+}
+
+//Addresses of the current interface into the test frame, loopback on
+static void ICACHE_FLASH_ATTR selftest_dev_start (void)
+{
+	IP_Header *ip = (IP_Header *)&selftest_frame[IP_OFFSET];
+
+	os_memcpy(&selftest_frame[0], mymac, 6);
+	os_memcpy(&selftest_frame[6], mymac, 6);
+	ip->IP_Destaddr  = *((u32*)&eth_cur->myip[0]);
+	ip->IP_Hdr_Cksum = 0;
+	ip->IP_Hdr_Cksum = htons(checksum(&ip->IP_Vers_Len, IP_VERS_LEN, 0));
+	ETH_LOOPBACK(1);
+}
+
+//One frame out and back
+static void ICACHE_FLASH_ATTR selftest_frame_run (void)
+{
+	STACK_SELFTEST *st = &stack_selftest;
+	u16 frame_len = st->frame_len;
+	u16 len;
+	u32 sent, t, t1;
+
+	st->frames++;
+	eth_if_use(selftest_dev);
+
+	t = system_get_time();
+	ETH_PACKET_SEND(frame_len, selftest_frame);
+	sent = system_get_time();
+	st->spi_tx_us += sent - t;
+
+	//Polls until the frame is back, the last read is the one that got it
+	do
+	{
+		t = system_get_time();
+		len = ETH_PACKET_RECEIVE(MTU_SIZE, eth_buffer);
+	} while (len == 0 && system_get_time() - sent < SELFTEST_WAIT);
+	t1 = system_get_time();
+	st->wire_us   += t - sent;
+	st->spi_rx_us += t1 - t;
+	if (len < frame_len || os_memcmp(eth_buffer, selftest_frame, frame_len) != 0)
+	{
+		st->frames_bad++;
+		return;
+	}
+
+	t = system_get_time();
+	checksum(&eth_buffer[IP_OFFSET], frame_len - ETH_HDR_LEN, 0);
+	t1 = system_get_time();
+	st->checksum_us += t1 - t;
+
+	eth_rx_length = len;
+	check_packet();
+	st->stack_us += system_get_time() - t1;
+}
+
+//One batch, re-arms itself until all frames are through. total_us counts
+//the batches only, not the gaps between them
+static void ICACHE_FLASH_ATTR selfTestCb (void *arg)
+{
+	STACK_SELFTEST *st = &stack_selftest;
+	u32 start = system_get_time();
+
+	while (st->frames < selftest_frames * ENC_DEVICES && system_get_time() - start < SELFTEST_BATCH_TIME)
+	{
+		selftest_frame_run();
+		//This ENC is through, on to the next one
+		if (st->frames == (selftest_dev + 1) * selftest_frames && selftest_dev + 1 < ENC_DEVICES)
+		{
+			ETH_LOOPBACK(0);
+			eth_if_use(++selftest_dev);
+			selftest_dev_start();
+		}
+	}
+	st->total_us += system_get_time() - start;
+	if (st->frames < selftest_frames * ENC_DEVICES)
+	{
+		tw_arm(&selfTestTimer, 1, selfTestCb, NULL);
+		return;
+	}
+
+	st->frames_ok = selftest_seen;
+	eth_if_use(selftest_dev);
+	ETH_LOOPBACK(0);
+	eth_if_use(0);
+	kill_udp_app(SELFTEST_PORT);
+	os_free(selftest_frame);
+	selftest_frame = NULL;
+	st->running = 0;
+	//A receive run that came up meanwhile was held back
+	if (eth.data_present) system_os_post(ETH_TASK_PRIO, ETH_SIG_RX, 0);
+	else                  ETS_GPIO_INTR_ENABLE();
+
+	STACK_DEBUG("Self test: %u of %u frames, %u us\n", st->frames_ok, st->frames, st->total_us);
+}
+
+//----------------------------------------------------------------------------
+//Starts the self test. The first batch runs from the timer wheel too -
+//callers that may be inside check_packet (a CGI over the wire) must not have
+//eth_buffer overwritten
+void ICACHE_FLASH_ATTR stack_selfTestStart (u16 frame_len, u16 frames)
+{
+	STACK_SELFTEST *st = &stack_selftest;
+	IP_Header  *ip;
+	UDP_Header *udp;
+	u8  *frame;
+	u16 i;
+
+	if (st->running) return;
+	if (frame_len < ETH_HDR_LEN + IP_VERS_LEN + UDP_HDR_LEN) frame_len = ETH_HDR_LEN + IP_VERS_LEN + UDP_HDR_LEN;
+	if (frame_len > MTU_SIZE) frame_len = MTU_SIZE;
+	if (frames > SELFTEST_FRAMES_MAX) frames = SELFTEST_FRAMES_MAX;
+
+	frame = (u8 *)os_malloc(frame_len);
+	if (frame == NULL) return;
+
+	os_memset(st, 0, sizeof(STACK_SELFTEST));
+	st->frame_len   = frame_len;
+	st->running     = 1;
+	selftest_frames = frames;
+	selftest_frame  = frame;
+
+	//Ethernet and IP header for us, UDP without checksum, counting payload.
+	//The addresses go in per ENC
+	ip  = (IP_Header  *)&frame[IP_OFFSET];
+	udp = (UDP_Header *)&frame[UDP_OFFSET];
+	frame[12] = 0x08;
+	frame[13] = 0x00;
+	os_memset(ip, 0, IP_VERS_LEN);
+	ip->IP_Vers_Len  = 0x45;
+	ip->IP_Pktlen    = htons(frame_len - ETH_HDR_LEN);
+	ip->IP_ttl       = 64;
+	ip->IP_Proto     = PROT_UDP;
+	udp->udp_SrcPort  = htons(SELFTEST_PORT);
+	udp->udp_DestPort = htons(SELFTEST_PORT);
+	udp->udp_Hdrlen   = htons(frame_len - ETH_HDR_LEN - IP_VERS_LEN);
+	udp->udp_Chksum   = 0;
+	for (i = UDP_OFFSET + UDP_HDR_LEN; i < frame_len; i++) frame[i] = i;
+
+	//The receive task and the housekeeping keep out until the test is done
+	ETS_GPIO_INTR_DISABLE();
+	kill_udp_app(SELFTEST_PORT);
+	add_udp_app(SELFTEST_PORT, selftest_rx);
+	selftest_seen = 0;
+	selftest_dev  = 0;
+	eth_if_use(0);
+	selftest_dev_start();
+	tw_arm(&selfTestTimer, 1, selfTestCb, NULL);
+}
+
+//----------------------------------------------------------------------------
+//First look at an IPv4 frame, before anything else touches it: version, header
+//length, IP_Pktlen against what was received and the header checksum. IP
+//options are cut out, so everything after this sees a 20 byte header.
+//Returns 0 if the frame is to be dropped
+static u8 ICACHE_FLASH_ATTR ip_rx_validate (void)
+{
+  IP_Header *ip = (IP_Header *)&eth_buffer[IP_OFFSET];
+  u16 hdr_len, pkt_len;
+
+  if (eth_rx_length < ETH_HDR_LEN + IP_VERS_LEN)
+  {
+    stack_stats.rx_drop_short++;
+    return 0;
+  }
+  hdr_len = (ip->IP_Vers_Len & 0x0F) << 2;
+  pkt_len = htons(ip->IP_Pktlen);
+  if ((ip->IP_Vers_Len & 0xF0) != 0x40 || hdr_len < IP_VERS_LEN)
+  {
+    stack_stats.rx_drop_ip_hdr++;
+    return 0;
+  }
+  //Frames may carry padding, but never less than the IP length
+  if (pkt_len < hdr_len || ETH_HDR_LEN + pkt_len > eth_rx_length)
+  {
+    stack_stats.rx_drop_ip_len++;
+    return 0;
+  }
+  if (checksum(&ip->IP_Vers_Len, hdr_len, 0) != 0)
+  {
+    stack_stats.rx_drop_ip_cksum++;
+    return 0;
+  }
+
+  if (hdr_len > IP_VERS_LEN)
+  {
+    //Nothing here acts on options - drop them and close the gap
+    stack_stats.rx_ip_options++;
+    os_memmove(&eth_buffer[IP_OFFSET + IP_VERS_LEN], &eth_buffer[IP_OFFSET + hdr_len],
+               pkt_len - hdr_len);
+    ip->IP_Vers_Len  = 0x45;
+    ip->IP_Pktlen    = htons(pkt_len - (hdr_len - IP_VERS_LEN));
+    ip->IP_Hdr_Cksum = 0;
+    ip->IP_Hdr_Cksum = htons(checksum(&ip->IP_Vers_Len, IP_VERS_LEN, 0));
+    pkt_len -= hdr_len - IP_VERS_LEN;
+  }
+  eth_rx_length = ETH_HDR_LEN + pkt_len;
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+//Transport header of a complete (unfragmented or reassembled) datagram,
+//makes sure the TCP data offset and UDP length fit inside IP_Pktlen
+static u8 ICACHE_FLASH_ATTR ip_rx_validate_proto (void)
+{
+  IP_Header  *ip  = (IP_Header  *)&eth_buffer[IP_OFFSET];
+  TCP_Header *tcp = (TCP_Header *)&eth_buffer[TCP_OFFSET];
+  UDP_Header *udp = (UDP_Header *)&eth_buffer[UDP_OFFSET];
+  u16 data_len = htons(ip->IP_Pktlen) - IP_VERS_LEN;
+  u16 len;
+
+  switch (ip->IP_Proto)
+  {
+    case PROT_TCP:
+      len = (tcp->TCP_Hdrlen & 0xF0) >> 2;
+      if (data_len < TCP_HDR_LEN || len < TCP_HDR_LEN || len > data_len)
+      {
+        stack_stats.rx_drop_tcp_hdr++;
+        return 0;
+      }
+      break;
+    case PROT_UDP:
+      len = htons(udp->udp_Hdrlen);
+      if (data_len < UDP_HDR_LEN || len < UDP_HDR_LEN || len > data_len)
+      {
+        stack_stats.rx_drop_udp_hdr++;
+        return 0;
+      }
+      break;
+    case PROT_ICMP:
+      if (data_len < 8)
+      {
+        stack_stats.rx_drop_icmp++;
+        return 0;
+      }
+      break;
+  }
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+//PORT DONE - Check Packet and call Stack for TCP or UDP
+void ICACHE_FLASH_ATTR check_packet (void)
+{
+  Ethernet_Header *ethernet;    
+  IP_Header       *ip;         
+  ICMP_Header     *icmp;       
+
+  ethernet = (Ethernet_Header *)&eth_buffer[ETHER_OFFSET];
+  ip       = (IP_Header       *)&eth_buffer[IP_OFFSET];
+  icmp     = (ICMP_Header     *)&eth_buffer[ICMP_OFFSET];
+  
+  //ARP or not?
+  if(ethernet->EnetPacketType == HTONS(0x0806) ) {
+    arp_probe_check(); // address conflict?
+    arp_reply(); // check arp packet request/reply
+  } else {
+    // if IP
+    if( ethernet->EnetPacketType == HTONS(0x0800) ) {         
+      //STACK_DEBUG("if IP, %u\n",ip->IP_Destaddr);
+      // malformed? drop it before any table is searched
+      if( !ip_rx_validate() ) return;
+      // fragment (MF set or offset != 0)? unfragmented packets go straight on
+      if( ip->IP_Frag_Offset & HTONS(0x3FFF) ) {
+        #ifdef USE_IP_REASM
+          if( ip->IP_Destaddr != *((u32*)&eth_cur->myip[0]) && ip->IP_Destaddr != (u32)0xffffffff &&
+              ip->IP_Destaddr != *((u32*)&eth_cur->broadcast_ip[0]) ) return;
+          if( !ip_reasm_input(eth_rx_length) ) return;
+          eth_rx_length = ETH_HDR_LEN + htons(ip->IP_Pktlen);
+        #else
+          return;
+        #endif
+      }
+      if( !ip_rx_validate_proto() ) return;
+      // if my IP address 
+      if( ip->IP_Destaddr == *((u32*)&eth_cur->myip[0]) ) {
+        //STACK_DEBUG("if my IP\n");
+        arp_entry_add(); 
+        if(ip->IP_Proto == PROT_ICMP) {
+          switch ( icmp->ICMP_Type ) {
+            case (8): //Ping reqest
+              STACK_DEBUG("ping request\n");
+              if (!token_take(&icmp_bucket, ICMP_RATE, ICMP_BURST)) {
+                stack_stats.icmp_limited++;
+                break;
+              }
+              icmp_send(ip->IP_Srcaddr,0,0,icmp->ICMP_SeqNum,icmp->ICMP_Id); 
+              break;
+
+            case (0): //Ping reply
+              STACK_DEBUG("ping reply\n");
+              if ((*((u32*)&ping.ip1[0])) == ip->IP_Srcaddr) {
+                ping.result |= 0x01;
+              }
+              STACK_DEBUG("%u",    (ip->IP_Srcaddr&0x000000FF)     );
+              STACK_DEBUG(".%u",  ((ip->IP_Srcaddr&0x0000FF00)>>8 ));
+              STACK_DEBUG(".%u",  ((ip->IP_Srcaddr&0x00FF0000)>>16));
+              STACK_DEBUG(".%u :",((ip->IP_Srcaddr&0xFF000000)>>24));
+              break;
+          }
+          return;
+        } else {
+          if( ip->IP_Proto == PROT_TCP ) tcp_socket_process();
+          if( ip->IP_Proto == PROT_UDP ) udp_socket_process();
+        }
+      } else {        
+        // if broadcast
+        if (ip->IP_Destaddr == (u32)0xffffffff || ip->IP_Destaddr == *((u32*)&eth_cur->broadcast_ip[0]) ) {
+          //STACK_DEBUG("Broadcast address\n");
+          if( ip->IP_Proto == PROT_UDP ) { 
+            //STACK_DEBUG("Calling UDP app\n");
+            udp_socket_process();
+          }
+        } else if (IP_MULTICAST(ip->IP_Destaddr)) {
+          // multicast - queries for IGMP, the groups joined for UDP
+          if( ip->IP_Proto == PROT_IGMP ) igmp_input();
+          if( ip->IP_Proto == PROT_UDP && udp_mcast_index(ip->IP_Destaddr) < UDP_MCAST_GROUPS ) {
+            stack_stats.udp_rx_mcast++;
+            udp_socket_process();
+          }
+        }
+      }
+    }
+  }
+  return;
+}
+
+//----------------------------------------------------------------------------
+//PORT DONE - creates an ARP - entry if not yet available, else refreshes it
+void ICACHE_FLASH_ATTR arp_entry_add (void)
+{
+    Ethernet_Header *ethernet;
+    ARP_Header      *arp;
+    IP_Header       *ip;
+      
+    ethernet = (Ethernet_Header *)&eth_buffer[ETHER_OFFSET];
+    arp      = (ARP_Header      *)&eth_buffer[ARP_OFFSET];
+    ip       = (IP_Header       *)&eth_buffer[IP_OFFSET];
+        
+    //STACK_DEBUG("ARP entry add\n");
+    
+    if( ethernet->EnetPacketType == HTONS(0x0806) ) //If ARP
+    {
+        arp_entry_update(arp->ARP_SIPAddr, ethernet->EnetPacketSrc);
+        return;
+    }
+    if( ethernet->EnetPacketType == HTONS(0x0800) ) //If IP
+    {
+        arp_entry_update(ip->IP_Srcaddr, ethernet->EnetPacketSrc);
+        return;
+    }
+    STACK_DEBUG("No ARP or IP packet!\n");
+    return;
+}
+
+//----------------------------------------------------------------------------
+//PORT DONE - This routine search by IP ARP entry
+//Entries that are used for transmit get a unicast refresh request shortly
+//before they expire, so busy peers never fall back to a broadcast
+char ICACHE_FLASH_ATTR arp_entry_search (u32 dest_ip)
+{
+	u8 b = arp_entry_find(dest_ip);
+
+	if (b == ARP_NO_ENTRY)
+	{
+		return (MAX_ARP_ENTRY);
+	}
+	arp_lru_touch(b);
+
+	if (!arp_entry[b].arp_t_refresh &&
+	    (s32)(my1secTime + ARP_REFRESH_TIME - arp_entry[b].arp_t_expire) >= 0)
+	{
+		arp_entry[b].arp_t_refresh = 1;
+		arp_send_request(dest_ip, arp_entry[b].arp_t_mac);
+	}
+	return(b);
+}
+
+//----------------------------------------------------------------------------
+//Sends an ARP request from its own buffer, so it can be called while a frame
+//is being built in eth_buffer. dest_mac == NULL broadcasts the request.
+//sender_ip 0 makes it a probe, sender_ip == dest_ip a gratuitous ARP.
+static void ICACHE_FLASH_ATTR arp_send_frame (u32 sender_ip, u32 dest_ip, volatile u8 *dest_mac)
+{
+	u8 buffer[ARP_REQUEST_LEN];
+	Ethernet_Header *ethernet;
+	ARP_Header *arp;
+
+	ethernet = (Ethernet_Header *)&buffer[ETHER_OFFSET];
+	arp      = (ARP_Header      *)&buffer[ARP_OFFSET];
+
+	for(u8 a = 0; a < 6; a++)
+	{
+		ethernet->EnetPacketDest[a] = dest_mac ? dest_mac[a] : 0xFF;
+		ethernet->EnetPacketSrc[a]  = mymac[a];
+		arp->ARP_SHAddr[a]          = mymac[a];
+		arp->ARP_THAddr[a]          = 0;
+	}
+	ethernet->EnetPacketType = HTONS(0x0806);
+
+	arp->ARP_HWType  = HTONS(0x0001);
+	arp->ARP_PRType  = HTONS(0x0800);
+	arp->ARP_HWLen   = 0x06;
+	arp->ARP_PRLen   = 0x04;
+	arp->ARP_Op      = HTONS(0x0001);
+	arp->ARP_SIPAddr = sender_ip;
+	arp->ARP_TIPAddr = dest_ip;
+
+	STACK_DEBUG("Sending ARP request\n");
+	TX_PACKET_SEND(ARP_REQUEST_LEN, buffer);
+	eth_cur->no_reset = 1;
+}
+
+void ICACHE_FLASH_ATTR arp_send_request (u32 dest_ip, volatile u8 *dest_mac)
+{
+	arp_send_frame(*((u32 *)&eth_cur->myip[0]), dest_ip, dest_mac);
+}
+
+//----------------------------------------------------------------------------
+//RFC 5227 address probe and announcement. Probes go out with sender IP 0,
+//any ARP claiming the address meanwhile is a conflict. Once probing is
+//clean the address is announced with gratuitous ARPs, and defended after.
+//Each interface runs its own, on eth_cur->probe
+static void ICACHE_FLASH_ATTR arp_probe_timer_cb (void *arg)
+{
+	eth_if_use((ethIf *)arg - eth_if);
+	switch (eth_cur->probe.state)
+	{
+		case ARP_PROBE_PROBING:
+			if (eth_cur->probe.count < ARP_PROBE_NUM)
+			{
+				eth_cur->probe.count++;
+				STACK_DEBUG("ARP probe %u\n", eth_cur->probe.count);
+				arp_send_frame(0, eth_cur->probe.ip, NULL);
+				tw_arm(&eth_cur->probe.timer,
+				    (eth_cur->probe.count < ARP_PROBE_NUM) ? ARP_PROBE_INTERVAL : ARP_ANNOUNCE_WAIT,
+				    arp_probe_timer_cb, eth_cur);
+				return;
+			}
+			eth_cur->probe.state = ARP_PROBE_ANNOUNCING;
+			eth_cur->probe.count = 0;
+			//no break - first announcement goes out right away
+		case ARP_PROBE_ANNOUNCING:
+			eth_cur->probe.count++;
+			STACK_DEBUG("Gratuitous ARP %u\n", eth_cur->probe.count);
+			arp_send_frame(eth_cur->probe.ip, eth_cur->probe.ip, NULL);
+			if (eth_cur->probe.count < ARP_ANNOUNCE_NUM)
+			{
+				tw_arm(&eth_cur->probe.timer, ARP_ANNOUNCE_INTERVAL, arp_probe_timer_cb, eth_cur);
+			}
+			else
+			{
+				eth_cur->probe.state = ARP_PROBE_DONE;
+			}
+			break;
+	}
+}
+
+//Start probing + announcing ip, a probe already running for ip carries on
+void ICACHE_FLASH_ATTR arp_probe_start (u32 ip)
+{
+	if (ip == 0) return;
+	if (ip == eth_cur->probe.ip &&
+	    (eth_cur->probe.state == ARP_PROBE_PROBING || eth_cur->probe.state == ARP_PROBE_ANNOUNCING))
+	{
+		return;
+	}
+	eth_cur->probe.ip    = ip;
+	eth_cur->probe.state = ARP_PROBE_PROBING;
+	eth_cur->probe.count = 0;
+	tw_arm(&eth_cur->probe.timer, ARP_PROBE_INTERVAL, arp_probe_timer_cb, eth_cur);
+}
+
+u8 ICACHE_FLASH_ATTR arp_probe_state (void)
+{
+	return eth_cur->probe.state;
+}
+
+u32 ICACHE_FLASH_ATTR arp_probe_ip (void)
+{
+	return eth_cur->probe.ip;
+}
+
+//Called for every received ARP frame before it is answered
+static void ICACHE_FLASH_ATTR arp_probe_check (void)
+{
+	ARP_Header *arp = (ARP_Header *)&eth_buffer[ARP_OFFSET];
+
+	if (eth_cur->probe.state == ARP_PROBE_IDLE || eth_cur->probe.state == ARP_PROBE_CONFLICT) return;
+	if (os_memcmp(arp->ARP_SHAddr, mymac, 6) == 0) return;
+
+	if (eth_cur->probe.state == ARP_PROBE_PROBING)
+	{
+		//Someone owns it, or is probing for it at the same time
+		if (arp->ARP_SIPAddr == eth_cur->probe.ip ||
+		    (arp->ARP_Op == HTONS(0x0001) && arp->ARP_SIPAddr == 0 && arp->ARP_TIPAddr == eth_cur->probe.ip))
+		{
+			STACK_DEBUG("ARP probe conflict!\n");
+			tw_cancel(&eth_cur->probe.timer);
+			eth_cur->probe.state = ARP_PROBE_CONFLICT;
+		}
+		return;
+	}
+
+	if (arp->ARP_SIPAddr != eth_cur->probe.ip) return;
+
+	//Address in use and claimed by somebody else - defend it once, give up on a repeat
+	if ((u32)(my1secTime - eth_cur->probe.last_defend) > ARP_DEFEND_INTERVAL || eth_cur->probe.last_defend == 0)
+	{
+		STACK_DEBUG("ARP conflict, defending address\n");
+		eth_cur->probe.last_defend = my1secTime ? my1secTime : 1;
+		arp_send_frame(eth_cur->probe.ip, eth_cur->probe.ip, NULL);
+		return;
+	}
+	STACK_DEBUG("ARP conflict, giving up address\n");
+	tw_cancel(&eth_cur->probe.timer);
+	eth_cur->probe.state = ARP_PROBE_CONFLICT;
+	#ifdef USE_DHCP
+		if (sysCfg.setipaddr.theint == 0 && ETH_IF_INDEX() == 0)
+		{
+			dhcp_conflict();
+		}
+	#endif
+}
+
+//----------------------------------------------------------------------------
+//PORT DONE - This routine creates a new ethernet header 
+void ICACHE_FLASH_ATTR new_eth_header (u8 *buffer,u32 dest_ip)
+{
+  u8 b;
+  u8 a;
+  
+	Ethernet_Header *ethernet;
+	ethernet = (Ethernet_Header *)&buffer[ETHER_OFFSET];
+  	
+	static u32 last_req_ip   = 0;
+	static u32 last_req_time = 0;
+	u32 next_hop = dest_ip;
+
+	//Multicast - the MAC comes from the group (RFC 1112), no ARP
+	if (IP_MULTICAST(dest_ip))
+	{
+		ethernet->EnetPacketDest[0] = 0x01;
+		ethernet->EnetPacketDest[1] = 0x00;
+		ethernet->EnetPacketDest[2] = 0x5E;
+		ethernet->EnetPacketDest[3] = ((u8 *)&dest_ip)[1] & 0x7F;
+		ethernet->EnetPacketDest[4] = ((u8 *)&dest_ip)[2];
+		ethernet->EnetPacketDest[5] = ((u8 *)&dest_ip)[3];
+		for(a = 0; a < 6; a++) ethernet->EnetPacketSrc[a] = mymac[a];
+		return;
+	}
+
+	b = arp_entry_search (dest_ip);
+	if (b == MAX_ARP_ENTRY && dest_ip != (u32)0xffffffff && dest_ip != *((u32*)&eth_cur->broadcast_ip[0]))
+	{
+		//Not on our subnet - the gateway's MAC will do
+		if ( (dest_ip & (*((u32 *)&eth_cur->netmask[0]))) != ((*((u32 *)&eth_cur->myip[0])) & (*((u32 *)&eth_cur->netmask[0]))) )
+		{
+			next_hop = *((u32 *)&eth_cur->router_ip[0]);
+			b = arp_entry_search (next_hop);
+		}
+		//Still unknown - ask for it once a second, the frame itself goes out as broadcast
+		if (b == MAX_ARP_ENTRY && *((u32*)&eth_cur->myip[0]) != 0 &&
+		    (next_hop != last_req_ip || my1secTime != last_req_time))
+		{
+			last_req_ip   = next_hop;
+			last_req_time = my1secTime;
+			arp_send_request(next_hop, NULL);
+		}
+	}
+	if (b != MAX_ARP_ENTRY) //found entry if not equal
+	{
+		for(u8 a = 0; a < 6; a++)
+		{
+			ethernet->EnetPacketDest[a] = arp_entry[b].arp_t_mac[a];
+			ethernet->EnetPacketSrc[a] = mymac[a];
+		}
+		return;
+	}
+
+	STACK_DEBUG("ARP entry is not found*\n");
+	for(a = 0; a < 6; a++)
+	{	
+
+		ethernet->EnetPacketDest[a] = 0xFF;
+		//My MAC address is written in the source address
+		ethernet->EnetPacketSrc[a] = mymac[a];
+	}
+	return;
+
+}
+
+//----------------------------------------------------------------------------
+//PORT DONE - This routine responds to an ARP packet
+void ICACHE_FLASH_ATTR arp_reply (void)
+{
+    u8 b;
+    u8 a;
+    u16 len;
+    char first, second;
+    
+    Ethernet_Header *ethernet;
+    ARP_Header      *arp;
+    
+    arp      = (ARP_Header      *)&eth_buffer[ARP_OFFSET];
+    ethernet = (Ethernet_Header *)&eth_buffer[ETHER_OFFSET];
+    
+    //STACK_DEBUG("arp reply\n"); 
+
+    if( arp->ARP_HWType  == HTONS(0x0001)  &&             // Hardware Typ:   Ethernet
+        arp->ARP_PRType  == HTONS(0x0800)  &&             // Protocol Typ:  IP
+        arp->ARP_HWLen   == 0x06           &&             
+        arp->ARP_PRLen   == 0x04           &&             
+        arp->ARP_TIPAddr == *((u32*)&eth_cur->myip[0])) // For us?
+    {
+        if (arp->ARP_Op == HTONS(0x0001) )                  // Request?
+        {
+            arp_entry_add(); 
+            new_eth_header (eth_buffer, arp->ARP_SIPAddr); // Creates new ethernet header
+            ethernet->EnetPacketType = HTONS(0x0806);      // 0x0800=IP Datagramm;0x0806 = ARP
+      
+            b = arp_entry_search (arp->ARP_SIPAddr);
+            if (b < MAX_ARP_ENTRY)                        
+            {
+              for(a = 0; a < 6; a++)
+              {
+                  arp->ARP_THAddr[a] = arp_entry[b].arp_t_mac[a];
+                  arp->ARP_SHAddr[a] = mymac[a];
+              }              
+            }
+            else
+            {
+                STACK_DEBUG("ARP Entry not found\n");        
+            }
+            
+	  
+            arp->ARP_Op      = HTONS(0x0002);                   // ARP op = ECHO  
+            arp->ARP_TIPAddr = arp->ARP_SIPAddr;                // ARP Target IP Adresse 
+            arp->ARP_SIPAddr = *((u32 *)&eth_cur->myip[0]);   // Meine IP Adresse = ARP Source
+                        
+            //STACK_DEBUG("Sending packet...\n\n");        
+            /*for (len = 0; len <ARP_REPLY_LEN; len++) {          
+              hextools_hex2ascii(eth_buffer[len], &first, &second);
+              uart0_write_char(first);
+              uart0_write_char(second);
+            }
+            //STACK_DEBUG("\n\nDone send packet...\n");
+            */
+            STACK_DEBUG("Sending ARP reply\n"); 
+            TX_PACKET_SEND(ARP_REPLY_LEN,eth_buffer);          // ARP Reply senden...
+            eth_cur->no_reset = 1;
+            return;
+        }
+
+        if ( arp->ARP_Op == HTONS(0x0002) )                    // REPLY from another client
+        {
+            arp_entry_add();
+            STACK_DEBUG("ARP REPLY RECEIVED!\n");
+        }
+    }
+    return;
+}
+
+//----------------------------------------------------------------------------
+//FIXME: Use this to request the gateway MAC
+/*
+  char ICACHE_FLASH_ATTR arp_request (u32 dest_ip)
+  {
+      u8 buffer[ARP_REQUEST_LEN];
+      u8 index = 0;
+      u8 index_tmp;
+      u8 count;
+      u32 a;
+      u32 dest_ip_store;
+
+      Ethernet_Header *ethernet;
+      ARP_Header *arp;
+
+      STACK_DEBUG("arp request\n");  
+      ethernet = (Ethernet_Header *)&buffer[ETHER_OFFSET];
+      arp      = (ARP_Header      *)&buffer[ARP_OFFSET];
+
+      dest_ip_store = dest_ip;
+
+      if ( (dest_ip & (*((u32 *)&eth_cur->netmask[0])))==
+         ((*((u32 *)&eth_cur->myip[0]))&(*((u32 *)&eth_cur->netmask[0]))) )
+      {
+          STACK_DEBUG("MY NETWORK!\n");
+      }
+      else
+      {
+          STACK_DEBUG("ROUTING!\n");
+          dest_ip = (*((u32 *)&eth_cur->router_ip[0]));
+      }
+
+      ethernet->EnetPacketType = HTONS(0x0806);          // Nutzlast 0x0800=IP Datagramm;0x0806 = ARP
+    
+      new_eth_header (buffer,dest_ip);
+    
+      arp->ARP_SIPAddr = *((u32 *)&eth_cur->myip[0]);   // MyIP = ARP Source IP
+      arp->ARP_TIPAddr = dest_ip;                         // Dest IP 
+    
+      for(count = 0; count < 6; count++)
+      {
+          arp->ARP_SHAddr[count] = mymac[count];
+          arp->ARP_THAddr[count] = 0;
+      }
+    
+      arp->ARP_HWType = HTONS(0x0001);
+      arp->ARP_PRType = HTONS(0x0800);
+      arp->ARP_HWLen  = 0x06;
+      arp->ARP_PRLen  = 0x04;
+      arp->ARP_Op     = HTONS(0x0001);
+
+      TX_PACKET_SEND(ARP_REQUEST_LEN, buffer);        //send....
+    eth_cur->no_reset = 1;
+    
+      for(count = 0; count<20; count++)
+      {
+          index_tmp = arp_entry_search(dest_ip_store);
+          index = arp_entry_search(dest_ip);
+          if (index < MAX_ARP_ENTRY || index_tmp < MAX_ARP_ENTRY)
+          {
+              STACK_DEBUG("ARP EINTRAG GEFUNDEN!\n");
+              if (index_tmp < MAX_ARP_ENTRY) return(1);//OK
+              arp_entry[index].arp_t_ip = dest_ip_store;
+              return(1);//OK
+          }
+          os_delay_us(1000);
+          eth_get_data();
+          STACK_DEBUG("**KEINEN ARP EINTRAG GEFUNDEN**\n");
+      }
+      return(0);//keine Antwort
+  }
+*/
+
+
+//----------------------------------------------------------------------------
+//PORT DONE - This routine creates a new ICMP Packet
+void ICACHE_FLASH_ATTR icmp_send (u32 dest_ip, u8 icmp_type, 
+                u8 icmp_code, u16 icmp_sn, 
+                u16 icmp_id)
+{
+  u16 result16;  //Checksum
+  IP_Header   *ip;
+  ICMP_Header *icmp;
+  
+  
+  ip   = (IP_Header   *)&eth_buffer[IP_OFFSET];
+  icmp = (ICMP_Header *)&eth_buffer[ICMP_OFFSET];
+
+  STACK_DEBUG("icmp_send()\n");  
+  
+  //This is an Echo Reply Packet
+  icmp->ICMP_Type   = icmp_type;
+  icmp->ICMP_Code   = icmp_code;
+  icmp->ICMP_Id     = icmp_id;
+  icmp->ICMP_SeqNum = icmp_sn;
+  icmp->ICMP_Cksum  = 0;
+  ip->IP_Pktlen     = HTONS(0x0054);   // 0x54 = 84 
+  ip->IP_Proto      = PROT_ICMP;
+  make_ip_header (eth_buffer,dest_ip);
+
+  //Berechnung der ICMP Header lnge
+  result16 = htons(ip->IP_Pktlen);
+  result16 = result16 - ((ip->IP_Vers_Len & 0x0F) << 2);
+
+  //pointer wird auf das erste Paket im ICMP Header gesetzt
+  //jetzt wird die Checksumme berechnet
+  result16 = checksum (&icmp->ICMP_Type, result16, 0);
+ 
+  //schreibt Checksumme ins Packet
+  icmp->ICMP_Cksum = htons(result16);
+   
+  //Sendet das erzeugte ICMP Packet 
+  TX_PACKET_SEND(ICMP_REPLY_LEN,eth_buffer);
+  eth_cur->no_reset = 1;
+}
+
+//----------------------------------------------------------------------------
+//Takes a token from the bucket, refilling it for the seconds gone by.
+//Returns 0 if the bucket is empty and the response should be dropped
+static u8 ICACHE_FLASH_ATTR token_take (TOKEN_BUCKET *bucket, u8 rate, u8 burst)
+{
+  u32 elapsed = my1secTime - bucket->last;
+
+  if (elapsed) {
+    if (elapsed >= burst || bucket->tokens + elapsed * rate >= burst) {
+      bucket->tokens = burst;
+    } else {
+      bucket->tokens += elapsed * rate;
+    }
+    bucket->last = my1secTime;
+  }
+  if (bucket->tokens == 0) return 0;
+  bucket->tokens--;
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+//Answers the UDP datagram in eth_buffer with an ICMP port unreachable,
+//quoting its IP header + first 8 bytes as the RFC wants
+void ICACHE_FLASH_ATTR icmp_port_unreachable (void)
+{
+  u16 result16;
+  u16 quote_len;
+  u32 dest_ip;
+  IP_Header   *ip;
+  ICMP_Header *icmp;
+
+  ip   = (IP_Header   *)&eth_buffer[IP_OFFSET];
+  icmp = (ICMP_Header *)&eth_buffer[ICMP_OFFSET];
+
+  //Never for broadcasts or fragments other than the first
+  if (ip->IP_Destaddr != *((u32*)&eth_cur->myip[0]) || ip->IP_Srcaddr == 0 ||
+      (ip->IP_Frag_Offset & HTONS(0x1FFF))) return;
+  if (!token_take(&icmp_bucket, ICMP_RATE, ICMP_BURST)) {
+    stack_stats.icmp_limited++;
+    return;
+  }
+  STACK_DEBUG("ICMP port unreachable\n");
+
+  dest_ip   = ip->IP_Srcaddr;
+  quote_len = ((ip->IP_Vers_Len & 0x0F) << 2) + 8;
+  os_memmove(&eth_buffer[ICMP_DATA], &eth_buffer[IP_OFFSET], quote_len);
+
+  icmp->ICMP_Type   = 3;  //destination unreachable
+  icmp->ICMP_Code   = 3;  //port unreachable
+  icmp->ICMP_Id     = 0;
+  icmp->ICMP_SeqNum = 0;
+  icmp->ICMP_Cksum  = 0;
+  ip->IP_Pktlen     = htons(IP_VERS_LEN + 8 + quote_len);
+  ip->IP_Proto      = PROT_ICMP;
+  make_ip_header (eth_buffer,dest_ip);
+
+  result16 = checksum (&icmp->ICMP_Type, 8 + quote_len, 0);
+  icmp->ICMP_Cksum = htons(result16);
+
+  TX_PACKET_SEND(ETH_HDR_LEN + IP_VERS_LEN + 8 + quote_len,eth_buffer);
+  eth_cur->no_reset = 1;
+  stack_stats.unreach_sent++;
+}
+
+//----------------------------------------------------------------------------
+//Answers the TCP segment in eth_buffer with a RST (RFC 793, closed port)
+void ICACHE_FLASH_ATTR tcp_send_reset (void)
+{
+  u16 result16;
+  u32 result32;
+  u32 dest_ip;
+  u16 port;
+  TCP_Header *tcp;
+  IP_Header  *ip;
+
+  tcp = (TCP_Header *)&eth_buffer[TCP_OFFSET];
+  ip  = (IP_Header  *)&eth_buffer[IP_OFFSET];
+
+  //Never answer a RST, nor anything not sent to us
+  if ((tcp->TCP_HdrFlags & RST_FLAG) || ip->IP_Destaddr != *((u32*)&eth_cur->myip[0])) return;
+  if (!token_take(&rst_bucket, RST_RATE, RST_BURST)) {
+    stack_stats.rst_limited++;
+    return;
+  }
+  STACK_DEBUG("Sending RST to closed port %u\n", htons(tcp->TCP_DestPort));
+
+  if (tcp->TCP_HdrFlags & ACK_FLAG) {
+    //<SEQ=SEG.ACK><CTL=RST>
+    tcp->TCP_Seqnum   = tcp->TCP_Acknum;
+    tcp->TCP_Acknum   = 0;
+    tcp->TCP_HdrFlags = RST_FLAG;
+  } else {
+    //<SEQ=0><ACK=SEG.SEQ+SEG.LEN><CTL=RST,ACK>
+    result32 = htons32(tcp->TCP_Seqnum) + (TCP_DATA_END_VAR - TCP_DATA_START_VAR);
+    if (tcp->TCP_HdrFlags & SYN_FLAG) result32++;
+    if (tcp->TCP_HdrFlags & FIN_FLAG) result32++;
+    tcp->TCP_Acknum   = htons32(result32);
+    tcp->TCP_Seqnum   = 0;
+    tcp->TCP_HdrFlags = RST_FLAG | ACK_FLAG;
+  }
+  port               = tcp->TCP_SrcPort;
+  tcp->TCP_SrcPort   = tcp->TCP_DestPort;
+  tcp->TCP_DestPort  = port;
+  tcp->TCP_Hdrlen    = 0x50;
+  tcp->TCP_Window    = 0;
+  tcp->TCP_UrgentPtr = 0;
+
+  dest_ip       = ip->IP_Srcaddr;
+  ip->IP_Pktlen = HTONS(IP_VERS_LEN + TCP_HDR_LEN);
+  ip->IP_Proto  = PROT_TCP;
+  make_ip_header (eth_buffer,dest_ip);
+
+  tcp->TCP_Chksum = 0;
+  result16 = TCP_HDR_LEN + 8;
+  result32 = result16 - 2;
+  result16 = checksum ((&ip->IP_Vers_Len+12), result16, result32);
+  tcp->TCP_Chksum = htons(result16);
+
+  TX_PACKET_SEND(ETH_HDR_LEN + IP_VERS_LEN + TCP_HDR_LEN,eth_buffer);
+  eth_cur->no_reset = 1;
+  stack_stats.rst_sent++;
+}
+
+//----------------------------------------------------------------------------
+//Adds len (even) bytes to a checksum without folding it, for packets whose
+//checksum runs over more than one buffer - checksum() finishes it off
+static u32 ICACHE_FLASH_ATTR checksum_add (const u8 *pointer, u16 len, u32 result32)
+{
+	for (; len > 1; len -= 2, pointer += 2)
+	{
+		result32 += (pointer[0] << 8) + pointer[1];
+	}
+	return (result32);
+}
+
+//----------------------------------------------------------------------------
+//checksum() for data in flash, read from the mapping a word at a time
+static u16 ICACHE_FLASH_ATTR checksum_flash (u32 addr, u16 len, u32 result32)
+{
+	u32 word  = FLASH_WORD(addr);
+	u8  shift = (addr & 3) << 3;
+	u16 i;
+
+	for (i = 0; i < len; i++)
+	{
+		result32 += (i & 1) ? (u8)(word >> shift) : ((u8)(word >> shift) << 8);
+		shift += 8;
+		if (shift == 32 && i + 1 < len)
+		{
+			word  = FLASH_WORD(addr + i + 1);
+			shift = 0;
+		}
+	}
+
+	result32 = ((result32 & 0x0000FFFF)+ ((result32 & 0xFFFF0000) >> 16));
+	result32 = ((result32 & 0x0000FFFF)+ ((result32 & 0xFFFF0000) >> 16));
+	return (~result32 & 0xFFFF);
+}
+
+//----------------------------------------------------------------------------
+//PORT DONE - This routine create a checksum
+u16 ICACHE_FLASH_ATTR checksum (u8 *pointer,u16 result16,u32 result32)
+{
+	u16 result16_1 = 0x0000;
+	u8 DataH;
+	u8 DataL;
+  
+  //Jetzt werden alle Packete in einer While Schleife addiert
+	while(result16 > 1)
+	{
+		//schreibt Inhalt Pointer nach DATAH danach inc Pointer
+		DataH=*pointer++;
+
+		//schreibt Inhalt Pointer nach DATAL danach inc Pointer
+		DataL=*pointer++;
+
+		//erzeugt Int aus Data L und Data H
+		result16_1 = ((DataH << 8)+DataL);
+		//Addiert packet mit vorherigen
+		result32 = result32 + result16_1;
+		//decrimiert Lnge von TCP Headerschleife um 2
+		result16 -=2;
+	}
+
+	//Ist der Wert result16 ungerade ist DataL = 0
+	if(result16 > 0)
+	{
+		//schreibt Inhalt Pointer nach DATAH danach inc Pointer
+		DataH=*pointer;
+		//erzeugt Int aus Data L ist 0 (ist nicht in der Berechnung) und Data H
+		result16_1 = (DataH << 8);
+		//Addiert packet mit vorherigen
+		result32 = result32 + result16_1;
+	}
+	
+	//Komplementbildung (addiert Long INT_H Byte mit Long INT L Byte)
+	result32 = ((result32 & 0x0000FFFF)+ ((result32 & 0xFFFF0000) >> 16));
+	result32 = ((result32 & 0x0000FFFF)+ ((result32 & 0xFFFF0000) >> 16));	
+	result16 =~(result32 & 0x0000FFFF);
+	
+	return (result16);
+}
+
+//----------------------------------------------------------------------------
+//PORT DONE - This routine creates an IP packet
+void ICACHE_FLASH_ATTR make_ip_header (u8 *buffer,u32 dest_ip)
+{
+  u16 result16;  //Checksum
+  Ethernet_Header *ethernet;
+  IP_Header       *ip;
+
+  ethernet = (Ethernet_Header *)&buffer[ETHER_OFFSET];
+  ip       = (IP_Header       *)&buffer[IP_OFFSET];
+  
+  //STACK_DEBUG("make ip header\n");  
+  new_eth_header (buffer, dest_ip);         //Erzeugt einen neuen Ethernetheader
+
+  ethernet->EnetPacketType = HTONS(0x0800); //Payload 0x0800=IP
+  IP_id_counter++;
+
+  ip->IP_Frag_Offset = 0x0040;  //don't fragment
+  ip->IP_ttl         = 128;      //max. hops
+  ip->IP_Id          = htons(IP_id_counter);
+  ip->IP_Vers_Len    = 0x45;  //4 BIT Die Versionsnummer von IP, 
+  ip->IP_Tos         = 0;
+  ip->IP_Destaddr    = dest_ip;
+  ip->IP_Srcaddr     = *((u32 *)&eth_cur->myip[0]);
+  ip->IP_Hdr_Cksum   = 0;
+
+  //Berechnung der IP Header lnge  
+  result16 = (ip->IP_Vers_Len & 0x0F) << 2;
+
+  //jetzt wird die Checksumme berechnet
+  result16 = checksum (&ip->IP_Vers_Len, result16, 0);
+
+  //schreibt Checksumme ins Packet
+  ip->IP_Hdr_Cksum = htons(result16);
+  return;
+}
+
+//----------------------------------------------------------------------------
+//Diese Routine verwaltet TCP-Eintrge
+void ICACHE_FLASH_ATTR tcp_entry_add (u8 *buffer)
+{
+  u32 result32;
+  u8 port_index;
+
+  TCP_Header *tcp;
+  IP_Header  *ip;
+
+  tcp = (TCP_Header *)&buffer[TCP_OFFSET];
+  ip  = (IP_Header  *)&buffer[IP_OFFSET];
+
+  //Entry already exists?
+  for (u8 index = 0;index<(MAX_TCP_ENTRY);index++)
+  {
+      if( (tcp_entry[index].ip       == ip->IP_Srcaddr  ) &&
+          (tcp_entry[index].src_port == tcp->TCP_SrcPort) &&
+          (tcp_entry[index].iface    == ETH_IF_INDEX()  )    )
+      {
+          //Record found Time refresh. With data in flight our sequence
+          //number is snd_nxt, not what the peer has acked so far
+          tcp_entry[index].ack_counter = tcp_tx_pending(index) ? htons32(tcp_entry[index].snd_nxt)
+                                                               : tcp->TCP_Acknum;
+          tcp_entry[index].seq_counter = tcp->TCP_Seqnum;
+          tcp_entry[index].status      = tcp->TCP_HdrFlags;
+          tcp_entry[index].tx_window   = htons(tcp->TCP_Window);
+          tcp_idle_touch(index);
+          if ( tcp_entry[index].time != TCP_TIME_OFF )
+          {
+              tcp_entry_timer(index, TCP_MAX_ENTRY_TIME);
+          }
+          result32 = htons(ip->IP_Pktlen) - IP_VERS_LEN - ((tcp->TCP_Hdrlen& 0xF0) >>2);
+          result32 = result32 + htons32(tcp_entry[index].seq_counter);
+          tcp_entry[index].seq_counter = htons32(result32);
+    
+          STACK_DEBUG("\t - TCP Entry found %u\n",index);
+          return;
+      }
+  }
+
+  //Find outdoor entry
+  for (u8 index = 0;index<(MAX_TCP_ENTRY);index++)
+  {
+      if(tcp_entry[index].ip == 0)
+      {
+          tcp_entry[index].ip          = ip->IP_Srcaddr;
+          tcp_entry[index].iface       = ETH_IF_INDEX();
+          tcp_entry[index].src_port    = tcp->TCP_SrcPort;
+          tcp_entry[index].dest_port   = tcp->TCP_DestPort;
+          tcp_entry[index].ack_counter = tcp->TCP_Acknum;
+          tcp_entry[index].seq_counter = tcp->TCP_Seqnum;
+          tcp_entry[index].status      = tcp->TCP_HdrFlags;
+          tcp_entry[index].tx_window   = htons(tcp->TCP_Window);
+          tcp_entry[index].app_status  = 0;
+          tcp_entry_timer(index, TCP_MAX_ENTRY_TIME);
+          tcp_entry[index].error_count = 0;
+          tcp_entry[index].first_ack   = 0;
+          tcp_idle_touch(index);
+          
+          /* New listing - but if SrcPort is our app port, then copy in espconn data */
+          // Perform TCP Port with Port Dest application list
+          port_index= 0;
+          while (TCP_PORT_TABLE[port_index].port && TCP_PORT_TABLE[port_index].port!=(htons(tcp->TCP_DestPort)))
+          { 
+            port_index++;
+          }          
+          // If index is too large , then quit any existing application for Port
+          // Starts from a client what ? Will a client application to open a port ?
+          if (TCP_PORT_TABLE[port_index].port) { 
+            /* Only populate the encconn struct if its for an ESP application */
+            union {
+              u32 theint;
+              u8 thech[4];
+            } unionip;
+            
+            STACK_DEBUG("Connection to registered ESP app\n");
+            /* Copy in TCP data for our connection now - link this to the espconn */
+            tcp_entry[index].tcp_data.remote_port         = tcp_entry[index].src_port;
+            tcp_entry[index].tcp_data.local_port          = tcp_entry[index].dest_port;
+            unionip.theint                                = tcp_entry[index].ip;
+            memcpy(tcp_entry[index].tcp_data.remote_ip, unionip.thech, 4);     
+            memcpy(tcp_entry[index].tcp_data.local_ip, eth_cur->myip, 4);  
+
+            tcp_entry[index].tcp_data.connect_callback    = TCP_PORT_TABLE[port_index].espconn->proto.tcp->connect_callback;
+            tcp_entry[index].tcp_data.reconnect_callback  = TCP_PORT_TABLE[port_index].espconn->proto.tcp->reconnect_callback;
+            tcp_entry[index].tcp_data.disconnect_callback = TCP_PORT_TABLE[port_index].espconn->proto.tcp->disconnect_callback;
+            tcp_entry[index].tcp_data.write_finish_fn     = TCP_PORT_TABLE[port_index].espconn->proto.tcp->write_finish_fn;
+
+            /* Do the connection encconn as well */
+            tcp_entry[index].encconn.type                 = TCP_PORT_TABLE[port_index].espconn->type;
+            tcp_entry[index].encconn.state                = ESPCONN_LISTEN; /* FIXME: Figure this out */           
+            tcp_entry[index].encconn.proto.tcp            = &tcp_entry[index].tcp_data;  
+            tcp_entry[index].encconn.recv_callback        = TCP_PORT_TABLE[port_index].espconn->recv_callback;
+            tcp_entry[index].encconn.sent_callback        = TCP_PORT_TABLE[port_index].espconn->sent_callback;
+            tcp_entry[index].encconn.link_cnt             = TCP_PORT_TABLE[port_index].espconn->link_cnt; /* FIXME: Figure this out */
+            tcp_entry[index].encconn.reverse              = TCP_PORT_TABLE[port_index].espconn->reverse;  /* FIXME: Figure this out */
+          }
+          
+          STACK_DEBUG("TCP NewListing %u\n",index);
+          return;  
+      }
+  }
+  //Entry could not be included
+  STACK_DEBUG("Server Busy (NO MORE CONNECTIONS)!\n");
+  return;
+}
+
+//----------------------------------------------------------------------------
+//Diese Routine sucht den etntry eintrag - on the current interface
+char ICACHE_FLASH_ATTR tcp_entry_search (u32 dest_ip,u16 SrcPort)
+{
+	for (u8 index = 0;index<MAX_TCP_ENTRY;index++)
+	{
+    //STACK_DEBUG("\t - Search %u, ip = %u, scrPort = %u\n",index, tcp_entry[index].ip, htons(tcp_entry[index].src_port));
+		if(	tcp_entry[index].ip == dest_ip &&
+			tcp_entry[index].src_port == SrcPort &&
+			tcp_entry[index].iface == ETH_IF_INDEX())
+		{
+			return(index);
+		}
+	}
+	return (MAX_TCP_ENTRY);
+}
+
+//----------------------------------------------------------------------------
+//This routine manages the UDP ports
+void ICACHE_FLASH_ATTR udp_socket_process(void)
+{
+	u8 port_index = 0;	
+	UDP_Header *udp;
+	u8 len;
+    
+	udp = (UDP_Header *)&eth_buffer[UDP_OFFSET];
+
+  while (port_index < MAX_APP_ENTRY && UDP_PORT_TABLE[port_index].port!=(htons(udp->udp_DestPort)))
+	{ 
+		port_index++;
+	}
+	
+	// If index is too big , then quit any existing application for the Port
+	if (port_index >= MAX_APP_ENTRY || !UDP_PORT_TABLE[port_index].port)
+	{ 
+		//No existing application found (END) - only unicast gets told so
+		//STACK_DEBUG("UDP No app found!\n");
+		if (((IP_Header *)&eth_buffer[IP_OFFSET])->IP_Destaddr == *((u32*)&eth_cur->myip[0])) icmp_port_unreachable();
+		return;
+	}
+  STACK_DEBUG("Calling UDP app\n");
+	//zugehrige Anwendung ausfhren
+	UDP_PORT_TABLE[port_index].fp(0, port_index); 
+	return;
+}
+
+//----------------------------------------------------------------------------
+//Diese Routine Erzeugt ein neues UDP Packet
+void ICACHE_FLASH_ATTR create_new_udp_packet( u16  data_length,
+                            u16  src_port,
+                            u16  dest_port,
+                            u32 dest_ip)
+{
+  udp_packet_send(eth_buffer, data_length, src_port, dest_port, dest_ip);
+}
+
+//----------------------------------------------------------------------------
+//Builds the headers around data_length bytes at UDP_DATA_START of buffer and
+//sends it, ports in host order
+static void ICACHE_FLASH_ATTR udp_packet_send( u8 *buffer,
+                            u16  data_length,
+                            u16  src_port,
+                            u16  dest_port,
+                            u32 dest_ip)
+{
+  u16  result16;
+  u32 result32;
+
+  UDP_Header *udp;
+  IP_Header  *ip;
+  
+  udp = (UDP_Header *)&buffer[UDP_OFFSET];
+  ip  = (IP_Header  *)&buffer[IP_OFFSET];
+
+  //STACK_DEBUG("create_new_udp_packet()\n");  
+  
+  udp->udp_SrcPort  = htons(src_port);
+  udp->udp_DestPort = htons(dest_port);
+
+  data_length     += UDP_HDR_LEN;                //UDP Packetlength
+  udp->udp_Hdrlen = htons(data_length);
+
+  data_length     += IP_VERS_LEN;                //IP Headerlnge + UDP Headerlnge
+  ip->IP_Pktlen = htons(data_length);
+  data_length += ETH_HDR_LEN;
+  ip->IP_Proto = PROT_UDP;
+  make_ip_header (buffer,dest_ip);
+
+  udp->udp_Chksum = 0;
+
+  //Berechnet Headerlnge und Addiert Pseudoheaderlnge 2XIP = 8
+  result16 = htons(ip->IP_Pktlen) + 8;
+  result16 = result16 - ((ip->IP_Vers_Len & 0x0F) << 2);
+  result32 = result16 + 0x09;
+
+  //Routine berechnet die Checksumme
+  result16 = checksum ((&ip->IP_Vers_Len+12), result16, result32);
+  udp->udp_Chksum = htons(result16);
+
+  TX_PACKET_SEND(data_length,buffer); //send...
+  eth_cur->no_reset = 1;
+  return;
+}
+
+//----------------------------------------------------------------------------
+//UDP sockets - espconns bound to a port through esp_enc_api_udp_create, and
+//the multicast groups joined for them. Sends are built in a buffer of their
+//own, so a socket can send from its recv callback without touching the
+//frame being received
+static u8  udp_tx_buffer[MTU_SIZE];
+static u32 udp_mcast_group[UDP_MCAST_GROUPS];   //0 = free
+
+static u8 ICACHE_FLASH_ATTR udp_mcast_index (u32 group)
+{
+  u8 i;
+
+  for (i = 0; i < UDP_MCAST_GROUPS; i++)
+  {
+    if (udp_mcast_group[i] == group) break;
+  }
+  return i;
+}
+
+//----------------------------------------------------------------------------
+//IGMPv2 membership report or leave (RFC 2236)
+static void ICACHE_FLASH_ATTR igmp_send (u8 type, u32 group, u32 dest_ip)
+{
+  u8 buffer[ETH_HDR_LEN + IP_VERS_LEN + IGMP_LEN];
+  IP_Header *ip = (IP_Header *)&buffer[IP_OFFSET];
+  u8 *igmp      = &buffer[ETH_HDR_LEN + IP_VERS_LEN];
+  u16 result16;
+
+  igmp[0] = type;
+  igmp[1] = 0;
+  igmp[2] = 0;
+  igmp[3] = 0;
+  os_memcpy(&igmp[4], &group, 4);
+  result16 = checksum(igmp, IGMP_LEN, 0);
+  igmp[2] = result16 >> 8;
+  igmp[3] = result16 & 0xFF;
+
+  ip->IP_Pktlen = htons(IP_VERS_LEN + IGMP_LEN);
+  ip->IP_Proto  = PROT_IGMP;
+  make_ip_header (buffer,dest_ip);
+  ip->IP_ttl       = 1;
+  ip->IP_Hdr_Cksum = 0;
+  ip->IP_Hdr_Cksum = htons(checksum(&ip->IP_Vers_Len, IP_VERS_LEN, 0));
+
+  stack_stats.igmp_report++;
+  TX_PACKET_SEND(sizeof(buffer),buffer);
+  eth_cur->no_reset = 1;
+}
+
+//----------------------------------------------------------------------------
+//Membership query - report the groups asked for, so the switches keep
+//forwarding them
+static void ICACHE_FLASH_ATTR igmp_input (void)
+{
+  IP_Header *ip = (IP_Header *)&eth_buffer[IP_OFFSET];
+  u8 *igmp      = &eth_buffer[ETH_HDR_LEN + ((ip->IP_Vers_Len & 0x0F) << 2)];
+  u32 group;
+
+  if (htons(ip->IP_Pktlen) < ((ip->IP_Vers_Len & 0x0F) << 2) + IGMP_LEN) return;
+  if (igmp[0] != IGMP_QUERY) return;
+  os_memcpy(&group, &igmp[4], 4);
+
+  for (u8 i = 0; i < UDP_MCAST_GROUPS; i++)
+  {
+    if (udp_mcast_group[i] && (group == 0 || group == udp_mcast_group[i]))
+    {
+      igmp_send(IGMP_V2_REPORT, udp_mcast_group[i], udp_mcast_group[i]);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+//Joins a multicast group (network order) on every interface, the ENCs let
+//multicast through as long as any group is joined
+sint8 ICACHE_FLASH_ATTR stack_igmpJoin(u32 group)
+{
+  u8 i;
+
+  if (!IP_MULTICAST(group)) return ESPCONN_ARG;
+  if (udp_mcast_index(group) < UDP_MCAST_GROUPS) return ESPCONN_OK;
+  i = udp_mcast_index(0);
+  if (i >= UDP_MCAST_GROUPS) return ESPCONN_MEM;
+
+  udp_mcast_group[i] = group;
+  for (i = 0; i < ENC_DEVICES; i++)
+  {
+    eth_if_use(i);
+    ETH_RX_MULTICAST(1);
+    igmp_send(IGMP_V2_REPORT, group, group);
+  }
+  return ESPCONN_OK;
+}
+
+sint8 ICACHE_FLASH_ATTR stack_igmpLeave(u32 group)
+{
+  u8 i = udp_mcast_index(group);
+
+  if (group == 0 || i >= UDP_MCAST_GROUPS) return ESPCONN_ARG;
+  udp_mcast_group[i] = 0;
+  for (i = 0; i < ENC_DEVICES; i++)
+  {
+    eth_if_use(i);
+    igmp_send(IGMP_LEAVE, group, IGMP_ALL_ROUTERS);
+  }
+
+  for (i = 0; i < UDP_MCAST_GROUPS; i++)
+  {
+    if (udp_mcast_group[i]) return ESPCONN_OK;
+  }
+  for (i = 0; i < ENC_DEVICES; i++)
+  {
+    eth_if_use(i);
+    ETH_RX_MULTICAST(0);
+  }
+  return ESPCONN_OK;
+}
+
+//----------------------------------------------------------------------------
+//Datagram for a socket - the sender goes into remote_ip/remote_port of the
+//espconn before the recv callback, as the SDK does it. local_ip gets the
+//address of the interface it came in on, a reply goes back out of that one
+void ICACHE_FLASH_ATTR serveUDP (u8 index, u8 port_index)
+{
+  struct espconn *conn = UDP_PORT_TABLE[port_index].espconn;
+  UDP_Header *udp = (UDP_Header *)&eth_buffer[UDP_OFFSET];
+  IP_Header  *ip  = (IP_Header  *)&eth_buffer[IP_OFFSET];
+  u16 len = htons(udp->udp_Hdrlen);
+
+  if (!conn || len < UDP_HDR_LEN) return;
+  len -= UDP_HDR_LEN;
+
+  os_memcpy(conn->proto.udp->remote_ip, &ip->IP_Srcaddr, 4);
+  conn->proto.udp->remote_port = htons(udp->udp_SrcPort);
+  os_memcpy(conn->proto.udp->local_ip, eth_cur->myip, 4);
+  stack_stats.udp_rx_sock++;
+  if (conn->recv_callback)
+  {
+    conn->recv_callback(conn, (char *)&eth_buffer[UDP_DATA_START], len);
+  }
+}
+
+//----------------------------------------------------------------------------
+//Binds a socket to proto.udp->local_port, like espconn_create
+sint8 ICACHE_FLASH_ATTR stack_udpCreate(struct espconn *conn)
+{
+  s8 port_index;
+
+  if (!conn->proto.udp || !conn->proto.udp->local_port) return ESPCONN_ARG;
+  for (u8 i = 0; i < MAX_APP_ENTRY; i++)
+  {
+    if (UDP_PORT_TABLE[i].port == conn->proto.udp->local_port) return ESPCONN_ISCONN;
+  }
+  port_index = add_udp_app(conn->proto.udp->local_port, (void(*)(u8,u8))serveUDP);
+  if (port_index < 0) return ESPCONN_MEM;
+  UDP_PORT_TABLE[port_index].espconn = conn;
+  return ESPCONN_OK;
+}
+
+sint8 ICACHE_FLASH_ATTR stack_udpDelete(struct espconn *conn)
+{
+  for (u8 i = 0; i < MAX_APP_ENTRY; i++)
+  {
+    if (UDP_PORT_TABLE[i].port && UDP_PORT_TABLE[i].espconn == conn)
+    {
+      UDP_PORT_TABLE[i].port    = 0;
+      UDP_PORT_TABLE[i].espconn = NULL;
+      return ESPCONN_OK;
+    }
+  }
+  return ESPCONN_ARG;
+}
+
+//----------------------------------------------------------------------------
+//Sends a datagram to proto.udp->remote_ip/remote_port, like espconn_sendto.
+//Broadcast and multicast addresses are fine, there is no fragmentation. It
+//goes out of the interface whose address is in local_ip, else the one the
+//destination is on
+sint8 ICACHE_FLASH_ATTR stack_udpSendTo(struct espconn *conn, u8 *dataIn, u16 data_length)
+{
+  u32 dest_ip, local_ip;
+  u8 iface;
+
+  if (!conn->proto.udp || data_length > MTU_SIZE - UDP_DATA_START) return ESPCONN_ARG;
+
+  os_memcpy(&dest_ip, conn->proto.udp->remote_ip, 4);
+  os_memcpy(&local_ip, conn->proto.udp->local_ip, 4);
+  for (iface = 0; iface < ENC_DEVICES; iface++)
+  {
+    if (local_ip != 0 && local_ip == *((u32*)&eth_if[iface].myip[0])) break;
+  }
+  if (iface >= ENC_DEVICES) iface = eth_if_route(dest_ip);
+  if (iface == ETH_IF_NONE) return ESPCONN_RTE;
+  eth_if_use(iface);
+
+  os_memcpy(&udp_tx_buffer[UDP_DATA_START], dataIn, data_length);
+  udp_packet_send(udp_tx_buffer, data_length, conn->proto.udp->local_port,
+                  conn->proto.udp->remote_port, dest_ip);
+  stack_stats.udp_tx_sock++;
+  return ESPCONN_OK;
+}
+
+//----------------------------------------------------------------------------
+//This routine manages the TCP ports
+void ICACHE_FLASH_ATTR tcp_socket_process(void)
+{
+	u8 index = 0;
+	u8 port_index = 0;
+	u32 result32 = 0;
+	u16 data_len = TCP_DATA_END_VAR - TCP_DATA_START_VAR;
+	u16 old_window;
+
+	TCP_Header *tcp;
+	tcp = (TCP_Header *)&eth_buffer[TCP_OFFSET];
+
+	IP_Header *ip; 	
+	ip = (IP_Header *)&eth_buffer[IP_OFFSET];
+
+	// Perform TCP Port with Port Dest application list
+	while (TCP_PORT_TABLE[port_index].port && TCP_PORT_TABLE[port_index].port!=(htons(tcp->TCP_DestPort)))
+	{ 
+		port_index++;
+	}
+	
+	// If index is too large , then quit any existing application for Port
+  // Connects of ours have no app on their local port, they go by the entry
+	index = tcp_entry_search (ip->IP_Srcaddr,tcp->TCP_SrcPort);
+	if (!TCP_PORT_TABLE[port_index].port &&
+	    !(index < MAX_TCP_ENTRY && tcp_entry[index].client && tcp_entry[index].dest_port == tcp->TCP_DestPort))
+	{ 
+		//No existing application available! (END)
+		STACK_DEBUG("TCP No application found!\n");
+		tcp_send_reset();
+		return;
+	}
+
+  STACK_DEBUG("Received Flags (Remote Port=%u) = ", htons(tcp->TCP_SrcPort));	
+  if(tcp->TCP_HdrFlags & SYN_FLAG)
+	{	
+		STACK_DEBUG("SYN ");	
+	}
+  if(tcp->TCP_HdrFlags & ACK_FLAG)
+	{	
+		STACK_DEBUG("ACK ");	
+	}
+  if(tcp->TCP_HdrFlags & RST_FLAG)
+	{	
+		STACK_DEBUG("RST ");	
+	}
+  if(tcp->TCP_HdrFlags & PSH_FLAG)
+	{	
+		STACK_DEBUG("PSH ");	
+	}
+  if(tcp->TCP_HdrFlags & FIN_FLAG)
+	{	
+		STACK_DEBUG("FIN ");	
+	}
+  STACK_DEBUG("\n");	
+  
+	//Server opens port - SYNACK
+	if((tcp->TCP_HdrFlags & SYN_FLAG) && (tcp->TCP_HdrFlags & ACK_FLAG))
+	{	
+		STACK_DEBUG("SYN ACK received\n");
+    
+		// Only for a connect of ours
+		if (index >= MAX_TCP_ENTRY || !tcp_entry[index].client)
+		{
+			STACK_DEBUG("SYN ACK without a connect!\n");
+			tcp_send_reset();
+			return;
+		}
+		if (tcp_entry[index].first_ack)
+		{
+			//Our ACK got lost, the server sends it again
+			tcp_entry[index].status =  ACK_FLAG;
+			create_new_tcp_packet(0,index);
+			return;
+		}
+		if (htons32(tcp->TCP_Acknum) != htons32(tcp_entry[index].ack_counter) + 1)
+		{
+			STACK_DEBUG("SYN ACK does not ack our SYN!\n");
+			tcp_send_reset();
+			return;
+		}
+
+		tcp_entry_add (eth_buffer);
+		tcp_entry_timer(index, TCP_TIME_OFF);
+	
+		STACK_DEBUG("TCP port has been opened by the server STACK:%u\n",index);
+		result32 = htons32(tcp_entry[index].seq_counter) + 1;
+		tcp_entry[index].seq_counter = htons32(result32);
+		tcp_entry[index].status =  ACK_FLAG;
+    STACK_DEBUG("Sending ACK\n");
+		create_new_tcp_packet(0,index);
+		//Server port has been opened app . can now send data !
+		tcp_entry[index].app_status  = 1;
+		tcp_entry[index].first_ack   = 1;
+		tcp_entry[index].error_count = 0;
+		stack_stats.tcp_connect++;
+		tcp_entry[index].encconn.state = ESPCONN_CONNECT;
+		if (tcp_entry[index].tcp_data.connect_callback)
+		{
+			tcp_entry[index].tcp_data.connect_callback(&tcp_entry[index].encconn);
+		}
+		return;
+	}
+	
+	// Connecting to us - SYN
+	if (tcp->TCP_HdrFlags == SYN_FLAG)
+	{
+		index = tcp_entry_search (ip->IP_Srcaddr,tcp->TCP_SrcPort);
+		if (index < MAX_TCP_ENTRY)
+		{
+			//Our SYN ACK got lost, the client sends its SYN again - same SYN ACK,
+			//same ISN. A SYN on a connection that is up only gets an ACK
+			if (tcp_entry[index].client || tcp_entry[index].first_ack || tcp_entry[index].app_status)
+			{
+				tcp_entry[index].status =  ACK_FLAG;
+			}
+			else
+			{
+				tcp_entry[index].status =  ACK_FLAG | SYN_FLAG;
+			}
+			create_new_tcp_packet(0,index);
+			return;
+		}
+		
+		//Takes on entry as it is a server - are applying for the port
+		tcp_entry_add (eth_buffer);
+		//Was the listing successful?
+		index = tcp_entry_search (ip->IP_Srcaddr,tcp->TCP_SrcPort);
+		if (index >= MAX_TCP_ENTRY) //Found entry if not equal
+		{
+			STACK_DEBUG("TCP entry not successful!\n");
+			return;
+		}
+	
+		STACK_DEBUG("TCP New SERVER Conn:STACK:%u, SrcPort=%u\n",index, tcp->TCP_SrcPort);
+		
+		//Our sequence numbers start somewhere unguessable, not at the SYN's ack field
+		tcp_entry[index].ack_counter = htons32(os_random());
+		tcp_entry[index].status =  ACK_FLAG | SYN_FLAG;
+		create_new_tcp_packet(0,index);
+		return;
+	}
+
+	//Find Packet entry in the TCP stack !
+	index = tcp_entry_search (ip->IP_Srcaddr,tcp->TCP_SrcPort);
+	
+	if (index >= MAX_TCP_ENTRY) //Entry not found
+	{
+		STACK_DEBUG("TCP entry not found\n");
+    
+    if (tcp->TCP_HdrFlags == ACK_FLAG)
+    {
+      /* Could be a response to a FINACK flag sent by us, so ignore 
+        FIXME: Do this better, pretty sure this isn't right */
+      STACK_DEBUG("\t - Seemingly random ACK packet - ignoring\n");
+      return;
+    }
+		tcp_entry_add (eth_buffer);
+		if(tcp->TCP_HdrFlags & FIN_FLAG || tcp->TCP_HdrFlags & RST_FLAG)
+		{	
+      index = tcp_entry_search (ip->IP_Srcaddr,tcp->TCP_SrcPort);
+			result32 = htons32(tcp_entry[index].seq_counter) + 1;
+			tcp_entry[index].seq_counter = htons32(result32);
+			
+			if (tcp_entry[index].status & FIN_FLAG)
+			{
+        //STACK_DEBUG("Sending FIN/ACK to FIN\n");
+        STACK_DEBUG("Sending ACK to FIN\n");
+				tcp_entry[index].status = ACK_FLAG;
+				//tcp_entry[index].status = ACK_FLAG|FIN_FLAG;
+				create_new_tcp_packet(0,index);
+			}
+			tcp_index_del(index);
+			STACK_DEBUG("A->Deleted TCP stack entry! STACK:%u\n",index);
+			return;
+		}
+		return;
+	}
+
+	//Connection to us not up yet - the ACK has to be for our SYN ACK, ISN+1.
+	//tcp_entry_add would take on any ack number
+	if (!tcp_entry[index].client && !tcp_entry[index].first_ack && !tcp_entry[index].app_status &&
+	    (tcp->TCP_HdrFlags & ACK_FLAG) && !(tcp->TCP_HdrFlags & RST_FLAG) &&
+	    htons32(tcp->TCP_Acknum) != htons32(tcp_entry[index].ack_counter) + 1)
+	{
+		STACK_DEBUG("ACK does not ack our SYN ACK!\n");
+		tcp_send_reset();
+		return;
+	}
+
+	//Data beyond the window we advertised (a zero window probe) - answer with
+	//the window as it is now and take nothing
+	if (data_len && (s32)(htons32(tcp->TCP_Seqnum) - tcp_entry[index].rx_edge) >= 0)
+	{
+		stack_stats.tcp_wnd_probe++;
+		tcp_entry[index].status = ACK_FLAG;
+		create_new_tcp_packet(0,index);
+		return;
+	}
+
+	//Established - only data that follows on from the last goes further
+	if ((tcp_entry[index].first_ack || tcp_entry[index].app_status) &&
+	    !(tcp->TCP_HdrFlags & (SYN_FLAG | RST_FLAG)) &&
+	    !tcp_rx_sequence(index, &data_len))
+	{
+		return;
+	}
+
+	//Refresh the entry
+	old_window = tcp_entry[index].tx_window;
+	tcp_entry_add (eth_buffer);
+	index = tcp_entry_search (ip->IP_Srcaddr,tcp->TCP_SrcPort);
+  
+	//Host wants to end connection! - FIN or RST
+	if(tcp_entry[index].status & FIN_FLAG || tcp_entry[index].status & RST_FLAG)
+	{	
+		result32 = htons32(tcp_entry[index].seq_counter) + 1;
+		tcp_entry[index].seq_counter = htons32(result32);
+		
+		if (tcp_entry[index].status & FIN_FLAG)
+		{
+      STACK_DEBUG("Calling function with FIN flag...\n");
+			// Announce the end of the application !
+			tcp_app_run(index, port_index);
+      STACK_DEBUG("B->ACKing FIN flag\n");
+			tcp_entry[index].status = ACK_FLAG;
+			create_new_tcp_packet(0,index);
+		}
+		else
+		{
+			tcp_app_closed(index, ESPCONN_RST);
+		}
+		tcp_index_del(index);
+		STACK_DEBUG("B->Deleted TCP stack entry! STACK:%u\n",index);
+		return;
+	}
+
+	//Nothing of ours left unacked - the SYN ACK of a new connection or a FIN
+	//the peer answered. The retransmit timeout stops, from here on idle_timer
+	//alone decides how long a quiet connection lives
+	if ((tcp_entry[index].status & ACK_FLAG) && !tcp_tx_pending(index))
+	{
+		tcp_entry_timer(index, TCP_TIME_OFF);
+	}
+
+	//Data of ours still out - the app hears nothing of acks until all of it
+	//is acked, tcp_poll sends what is due
+	if (tcp_tx_pending(index) && (tcp->TCP_HdrFlags & ACK_FLAG))
+	{
+		if (!tcp_ack_input(index, htons32(tcp->TCP_Acknum), data_len, old_window) && data_len == 0)
+		{
+			return;
+		}
+	}
+	
+	// Data for application - PSH && ACK
+	if((tcp_entry[index].status & PSH_FLAG) && 
+		(tcp_entry[index].status & ACK_FLAG))
+	{
+		// Run associated application
+		if(tcp_entry[index].app_status < 0xFFFE) tcp_entry[index].app_status++;	
+		//tcp_entry[index].status =  ACK_FLAG | PSH_FLAG;
+		tcp_entry[index].status =  ACK_FLAG;
+		tcp_app_run(index, port_index); 
+		data_len += tcp_ooo_deliver(index, port_index);
+		tcp_ack_data(index, data_len);
+		return;
+	}
+	
+	//No data received packet was co nfirmed for application
+  //z.B . after the connection ( SYN packet )
+	if((tcp_entry[index].status & ACK_FLAG) && (tcp_entry[index].first_ack == 0))
+	{
+    union {
+    u32 theint;
+    u8 thech[4];
+  } remoteip; 
+    STACK_DEBUG("First ACK\n");
+		//No further action
+		tcp_entry[index].first_ack = 1;
+    /* If this is the first time we're in here, call connectcb */
+    STACK_DEBUG("serveHTTPD - call connectcb!\n");
+    if (tcp_entry[index].encconn.proto.tcp->connect_callback) {
+      tcp_entry[index].encconn.proto.tcp->connect_callback(&tcp_entry[index].encconn);
+    }
+		return;
+	}
+	
+	//Acknowledgment of receipt of a signal sent from the application package ( END )
+	if((tcp_entry[index].status & ACK_FLAG) && (tcp_entry[index].first_ack == 1))
+	{
+		//ACK for Connection release
+		if(tcp_entry[index].app_status == 0xFFFF)
+		{
+			return;
+		}
+    
+		// Run associated application
+		tcp_entry[index].status =  ACK_FLAG;
+		if(tcp_entry[index].app_status < 0xFFFE) tcp_entry[index].app_status++;
+		tcp_app_run(index, port_index); 
+		if (data_len) data_len += tcp_ooo_deliver(index, port_index);
+		tcp_ack_data(index, data_len);
+		return;
+	}
+  
+	return;
+}
+
+sint8 stack_register_tcp_accept(struct espconn *espconn, u8 stack_func) {
+  u8 port_index;
+  
+  /* Register corresponding function to stack, and link to orig espconn */
+  switch (stack_func) {
+    case STACK_HTTPD:
+      port_index = add_tcp_app (espconn->proto.tcp->local_port, (void(*)(u8,u8))serveHTTPD, espconn);
+      break;
+    case STACK_MQTT:
+      break;
+    // Add in what ever other module you need here
+    default:
+      return 0;
+      break;
+  }
+  if (port_index < 0) {
+    return 0;
+  } 
+  return 1;  
+}
+
+void ICACHE_FLASH_ATTR serveHTTPD (u8 index, u8 port_index) { 
+  u16 dat_p;
+
+  if(tcp_entry[index].status & FIN_FLAG) {
+    // FIXME: Mark for destruction...
+    tcp_entry[index].encconn.state = ESPCONN_CLOSE;
+    if (tcp_entry[index].encconn.proto.tcp->disconnect_callback) {
+      tcp_entry[index].encconn.proto.tcp->disconnect_callback(&tcp_entry[index].encconn);
+    }
+    return;
+  }  
+  
+  STACK_DEBUG("appS==%u\n", tcp_entry[index].app_status);
+  /* Every segment with data goes to the app - as long as eth_buffer really
+    holds one from this peer, a retransmit timeout calls in here as well */
+  dat_p = 0;
+  if (((IP_Header *)&eth_buffer[IP_OFFSET])->IP_Srcaddr == tcp_entry[index].ip &&
+      ((TCP_Header *)&eth_buffer[TCP_OFFSET])->TCP_SrcPort == tcp_entry[index].src_port) {
+    dat_p=TCP_DATA_END_VAR - TCP_DATA_START_VAR;
+  }
+  if (dat_p) {
+    if (tcp_entry[index].encconn.recv_callback) {
+      tcp_entry[index].encconn.recv_callback(&tcp_entry[index].encconn, 
+                                            (char *)&(eth_buffer[TCP_DATA_START_VAR]), 
+                                            dat_p);
+    }
+  } else if (tcp_entry[index].app_status > 1) {
+    if((tcp_entry[index].status & ACK_FLAG) && tcp_entry[index].encconn.sent_callback) {
+      /* ACK to sent data - so call the sent callback */
+      tcp_entry[index].encconn.sent_callback (&tcp_entry[index].encconn);           
+    }      
+  } 
+}
+
+/* Entry of an app's connection by remote ip/port (port in network order, the
+  way the espconn has it) and local ip, over whichever interface - that one
+  is selected. A local ip of 0 takes any. MAX_TCP_ENTRY if there is none */
+static u8 ICACHE_FLASH_ATTR tcp_conn_index(struct espconn *conn, u16 remote_port) {
+  u32 remote_ip, local_ip;
+  u8 index;
+  
+  memcpy(&remote_ip, conn->proto.tcp->remote_ip, 4);
+  memcpy(&local_ip, conn->proto.tcp->local_ip, 4);
+  for (index = 0; index < MAX_TCP_ENTRY; index++) {
+    if (tcp_entry[index].ip == remote_ip && tcp_entry[index].src_port == remote_port &&
+        (local_ip == 0 || local_ip == *((u32 *)&eth_if[tcp_entry[index].iface].myip[0]))) {
+      eth_if_use(tcp_entry[index].iface);
+      return index;
+    }
+  }
+  return MAX_TCP_ENTRY;
+}
+
+sint8 ICACHE_FLASH_ATTR stack_connDisconnect(struct espconn *conn) {
+  u8 index;
+  
+  STACK_DEBUG("stack_connDisconnect - send FINACK\n");
+  
+  index = tcp_conn_index(conn, conn->proto.tcp->remote_port);
+  
+  if (index >= MAX_TCP_ENTRY) {
+    STACK_DEBUG("HOUSTON WE HAVE A PROBLEM - no index found for sendData\r\n!");
+    // TODO: Catch this properly
+    conn = NULL;
+    return 0;
+  }
+  tcp_entry[index].encconn.state = ESPCONN_CLOSE;
+  if (tcp_entry[index].encconn.proto.tcp->disconnect_callback) {
+    tcp_entry[index].encconn.proto.tcp->disconnect_callback(&tcp_entry[index].encconn);
+  }
+  tcp_entry[index].status = ACK_FLAG | FIN_FLAG;          
+  create_new_tcp_packet(0,index);
+  tcp_index_del(index);
+  return 1;
+}
+
+/* Is the connection stack_connect opened for conn still there? */
+sint8 ICACHE_FLASH_ATTR stack_connAlive(struct espconn *conn) {
+  return (tcp_conn_index(conn, htons(conn->proto.tcp->remote_port)) < MAX_TCP_ENTRY) ? 1 : 0;
+}
+
+/* Drops the connection stack_connect opened for conn without a word to the
+  peer or the app - the link it ran over is gone */
+sint8 ICACHE_FLASH_ATTR stack_connAbort(struct espconn *conn) {
+  u8 index;
+  
+  index = tcp_conn_index(conn, htons(conn->proto.tcp->remote_port));
+  if (index >= MAX_TCP_ENTRY) {
+    return 0;
+  }
+  STACK_DEBUG("stack_connAbort STACK:%u\n", index);
+  tcp_index_del(index);
+  return 1;
+}
+
+/* Opens a connection to remote_ip/remote_port of conn, like espconn_connect - a
+  local_port of 0 gets a free one. The connect callback comes once it is up,
+  the reconnect callback with ESPCONN_RST / ESPCONN_TIMEOUT if it never does */
+sint8 ICACHE_FLASH_ATTR stack_connect(struct espconn *conn) {
+  union {
+    u32 theint;
+    u8 thech[4];
+  } unionip;
+  u8 index, iface;
+  
+  if (!conn->proto.tcp || !conn->proto.tcp->remote_port) {
+    return ESPCONN_ARG;
+  }
+  memcpy(unionip.thech, conn->proto.tcp->remote_ip,4);
+  
+  /* Over the interface the destination is on, conn gets its address like
+    espconn_connect gives it the station's */
+  iface = eth_if_route(unionip.theint);
+  if (iface == ETH_IF_NONE) {
+    return ESPCONN_RTE;
+  }
+  memcpy(conn->proto.tcp->local_ip, eth_if[iface].myip, 4);
+  if (tcp_conn_index(conn, htons(conn->proto.tcp->remote_port)) < MAX_TCP_ENTRY) {
+    return ESPCONN_ISCONN;
+  }
+  eth_if_use(iface);
+  if (!conn->proto.tcp->local_port) {
+    conn->proto.tcp->local_port = tcp_local_port();
+  }
+  
+  index = tcp_port_open(unionip.theint, htons(conn->proto.tcp->remote_port), htons(conn->proto.tcp->local_port));
+  if (index >= MAX_TCP_ENTRY) {
+    return ESPCONN_MEM;
+  }
+  STACK_DEBUG("stack_connect - SYN sent STACK:%u\n", index);
+  
+  /* Callbacks come with the entry's own espconn, as for accepted connections -
+    ports in it are in network order like theirs, send on that one */
+  tcp_entry[index].tcp_data                     = *conn->proto.tcp;
+  tcp_entry[index].tcp_data.remote_port         = tcp_entry[index].src_port;
+  tcp_entry[index].tcp_data.local_port          = tcp_entry[index].dest_port;
+  memcpy(tcp_entry[index].tcp_data.local_ip, eth_cur->myip, 4);
+  tcp_entry[index].encconn.type                 = conn->type;
+  tcp_entry[index].encconn.state                = ESPCONN_WAIT;
+  tcp_entry[index].encconn.proto.tcp            = &tcp_entry[index].tcp_data;
+  tcp_entry[index].encconn.recv_callback        = conn->recv_callback;
+  tcp_entry[index].encconn.sent_callback        = conn->sent_callback;
+  tcp_entry[index].encconn.link_cnt             = conn->link_cnt;
+  tcp_entry[index].encconn.reverse              = conn->reverse;
+  return ESPCONN_OK;
+}
+
+/* Transmit class for the data of this connection, TX_CLASS_AUTO goes by segment size */
+sint8 ICACHE_FLASH_ATTR stack_setTxClass(struct espconn *conn, u8 tx_class) {
+  u8 index;
+  
+  index = tcp_conn_index(conn, conn->proto.tcp->remote_port);
+  if (index >= MAX_TCP_ENTRY) {
+    return ESPCONN_ARG;
+  }
+  tcp_entry[index].tx_class = tx_class;
+  return ESPCONN_OK;
+}
+
+sint8 ICACHE_FLASH_ATTR stack_sendData(struct espconn *conn, uint8_t *dataIn, u16 data_length) {
+  esp_enc_iovec iov;
+  
+  iov.base = dataIn;
+  iov.len  = data_length;
+  return stack_sendv(conn, &iov, 1);
+}
+
+/* Same for data in several pieces, e.g. headers and a body. They are
+  gathered straight into the send buffer, which has to hold the data until
+  it is acked anyway - segments go to the ENC from there without another
+  copy through eth_buffer */
+sint8 ICACHE_FLASH_ATTR stack_sendv(struct espconn *conn, const esp_enc_iovec *iov, u8 iovcnt) {
+  u32 data_length = 0;
+  u8 index, i;
+  u8 *p;
+  
+  index = tcp_conn_index(conn, conn->proto.tcp->remote_port);
+  if (index >= MAX_TCP_ENTRY) {
+    STACK_DEBUG("HOUSTON WE HAVE A PROBLEM - no index found for sendData\r\n!");
+    return ESPCONN_ARG;
+  }
+  
+  /* Still sending the last lot - the app waits for its sent callback */
+  if (tcp_tx_pending(index)) {
+    return ESPCONN_MAXNUM;
+  }
+  
+  for (i = 0; i < iovcnt; i++) {
+    data_length += iov[i].len;
+  }
+  if (data_length == 0 || data_length > 0xFFFF) {
+    return ESPCONN_ARG;
+  }
+  
+  /* Kept until acked, goes out in segments as the peer's window allows */
+  tcp_entry[index].tx_buf = (u8 *)os_malloc(data_length);
+  if (!tcp_entry[index].tx_buf) {
+    return ESPCONN_MEM;
+  }
+  for (i = 0, p = tcp_entry[index].tx_buf; i < iovcnt; p += iov[i].len, i++) {
+    os_memcpy(p, iov[i].base, iov[i].len);
+  }
+  tcp_entry[index].tx_len      = data_length;
+  tcp_entry[index].tx_seq      = htons32(tcp_entry[index].ack_counter);
+  tcp_entry[index].snd_una     = tcp_entry[index].tx_seq;
+  tcp_entry[index].snd_nxt     = tcp_entry[index].tx_seq;
+  tcp_entry[index].dupacks     = 0;
+  tcp_entry[index].in_recovery = 0;
+  tcp_entry[index].tx_rexmit   = 0;
+  tcp_output(index);
+  return ESPCONN_OK;
+}
+
+/* Sends data straight out of flash, e.g. a static file - nothing is read
+  into RAM, segments are written to the ENC from the flash mapping and
+  retransmits read it again. Only the first MB of flash is mapped */
+sint8 ICACHE_FLASH_ATTR stack_sendFlash(struct espconn *conn, u32 flash_addr, u16 data_length) {
+  u8 index;
+  
+  if (flash_addr == 0 || data_length == 0 || flash_addr + data_length > FLASH_MAP_SIZE) {
+    return ESPCONN_ARG;
+  }
+  index = tcp_conn_index(conn, conn->proto.tcp->remote_port);
+  if (index >= MAX_TCP_ENTRY) {
+    return ESPCONN_ARG;
+  }
+  if (tcp_tx_pending(index)) {
+    return ESPCONN_MAXNUM;
+  }
+  
+  tcp_entry[index].tx_flash    = flash_addr;
+  tcp_entry[index].tx_len      = data_length;
+  tcp_entry[index].tx_seq      = htons32(tcp_entry[index].ack_counter);
+  tcp_entry[index].snd_una     = tcp_entry[index].tx_seq;
+  tcp_entry[index].snd_nxt     = tcp_entry[index].tx_seq;
+  tcp_entry[index].dupacks     = 0;
+  tcp_entry[index].in_recovery = 0;
+  tcp_entry[index].tx_rexmit   = 0;
+  stack_stats.tcp_tx_flash += data_length;
+  tcp_output(index);
+  return ESPCONN_OK;
+}
+
+/* Closes (hold) or reopens the receive window of a connection, like
+  espconn_recv_hold - data already in flight is still delivered */
+sint8 ICACHE_FLASH_ATTR stack_recvHold(struct espconn *conn, u8 hold) {
+  u8 index;
+  
+  index = tcp_conn_index(conn, conn->proto.tcp->remote_port);
+  if (index >= MAX_TCP_ENTRY) {
+    return ESPCONN_ARG;
+  }
+  tcp_entry[index].rx_hold = hold ? 1 : 0;
+  if (!hold) {
+    tcp_poll();
+  }
+  return ESPCONN_OK;
+}
+
+//----------------------------------------------------------------------------
+//This routine creates a new TCP Packet
+void ICACHE_FLASH_ATTR create_new_tcp_packet(u16 data_length,u8 index)
+{
+  tcp_packet_send(data_length, index, NULL, 0);
+}
+
+//----------------------------------------------------------------------------
+//Builds the headers in eth_buffer and sends them. The payload is either
+//already at TCP_DATA_START, or goes to the ENC straight from data or from
+//flash at flash_addr
+static void ICACHE_FLASH_ATTR tcp_packet_send (u16 data_length, u8 index, const u8 *data, u32 flash_addr)
+{
+  u16  result16;
+  u32 result32;
+  u16  bufferlen;
+  
+  TCP_Header *tcp;
+  IP_Header  *ip;
+
+  tcp = (TCP_Header *)&eth_buffer[TCP_OFFSET];
+  ip  = (IP_Header  *)&eth_buffer[IP_OFFSET];
+
+  //Out of the interface the connection runs over, whoever sends
+  eth_if_use(tcp_entry[index].iface);
+
+  tcp->TCP_SrcPort   = tcp_entry[index].dest_port;
+  tcp->TCP_DestPort  = tcp_entry[index].src_port;
+  tcp->TCP_UrgentPtr = 0;
+  tcp_entry[index].rx_window = tcp_rx_window(index);
+  tcp->TCP_Window    = htons(tcp_entry[index].rx_window);
+  tcp->TCP_Hdrlen    = 0x50;
+
+  STACK_DEBUG("Sending to TCP Port %u\n", htons(tcp->TCP_DestPort));
+
+  result32 = htons32(tcp_entry[index].seq_counter); 
+
+  tcp->TCP_HdrFlags = tcp_entry[index].status;
+  
+  STACK_DEBUG("\t - Sending Flags= ");	
+  if(tcp->TCP_HdrFlags & SYN_FLAG) {	
+		STACK_DEBUG("SYN ");	
+	}
+  if(tcp->TCP_HdrFlags & ACK_FLAG) {	
+		STACK_DEBUG("ACK ");	
+	}
+  if(tcp->TCP_HdrFlags & RST_FLAG) {	
+		STACK_DEBUG("RST ");	
+	}
+  if(tcp->TCP_HdrFlags & PSH_FLAG) {	
+		STACK_DEBUG("PSH ");	
+	}
+  if(tcp->TCP_HdrFlags & FIN_FLAG) {	
+		STACK_DEBUG("FIN ");	
+	}
+  STACK_DEBUG("\n");
+  
+  //if (hackMACflag == 0) {
+    //Connection is established
+    if(tcp_entry[index].status & SYN_FLAG)
+    {
+        result32++;
+        // MSS-Option (siehe RFC 879) wil.
+        eth_buffer[TCP_DATA_START]   = 2;
+        eth_buffer[TCP_DATA_START+1] = 4;
+        eth_buffer[TCP_DATA_START+2] = (MAX_WINDOWS_SIZE >> 8) & 0xff;
+        eth_buffer[TCP_DATA_START+3] = MAX_WINDOWS_SIZE & 0xff;
+        data_length                  = 0x04;
+        tcp->TCP_Hdrlen              = 0x60;
+    }
+  //}
+
+  tcp->TCP_Acknum = htons32(result32);
+  tcp->TCP_Seqnum = tcp_entry[index].ack_counter;
+  tcp_entry[index].rx_edge = result32 + tcp_entry[index].rx_window;
+
+  bufferlen = IP_VERS_LEN + TCP_HDR_LEN + data_length;    //IP Headerlnge + TCP Headerlnge
+  ip->IP_Pktlen = htons(bufferlen);                      //Hier wird erstmal der IP Header neu erstellt
+  bufferlen += ETH_HDR_LEN;
+  ip->IP_Proto = PROT_TCP;
+  make_ip_header (eth_buffer,tcp_entry[index].ip);
+
+  tcp->TCP_Chksum = 0;
+
+  //Berechnet Headerlnge und Addiert Pseudoheaderlnge 2XIP = 8
+  result16 = htons(ip->IP_Pktlen) + 8;
+  result16 = result16 - ((ip->IP_Vers_Len & 0x0F) << 2);
+  result32 = result16 - 2;
+
+  //Checksum, pseudo header and TCP header first if the payload is elsewhere
+  if (data && data_length)
+  {
+    result32 = checksum_add ((&ip->IP_Vers_Len+12), 8 + TCP_HDR_LEN, result32);
+    result16 = checksum ((u8 *)data, data_length, result32);
+  }
+  else if (flash_addr && data_length)
+  {
+    result32 = checksum_add ((&ip->IP_Vers_Len+12), 8 + TCP_HDR_LEN, result32);
+    result16 = checksum_flash (flash_addr, data_length, result32);
+  }
+  else
+  {
+    result16 = checksum ((&ip->IP_Vers_Len+12), result16, result32);
+  }
+  tcp->TCP_Chksum = htons(result16);
+   
+  //Send the TCP packet
+  if (data && data_length)
+  {
+    tx_queue_send_v(bufferlen - data_length, eth_buffer, data_length, data, tcp_entry[index].tx_class);
+  }
+  else if (flash_addr && data_length)
+  {
+    tx_queue_send_flash(bufferlen - data_length, eth_buffer, data_length, flash_addr, tcp_entry[index].tx_class);
+  }
+  else
+  {
+    tx_queue_send(bufferlen,eth_buffer,tcp_entry[index].tx_class);
+  }
+  eth_cur->no_reset = 1;
+
+  //for Retransmission
+  tcp_entry[index].status = 0;
+  return;
+}
+
+//----------------------------------------------------------------------------
+//Diese Routine schliet einen offenen TCP-Port
+void ICACHE_FLASH_ATTR tcp_Port_close (u8 index)
+{
+	STACK_DEBUG("Port is closed in TCP stack STACK:%u\n",index);
+	tcp_entry[index].app_status = 0xFFFF;
+	tcp_entry[index].status =  ACK_FLAG | FIN_FLAG;
+	create_new_tcp_packet(0,index);
+	tcp_entry[index].error_count = 0;
+	tcp_entry_timer(index, TCP_MAX_ENTRY_TIME);
+	return;
+}
+
+//----------------------------------------------------------------------------
+//This routine finds the application using the TCP ports
+void ICACHE_FLASH_ATTR find_and_start (u8 index)
+{
+    u8 port_index = 0;
+
+    //site search with application in the list
+    while ( (TCP_PORT_TABLE[port_index].port!=(htons(tcp_entry[index].dest_port))) &&
+          (port_index < MAX_APP_ENTRY)                                                 )
+    { 
+        port_index++;
+    }
+    if (port_index >= MAX_APP_ENTRY) return;
+  
+    //associated application run ( Send repeat )
+    TCP_PORT_TABLE[port_index].fp(index, port_index);
+    return;
+}
+
+//----------------------------------------------------------------------------
+//This routine opens a TCP port - sends the SYN, the SYN ACK comes in through
+//tcp_socket_process. Ports in network order, returns the entry or
+//MAX_TCP_ENTRY if the table is full
+u8 ICACHE_FLASH_ATTR tcp_port_open (u32 dest_ip,u16 port_dst,u16 port_src)
+{
+	u8 index;
+    
+	ETS_GPIO_INTR_DISABLE();
+		
+	//Find entry
+	for (index = 0;index<MAX_TCP_ENTRY;index++)
+	{
+		if(tcp_entry[index].ip == 0)
+		{
+			tcp_index_del(index);
+			tcp_entry[index].ip = dest_ip;
+			tcp_entry[index].iface = ETH_IF_INDEX();
+			tcp_entry[index].src_port = port_dst;
+			tcp_entry[index].dest_port = port_src;
+			tcp_entry[index].ack_counter = htons32(os_random());
+			tcp_entry[index].seq_counter = 0;
+			tcp_entry[index].error_count = 0;
+			tcp_entry[index].client = 1;
+			tcp_entry_timer(index, TCP_MAX_ENTRY_TIME);
+			tcp_idle_touch(index);
+			STACK_DEBUG("TCP Open New Listing %u\n",index);
+			break;
+		}
+	}
+	if (index >= MAX_TCP_ENTRY)
+	{
+		//Entry could not be included
+		STACK_DEBUG("Busy (NO MORE CONNECTIONS)!\n");
+		ETS_GPIO_INTR_ENABLE();
+		return (MAX_TCP_ENTRY);
+	}
+	
+	tcp_entry[index].status =  SYN_FLAG;
+	create_new_tcp_packet(0,index);
+	ETS_GPIO_INTR_ENABLE();
+	return (index);
+}
+
+//----------------------------------------------------------------------------
+//Next free local port for a connect of ours, host order
+static u16 ICACHE_FLASH_ATTR tcp_local_port (void)
+{
+	static u16 port = 0;
+	u8 i;
+
+	if (port < TCP_LOCAL_PORT_MIN) port = TCP_LOCAL_PORT_MIN + os_random() % 0x1000;
+	for (;;)
+	{
+		if (++port < TCP_LOCAL_PORT_MIN) port = TCP_LOCAL_PORT_MIN;
+		for (i = 0; i < MAX_TCP_ENTRY; i++)
+		{
+			if (tcp_entry[i].ip && tcp_entry[i].dest_port == htons(port)) break;
+		}
+		if (i == MAX_TCP_ENTRY && tcp_app_index_port(port) == MAX_APP_ENTRY) return port;
+	}
+}
+
+//----------------------------------------------------------------------------
+//Diese Routine lscht einen Eintrag
+void ICACHE_FLASH_ATTR tcp_index_del (u8 index)
+{
+	if (index<MAX_TCP_ENTRY + 1)
+	{
+		tcp_entry[index].ip = 0;
+		tcp_entry[index].src_port = 0;
+		tcp_entry[index].dest_port = 0;
+		tcp_entry[index].ack_counter = 0;
+		tcp_entry[index].seq_counter = 0;
+		tcp_entry[index].status = 0;
+		tcp_entry[index].app_status = 0;
+		tcp_entry_timer(index, 0);
+		tcp_entry[index].first_ack = 0;
+		tcp_entry[index].rx_hold = 0;
+		tcp_entry[index].client = 0;
+		tcp_entry[index].tx_class = TX_CLASS_AUTO;
+		tcp_entry[index].rx_window = 0;
+		tcp_entry[index].tx_window = 0;
+		tw_cancel(&tcp_entry[index].persist_timer);
+		if (tcp_entry[index].tx_buf)
+		{
+			os_free(tcp_entry[index].tx_buf);
+			tcp_entry[index].tx_buf = NULL;
+		}
+		tcp_entry[index].tx_flash = 0;
+		tcp_entry[index].in_recovery = 0;
+		tcp_entry[index].tx_rexmit = 0;
+		tw_cancel(&tcp_entry[index].idle_timer);
+		tcp_entry[index].ka_probes = 0;
+		tcp_ooo_free(index);
+	}
+	return;
+}
+
+//----------------------------------------------------------------------------
+//End of file: stack.c
+
+
+
+
+
+
+
@@ -1,377 +1,639 @@
-/*-----------------------------------------------------------------------------------------
-Author:         Mark F (Cicero-MF) mark@cdelec.co.za    
-Known Issues:   none
-Version:        18.05.2016
-Description:    Header for stack.c
-
-  This code was modified for use with the ESP8266, based off an original AVR version by  
-   Author:         Radig Ulrich mailto: mail@ulrichradig.de
-   Version:        24.10.2007
-   Description:    Ethernet Stack
-
------------------------------------------------------------------------------------------
-License:
-  This program is free software; you can redistribute it and/or modify it under
-  the terms of the GNU General Public License as published by the Free Software
-  Foundation; either version 2 of the License, or (at your option) any later
-  version.
-  This program is distributed in the hope that it will be useful, but
-
-  WITHOUT ANY WARRANTY;
-
-  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
-  PURPOSE. See the GNU General Public License for more details.
-
-  You should have received a copy of the GNU General Public License along with
-  this program; if not, write to the Free Software Foundation, Inc., 51
-  Franklin St, Fifth Floor, Boston, MA 02110, USA
-
-  http://www.gnu.de/gpl-ger.html
------------------------------------------------------------------------------------------*/
-
-#ifndef _STACK_H
-	#define _STACK_H
-
-#include <string.h>
-#include "enc28j60.h"
-#include "user_config.h"
-#include "timer.h"
-#include "httpd.h"
-
-#define MAX_APP_ENTRY 5
-
-typedef struct __attribute__((packed))
-{
-	volatile u8 data_present  : 1;
-	volatile u8 timer		      : 1;
-	volatile u8 no_reset		  : 1;
-}ethStruct;
-
-extern ethStruct eth;
-
-typedef struct __attribute__((packed))
-{
-	u16 port;		      // Local Port!
-	void(*fp)(u8, u8);  	// Pointer to function to be executed
-  struct espconn *espconn;
-} TCP_PORT_ITEM;
-
-typedef struct __attribute__((packed))
-{
-	u16 port;		      // Port
-	void(*fp)(u8, u8);  	// Pointer to function to be executed
-} UDP_PORT_ITEM;
-
-extern TCP_PORT_ITEM TCP_PORT_TABLE[MAX_APP_ENTRY];
-extern UDP_PORT_ITEM UDP_PORT_TABLE[MAX_APP_ENTRY];
-	
-#define HTONS(n) (u16)((((u16) (n)) << 8) | (((u16) (n)) >> 8))
-#define HTONS32(x) ((x & 0xFF000000)>>24)+((x & 0x00FF0000)>>8)+((x & 0x0000FF00)<<8)+((x & 0x000000FF)<<24)
-
-extern u8 myip[4];
-extern u8 netmask[4];
-extern u8 router_ip[4];
-extern u8 broadcast_ip[4];
-
-extern u16 IP_id_counter;
-
-#define MAX_TCP_ENTRY 8
-#define MAX_UDP_ENTRY 3
-#define MAX_ARP_ENTRY 6
-//#define MTU_SIZE 700
-#define MTU_SIZE 1080
-
-#define ARP_REPLY_LEN		60
-#define ICMP_REPLY_LEN		98
-#define ARP_REQUEST_LEN		42
-
-extern u8 eth_buffer[MTU_SIZE+1];
-
-#define TCP_TIME_OFF 		0xFF
-#define TCP_MAX_ENTRY_TIME	3
-#define MAX_TCP_PORT_OPEN_TIME 30 //30sec
-#define MAX_TCP_ERRORCOUNT	5
-
-#define ARP_MAX_ENTRY_TIME 100 //100sec.
-
-#define MAX_WINDOWS_SIZE (MTU_SIZE-100)
-
-typedef struct __attribute__((packed))
-{
-	volatile u8 arp_t_mac[6];
-	volatile u32 arp_t_ip;
-	volatile u16 arp_t_time;
-} arp_table;
-
-//FYI - Cant have attribute packed for this
-typedef struct
-{
-	volatile u32 ip;
-	volatile u16  src_port;
-	volatile u16  dest_port;
-	volatile u32 ack_counter;
-	volatile u32 seq_counter;
-	volatile u8 status;
-	volatile u16  app_status;
-	volatile u8 time;
-	volatile u8 error_count;
-	volatile u8 first_ack	:1;
-  
-  /* To copy the way the SDK does things with espconn,
-    we need separate ones per port/entry 
-    TODO: Would be better to malloc these... */
-  esp_tcp tcp_data;
-  struct espconn encconn;
-} tcp_table;
-
-typedef struct __attribute__((packed))
-{
-    u8 ip1[4];
-    volatile u8 no;
-    volatile u8 result;
-}PING_STRUCT;
-
-extern PING_STRUCT ping;
-//----------------------------------------------------------------------------
-//Prototypes
-void stack_encInterrupt (void);
-void stack_updateIPs (void);
-sint8 stack_register_tcp_accept(struct espconn *espconn, u8 stack_func);
-
-u16  htons(u16 val);
-u32 htons32(u32 val);
-u32 stack_init (void);
-void check_packet (void);
-void eth_get_data (void);
-
-void new_eth_header (u8 *,u32);
-
-char arp_entry_search (u32);
-void arp_reply (void);
-void arp_entry_add (void);
-char arp_request (u32);
-
-void make_ip_header (u8 *,u32);
-void icmp_send (u32,u8,u8,u16,u16);
-u16 ICACHE_FLASH_ATTR checksum (u8 *pointer,u16 result16,u32 result32);
-
-void udp_socket_process(void);
-
-void tcp_entry_add (u8 *);
-void tcp_socket_process(void);
-char tcp_entry_search (u32 ,u16);
-void tcp_Port_close (u8);
-void tcp_port_open (u32, u16, u16);
-void tcp_index_del (u8);
-void create_new_tcp_packet(u16,u8);
-void create_new_udp_packet(	u16,u16,u16,u32);
-
-void find_and_start (u8 index);
-void tcp_timer_call (void);
-void arp_timer_call (void);
-s8 add_tcp_app (u16, void(*fp1)(u8, u8), struct espconn *espconn);
-void kill_tcp_app (u16 port);
-void add_udp_app (u16, void(*fp1)(u8, u8));
-void kill_udp_app (u16 port);
-void change_port_tcp_app (u16, u16);
-void pinging (void);
-
-#define ETHER_OFFSET			0x00
-#define ETHER_MACDEST			(ETHER_OFFSET)
-#define ETHER_MACSRC			(ETHER_MACDEST+6)
-#define ETHER_PKTYPE			(ETHER_MACSRC+6)
-
-#define ARP_OFFSET				0x0E
-#define ARP_HWTYPE        (ARP_OFFSET)
-#define ARP_PRTYPE		    (ARP_HWTYPE+2)
-#define ARP_HWLEN	        (ARP_PRTYPE+2)
-#define ARP_PRLEN         (ARP_HWLEN+1)
-#define ARP_OP            (ARP_PRLEN+1)
-#define ARP_SHADDR        (ARP_OP+2)
-#define ARP_SIPADDR       (ARP_SHADDR+6)
-#define ARP_THADDR        (ARP_SIPADDR+4)
-#define ARP_TIPADDR       (ARP_THADDR+6)
-
-#define IP_OFFSET				  0x0E
-#define IP_OFS_VER_LEN    (IP_OFFSET)
-#define IP_OFS_TOS        (IP_OFS_VER_LEN+1)
-#define IP_OFS_PKTLEN     (IP_OFS_TOS+1)
-#define IP_OFS_ID         (IP_OFS_PKTLEN+2)
-#define IP_OFS_FRAG_OFS   (IP_OFS_ID+2)
-#define IP_OFS_TTL        (IP_OFS_FRAG_OFS+2)
-#define IP_OFS_PROTO      (IP_OFS_TTL+1)
-#define IP_OFS_HDR_CHK    (IP_OFS_PROTO+1)
-#define IP_OFS_SRCADDR    (IP_OFS_HDR_CHK+2)
-#define IP_OFS_DESTADDR   (IP_OFS_SRCADDR+4)
-
-#define ICMP_OFFSET				0x22
-#define ICMP_OFS_TYPE     (ICMP_OFFSET)
-#define ICMP_OFS_CODE     (ICMP_OFS_TYPE+1)
-#define ICMP_OFS_CHKSUM   (ICMP_OFS_CODE+1)
-#define ICMP_OFS_ID       (ICMP_OFS_CHKSUM+2)
-#define ICMP_OFS_SEQNO    (ICMP_OFS_ID+2)
-
-#define ICMP_DATA				0x2A
-
-#define TCP_OFFSET				  0x22
-#define TCP_OFS_SCR_PORT    (TCP_OFFSET)
-#define TCP_OFS_DST_PORT    (TCP_OFS_SCR_PORT+2)
-#define TCP_OFS_SEQ_NUM     (TCP_OFS_DST_PORT+2)
-#define TCP_OFS_ACK_NUM     (TCP_OFS_SEQ_NUM+4)
-#define TCP_OFS_HDR_LEN     (TCP_OFS_ACK_NUM+4)
-#define TCP_OFS_HDR_FLAGS   (TCP_OFS_HDR_LEN+1)
-#define TCP_OFS_WINDOW      (TCP_OFS_HDR_FLAGS+1)
-#define TCP_OFS_CHKSUM      (TCP_OFS_WINDOW+2)
-#define TCP_OFS_URGENT_PTR  (TCP_OFS_CHKSUM+2)
-
-#define UDP_OFFSET				0x22
-
-extern arp_table arp_entry[MAX_ARP_ENTRY];
-extern tcp_table tcp_entry[MAX_TCP_ENTRY+1];
-
-//IP Protocol Types
-#define	PROT_ICMP				0x01	//zeigt an die Nutzlasten enthalten das ICMP Prot
-#define	PROT_TCP				0x06	//zeigt an die Nutzlasten enthalten das TCP Prot.
-#define	PROT_UDP				0x11	//zeigt an die Nutzlasten enthalten das UDP Prot.	
-
-//Defines fr IF Abfrage
-#define IF_MYIP 				(ip->IP_Destaddr==*((u32*)&myip[0]))
-#define IP_UDP_PACKET 			(ip->IP_Proto == PROT_UDP)
-#define IP_TCP_PACKET 			(ip->IP_Proto == PROT_TCP)
-#define IP_ICMP_PACKET 			(ip->IP_Proto == PROT_ICMP)
-
-//Defines fr if Abfrage
-#define ETHERNET_IP_DATAGRAMM	ethernet->EnetPacketType == 0x0008
-#define ETHERNET_ARP_DATAGRAMM 	ethernet->EnetPacketType == 0x0608
-
-#define IP_VERS_LEN 			20
-#define TCP_HDR_LEN 			20
-#define UDP_HDR_LEN				8
-#define ETH_HDR_LEN 			14
-#define TCP_DATA_START			(IP_VERS_LEN + TCP_HDR_LEN + ETH_HDR_LEN)
-#define UDP_DATA_START			(IP_VERS_LEN + UDP_HDR_LEN + ETH_HDR_LEN)
-#define UDP_DATA_END_VAR        (ETH_HDR_LEN + ((eth_buffer[IP_PKTLEN]<<8)+eth_buffer[IP_PKTLEN+1]) - UDP_HDR_LEN + 8)
-
-#define	TCP_HDRFLAGS_FIX		0x2E
-#define TCP_DATA_START_VAR		(ETH_HDR_LEN + IP_VERS_LEN + ((eth_buffer[TCP_HDRFLAGS_FIX] & 0xF0) >>2))
-
-#define	IP_PKTLEN				0x10
-#define TCP_DATA_END_VAR 		(ETH_HDR_LEN + IP_VERS_LEN + ((eth_buffer[IP_PKTLEN]<<8)+eth_buffer[IP_PKTLEN+1]) - ((eth_buffer[TCP_HDRFLAGS_FIX] & 0xF0) >>2))
-
-//TCP Flags
-#define  FIN_FLAG				0x01	//Datenbertragung beendet (finished)
-#define  SYN_FLAG				0x02	//Verbindungs aufbauen (synchronize)
-#define  RST_FLAG				0x04	//Verbindung neu initialisieren (reset)
-#define  PSH_FLAG				0x08	//Datenbergabe an Anwendung beschleunigen (push)
-#define  ACK_FLAG				0x10	//Datenbertragung besttigen (acknowledged)
-
-//----------------------------------------------------------------------------
-//Aufbau eines Ethernetheader
-//
-//
-//
-//
-typedef struct __attribute__((packed)) {
-	u8 EnetPacketDest[6];	//MAC Zieladresse 6 Byte
-	u8 EnetPacketSrc[6];	//MAC Quelladresse 6 Byte
-	u16 EnetPacketType;		//Nutzlast 0x0800=IP Datagramm;0x0806 = ARP
-} Ethernet_Header;
-
-//----------------------------------------------------------------------------
-//Aufbau eines ARP Header
-//	
-//	2 BYTE Hardware Typ				|	2 BYTE Protokoll Typ	
-//	1 BYTE Lnge Hardwareadresse	|	1 BYTE Lnge Protokolladresse
-//	2 BYTE Operation
-//	6 BYTE MAC Adresse Absender		|	4 BYTE IP Adresse Absender
-//	6 BYTE MAC Adresse Empfnger	|	4 BYTE IP Adresse Empfnger	
-typedef struct __attribute__((packed)) {
-		u16 ARP_HWType;		//Hardware Typ enthlt den Code fr Ethernet oder andere Link Layer
-		u16 ARP_PRType;		//Protokoll Typ enthlt den Code fr IP o. anderes bertragungsprotokoll
-		u8 ARP_HWLen;		//Lnge der Hardwareadresse enthlt 6 fr 6 Byte lange MAC Adressen
-		u8 ARP_PRLen;		//Lnge der Protocolladresse enthlt 4 fr 4 Byte lange IP Adressen
-		u16 ARP_Op;			//Enthlt Code der signalisiert ob es sich um eine Anfrage o. Antwort handelt
-		u8 ARP_SHAddr[6];	//Enthlt die MAC Adresse des Anfragenden  
-		u32 ARP_SIPAddr;    //Enthlt die IP Adresse des Absenders
-		u8 ARP_THAddr[6];	//MAC Adresse Ziel, ist in diesem Fall 6 * 00,da die Adresse erst noch herausgefunden werden soll (ARP Request)
-		u32 ARP_TIPAddr;    //IP Adresse enthlt die IP Adresse zu der die Kommunikation aufgebaut werden soll 
-} ARP_Header;
-
-//----------------------------------------------------------------------------
-//Aufbau eines IP Datagramms (B=BIT)
-//	
-//4B Version	|4B Headergr.	|8B Tos	|16B Gesamtlnge in Bytes	
-//16B Identifikation			|3B Schalter	|13B Fragmentierungsposition
-//8B Time to Live	|8B Protokoll	|16B Header Prfsumme 
-//32B IP Quelladresse
-//32B IB Zieladresse
-typedef struct __attribute__((packed)) {
-	u8	IP_Vers_Len;	//4 BIT Die Versionsnummer von IP, 
-									//meistens also 4 + 4Bit Headergre 	
-	u8	IP_Tos;			//Type of Service
-	u16	IP_Pktlen;		//16 Bit Komplette Lng des IP Datagrams in Bytes
-	u16	IP_Id;			//ID of the package for fragmentation 
-									//reassembling
-	u16	IP_Frag_Offset;	//wird benutzt um ein fragmentiertes 
-									//IP Packet wieder korrekt zusammenzusetzen
-	u8	IP_ttl;			//8 Bit Time to Live die lebenszeit eines Paket
-	u8	IP_Proto;		//Zeigt das hherschichtige Protokoll an 
-									//(TCP, UDP, ICMP)
-	u16	IP_Hdr_Cksum;	//Checksumme des IP Headers
-	u32	IP_Srcaddr;		//32 Bit IP Quelladresse
-	u32	IP_Destaddr;	//32 Bit IP Zieladresse
-} IP_Header;
-
-//----------------------------------------------------------------------------
-//Aufbau einer ICMP Nachricht
-//	
-//8 BIT Typ	|8 BIT Code	|16 BIT Prfsumme	
-//Je nach Typ			|Nachricht unterschiedlich
-//Testdaten
-//
-//8 BIT Typ = 0 Echo Reply oder 8 Echo request	
-typedef struct __attribute__((packed)) {
-		u8     	ICMP_Type;		//8 bit typ identifiziert Aufgabe der Nachricht 
-											//0 = Echo Reply 8 = Echo Request
-		u8     	ICMP_Code;		//8 Bit Code enthlt Detailangaben zu bestimmten Typen
-		u16     	ICMP_Cksum;		//16 Bit Prfsumme enthlt die CRC Prfsumme
-		u16     	ICMP_Id;		//2 byte Identifizierung
-		u16     	ICMP_SeqNum;	//Sequenznummer
-} ICMP_Header;
-
-
-//----------------------------------------------------------------------------
-//TCP Header Layout
-//
-//
-typedef struct __attribute__((packed)) {
-	u16 	TCP_SrcPort;	//der Quellport fr die Verbindung (Socket)
-	u16 	TCP_DestPort;	//der Zielport fr die Verbindung (Socket)
-	u32	TCP_Seqnum;	//numerierter Bytestrom
-	u32	TCP_Acknum;	//numerierter Bytestrom (Gegenrichtung)
-	u8  TCP_Hdrlen;
-	u8 	TCP_HdrFlags;//4Bit Lnge des Headers in 32 Bit schritten rest Flags
-	u16	TCP_Window;	//Fenstergre max. 64K Byte
-	u16	TCP_Chksum;	//Enthlt eine Prfsumme ber Header und Datenbereich
-	u16	TCP_UrgentPtr;	//16 Bit fr dringende bertragung
-} TCP_Header;
-
-//----------------------------------------------------------------------------
-//UDP Header Layout
-//
-//
-typedef struct __attribute__((packed)) {
-	u16 	udp_SrcPort;	//der Quellport fr die Verbindung (Socket)
-	u16 	udp_DestPort;	//der Zielport fr die Verbindung (Socket)
-	u16   udp_Hdrlen;
-	u16	udp_Chksum;	//Enthlt eine Prfsumme ber Header und Datenbereich
-} UDP_Header;
-
-/* HTTDP specific functions */
-void ICACHE_FLASH_ATTR serveHTTPD (u8 index, u8 port_index);
-sint8 ICACHE_FLASH_ATTR stack_sendData(struct espconn *conn, uint8_t *dataIn, u16 data_length);
-void ICACHE_FLASH_ATTR stack_startEthTask (void);
-sint8 ICACHE_FLASH_ATTR stack_connDisconnect(struct espconn *conn);
-
-
-#endif // #define _STACK_H
+/*-----------------------------------------------------------------------------------------
+Author:         Mark F (Cicero-MF) mark@cdelec.co.za    
+Known Issues:   none
+Version:        18.05.2016
+Description:    Header for stack.c
+
+  This code was modified for use with the ESP8266, based off an original AVR version by  
+   Author:         Radig Ulrich mailto: mail@ulrichradig.de
+   Version:        24.10.2007
+   Description:    Ethernet Stack
+
+-----------------------------------------------------------------------------------------
+License:
+  This program is free software; you can redistribute it and/or modify it under
+  the terms of the GNU General Public License as published by the Free Software
+  Foundation; either version 2 of the License, or (at your option) any later
+  version.
+  This program is distributed in the hope that it will be useful, but
+
+  WITHOUT ANY WARRANTY;
+
+  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 51
+  Franklin St, Fifth Floor, Boston, MA 02110, USA
+
+  http://www.gnu.de/gpl-ger.html
+-----------------------------------------------------------------------------------------*/
+
+#ifndef _STACK_H
+	#define _STACK_H
+
+#include <string.h>
+#include "enc28j60.h"
+#include "user_config.h"
+#include "timer.h"
+#include "timerwheel.h"
+#include "httpd.h"
+
+#define MAX_APP_ENTRY 5
+
+typedef struct __attribute__((packed))
+{
+	volatile u8 data_present  : 1;  //an ENC interrupt is being serviced
+}ethStruct;
+
+extern ethStruct eth;
+
+//RFC 5227 probe/announce state of an interface address
+typedef struct
+{
+	u32 ip;
+	u8  state;
+	u8  count;
+	u32 last_defend;   //my1secTime
+	TW_TIMER timer;
+} ARP_PROBE;
+
+//One interface per ENC, enc_dev[n] goes with eth_if[n]. eth_if_use() selects
+//both - everything that gets control (receive, timers, the api) selects the
+//interface it works on first, all the stack code below it uses eth_cur
+typedef struct
+{
+	u8  myip[4];
+	u8  netmask[4];
+	u8  router_ip[4];
+	u8  broadcast_ip[4];
+	volatile u8 no_reset;   //the ENC was heard from since the last health check
+	u8  link_up;            //as the PHY last reported it
+	ARP_PROBE probe;
+} ethIf;
+
+extern ethIf  eth_if[ENC_DEVICES];
+extern ethIf *eth_cur;
+
+#define ETH_IF_INDEX()  ((u8)(eth_cur - eth_if))
+#define ETH_IF_NONE     0xFF
+
+//Receive runs as an SDK task posted from the ENC interrupt, a slow timer
+//only picks up lost interrupt edges. Stack timers run off the timer wheel
+#define ETH_TASK_PRIO           USER_TASK_PRIO_1
+#define ETH_TASK_QUEUE_LEN      4
+#define ETH_SIG_RX              1
+#define ETH_RX_BUDGET_MIN       4    //frames per task run with an empty RX ring..
+#define ETH_RX_BUDGET_MAX       16   //..scaled up to this as the ring fills
+#define ETH_RX_TIME_BUDGET      3000 //us per task run, whatever the frame budget
+#define ETH_HOUSEKEEPING_TIME   100  //ms
+#define ETH_CONFIGURE_DELAY     200  //ms from a settings change until the ENC gets it
+
+//Wired self test - UDP frames to ourselves through each ENC in PHY loopback
+#define SELFTEST_PORT           9    //discard
+#define SELFTEST_FRAMES_MAX     1000
+#define SELFTEST_WAIT           10000 //us a frame may take to come back
+#define SELFTEST_BATCH_TIME     20000 //us of frames per timer wheel tick
+
+typedef struct
+{
+	u16 frame_len;      //bytes on the wire, without CRC
+	u16 frames;         //sent, all ENCs..
+	u16 frames_ok;      //..and delivered back to the UDP handler
+	u16 dev_ok[ENC_DEVICES];  //the same per ENC, on its own interface
+	u16 frames_bad;     //came back with other content, or not at all
+	u32 total_us;
+	u32 spi_tx_us;      //writing the frames to the ENC
+	u32 spi_rx_us;      //reading them back
+	u32 wire_us;        //waiting for them to come back
+	u32 checksum_us;    //checksum over each frame as received
+	u32 stack_us;       //check_packet up to the UDP handler
+	u8  running;
+} STACK_SELFTEST;
+
+extern STACK_SELFTEST stack_selftest;
+
+//Idle policy of a listening app, defaults - an entry nothing was heard from
+//for idle_time sec. gets keepalive_cnt probes keepalive_intvl sec. apart,
+//and is reaped if none of them is answered
+#define TCP_IDLE_TIME         120
+#define TCP_KEEPALIVE_INTVL   10
+#define TCP_KEEPALIVE_CNT     3
+
+typedef struct __attribute__((packed))
+{
+	u16 port;		      // Local Port!
+	void(*fp)(u8, u8);  	// Pointer to function to be executed
+  struct espconn *espconn;
+  u16 idle_time;        // sec., 0 = connections never time out
+  u8  keepalive_intvl;  // sec.
+  u8  keepalive_cnt;    // 0 = reap as soon as idle_time is up
+} TCP_PORT_ITEM;
+
+typedef struct __attribute__((packed))
+{
+	u16 port;		      // Port
+	void(*fp)(u8, u8);  	// Pointer to function to be executed
+  struct espconn *espconn;  // socket of esp_enc_api_udp_create, NULL for the stack's own
+} UDP_PORT_ITEM;
+
+#define UDP_MCAST_GROUPS  4   //multicast groups joined at once
+
+extern TCP_PORT_ITEM TCP_PORT_TABLE[MAX_APP_ENTRY];
+extern UDP_PORT_ITEM UDP_PORT_TABLE[MAX_APP_ENTRY];
+	
+#define HTONS(n) (u16)((((u16) (n)) << 8) | (((u16) (n)) >> 8))
+#define HTONS32(x) ((x & 0xFF000000)>>24)+((x & 0x00FF0000)>>8)+((x & 0x0000FF00)<<8)+((x & 0x000000FF)<<24)
+
+extern u16 IP_id_counter;
+
+#define MAX_TCP_ENTRY 8
+#define MAX_UDP_ENTRY 3
+#define MAX_ARP_ENTRY 32
+#define ARP_HASH_SIZE 16 //must be a power of 2
+#define ARP_NO_ENTRY  0xFF
+//#define MTU_SIZE 700
+#define MTU_SIZE 1080
+
+#define ARP_REPLY_LEN		60
+#define ICMP_REPLY_LEN		98
+#define ARP_REQUEST_LEN		42
+
+#define TCP_TIME_OFF 		0xFF
+#define TCP_MAX_ENTRY_TIME	3
+#define MAX_TCP_PORT_OPEN_TIME 30 //30sec, connects of ours give up after this
+#define TCP_LOCAL_PORT_MIN  49152  //local ports for connects of ours
+#define MAX_TCP_ERRORCOUNT	5
+
+#define ARP_MAX_ENTRY_TIME 100 //100sec.
+#define ARP_REFRESH_TIME   10  //entries in use are re-requested 10sec before they expire
+
+//RFC 5227 probe/announce, intervals shortened for a wired LAN (ms)
+#define ARP_PROBE_NUM          3
+#define ARP_PROBE_INTERVAL     250
+#define ARP_ANNOUNCE_WAIT      250
+#define ARP_ANNOUNCE_NUM       2
+#define ARP_ANNOUNCE_INTERVAL  1000
+#define ARP_DEFEND_INTERVAL    10  //sec.
+
+#define ARP_PROBE_IDLE         0
+#define ARP_PROBE_PROBING      1
+#define ARP_PROBE_ANNOUNCING   2
+#define ARP_PROBE_DONE         3
+#define ARP_PROBE_CONFLICT     4
+
+#define MAX_WINDOWS_SIZE (MTU_SIZE-100)
+
+//Receive window - segments only ever wait in the ENC RX ring, so the window
+//comes out of its free space. The cap keeps a couple of busy connections
+//inside the ring at once
+#define TCP_MSS            MAX_WINDOWS_SIZE
+#define TCP_RX_WINDOW_MAX  (2 * TCP_MSS)
+#define TCP_RX_RESERVE     MTU_SIZE   //ring space kept back for ARP, DHCP, SYNs..
+#define TCP_PERSIST_MIN    500        //ms between zero window probes, doubled..
+#define TCP_PERSIST_MAX    60000      //..up to this
+#define TCP_DUPACK_THRESH  3          //dup acks for a fast retransmit, fewer
+                                      //with less than 4 segments in flight
+#define TCP_OOO_MAX        (2 * TCP_MSS)  //bytes held out of order, all connections
+
+//Segment that arrived ahead of a gap, waits in tcp_table.ooo (sorted by seq)
+//until the gap is filled
+typedef struct tcp_ooo_seg
+{
+	struct tcp_ooo_seg *next;
+	u32 seq;                  //host order
+	u16 len;
+	u8  data[];
+} TCP_OOO_SEG;
+
+typedef struct __attribute__((packed))
+{
+	volatile u8 arp_t_mac[6];
+	volatile u32 arp_t_ip;
+	volatile u32 arp_t_expire;      //my1secTime at which the entry goes stale
+	volatile u8 arp_t_hnext;        //next entry in hash chain (or free list)
+	volatile u8 arp_t_lprev;        //LRU list - towards most recently used
+	volatile u8 arp_t_lnext;        //LRU list - towards least recently used
+	volatile u8 arp_t_refresh : 1;  //refresh request already sent
+	volatile u8 arp_t_if;           //interface the peer is on
+} arp_table;
+
+//FYI - Cant have attribute packed for this
+typedef struct
+{
+	volatile u32 ip;
+	volatile u16  src_port;
+	volatile u16  dest_port;
+	volatile u32 ack_counter;
+	volatile u32 seq_counter;
+	volatile u8 status;
+	volatile u16  app_status;
+	volatile u8 time;         //retransmit timeout in sec., TCP_TIME_OFF = none
+	volatile u8 error_count;
+	volatile u8 first_ack	:1;
+	volatile u8 rx_hold	:1;   //app can't take data, window stays closed
+	volatile u8 client	:1;   //we opened it (tcp_port_open)
+	volatile u8 iface;        //eth_if the connection runs over
+	volatile u8 tx_class;   //TX_CLASS_xxx for data segments, 0 = by size
+	TW_TIMER timer;
+	volatile u16 rx_window;   //window we advertised last..
+	volatile u32 rx_edge;     //..and its right edge, host order
+	volatile u16 tx_window;   //window the peer advertised last
+	//Send buffer - the app's data stays here until the peer has acked all of it
+	u8  *tx_buf;
+	u32 tx_flash;             //or flash address of the data if tx_buf is NULL
+	u16 tx_len;
+	u32 tx_seq;               //sequence number of tx_buf[0], host order..
+	u32 snd_una;              //..oldest unacked..
+	u32 snd_nxt;              //..and next to send
+	u32 recover;              //snd_nxt when fast recovery started
+	u8  dupacks;
+	u8  in_recovery	:1;
+	u8  tx_rexmit	:1;       //retransmit snd_una from tcp_poll
+	u16 persist_time;         //ms until the next zero window probe
+	TW_TIMER persist_timer;
+	u8  ka_probes;            //keepalive probes sent since the peer was last heard
+	TW_TIMER idle_timer;
+	TCP_OOO_SEG *ooo;         //received out of order, not yet delivered
+  
+  /* To copy the way the SDK does things with espconn,
+    we need separate ones per port/entry 
+    TODO: Would be better to malloc these... */
+  esp_tcp tcp_data;
+  struct espconn encconn;
+} tcp_table;
+
+typedef struct __attribute__((packed))
+{
+    u8 ip1[4];
+    volatile u8 no;
+    volatile u8 result;
+}PING_STRUCT;
+
+extern PING_STRUCT ping;
+
+//Token buckets for the responses we generate, refilled once a second
+#define ICMP_RATE   10  //echo replies + unreachables per sec.
+#define ICMP_BURST  20
+#define RST_RATE    10  //resets for closed ports per sec.
+#define RST_BURST   20
+
+typedef struct
+{
+	u8  tokens;
+	u32 last;
+}TOKEN_BUCKET;
+
+typedef struct
+{
+	u32 icmp_limited;   //echo requests/unreachables left unanswered by the limiter
+	u32 unreach_sent;   //port unreachables for closed UDP ports
+	u32 rst_sent;       //resets for closed TCP ports
+	u32 rst_limited;
+	u32 rx_frames;
+	u32 rx_yield;       //task runs that ran out of budget with frames left
+	u16 rx_ring_peak;   //highest ENC RX ring fill seen, bytes
+	//Frames dropped by the receive checks, by reason
+	u32 rx_drop_short;    //shorter than an IP header
+	u32 rx_drop_ip_hdr;   //not IPv4 or header length < 20
+	u32 rx_drop_ip_len;   //IP_Pktlen longer than the frame
+	u32 rx_drop_ip_cksum; //IP header checksum
+	u32 rx_drop_tcp_hdr;  //TCP data offset outside the datagram
+	u32 rx_drop_udp_hdr;  //UDP length outside the datagram
+	u32 rx_drop_icmp;     //ICMP shorter than its header
+	u32 rx_ip_options;    //headers with options, options stripped
+	u32 tcp_wnd_update;   //window updates sent after the receive window had closed
+	u32 tcp_wnd_probe;    //segments beyond our window (probes) answered, not taken
+	u32 tcp_persist;      //sends held back by the peer's zero window
+	u32 tcp_persist_probe;
+	u32 tcp_tx_acked;     //bytes of app data acked by peers
+	u32 tcp_fast_rexmit;  //retransmits on dup acks..
+	u32 tcp_partial_ack;  //..and on partial acks during recovery
+	u32 tcp_rto_rexmit;   //retransmits on timeout
+	u32 tcp_ka_probe;     //keepalive probes sent
+	u32 tcp_reaped;       //idle connections dropped after unanswered keepalives
+	u32 tcp_rx_ooo;       //segments queued behind a gap..
+	u32 tcp_rx_ooo_drop;  //..or dropped, queue full
+	u32 tcp_rx_ooo_fill;  //queued segments delivered once the gap was filled
+	u32 tcp_rx_dup;       //segments with nothing new in them
+	u32 tcp_rx_trim;      //segments with old data in front, trimmed
+	u32 tcp_dupack;       //immediate ACKs sent for gaps and duplicates
+	u32 tcp_connect;      //connects of ours that came up..
+	u32 tcp_connect_fail; //..and that were refused or timed out
+	u32 udp_rx_sock;      //datagrams delivered to UDP sockets..
+	u32 udp_tx_sock;      //..and sent from them
+	u32 udp_rx_mcast;     //of the delivered, to a joined multicast group
+	u32 igmp_report;      //IGMP membership reports sent
+	u32 tcp_tx_flash;     //bytes handed to stack_sendFlash
+	u32 link_up;          //link changes reported by the PHY
+	u32 link_down;
+	u32 tcp_link_abort;   //connections dropped with the link
+	#ifdef ETH_LOSS_TEST
+	u32 loss_rx;          //frames thrown away by the loss test
+	u32 loss_tx;
+	#endif
+}STACK_STATS;
+
+extern STACK_STATS stack_stats;
+
+#ifdef ETH_LOSS_TEST
+  #define ETH_LOSS_DROP()  ((os_random() % 100) < ETH_LOSS_TEST)
+#endif
+//----------------------------------------------------------------------------
+//Prototypes
+void stack_encInterrupt (void);
+void eth_if_use (u8 n);
+u8 eth_if_route (u32 dest_ip);
+void stack_updateIPs (void);
+void stack_linkUp (void);
+void stack_linkCheck (void);
+void stack_encConfigure (void);
+sint8 stack_register_tcp_accept(struct espconn *espconn, u8 stack_func);
+
+u16  htons(u16 val);
+u32 htons32(u32 val);
+u32 stack_init (void);
+void check_packet (void);
+u8 eth_get_data (void);
+void stack_selfTestStart (u16 frame_len, u16 frames);
+
+void new_eth_header (u8 *,u32);
+
+void arp_table_init (void);
+char arp_entry_search (u32);
+void arp_reply (void);
+void arp_entry_add (void);
+void arp_send_request (u32, volatile u8 *);
+void arp_probe_start (u32);
+u8 arp_probe_state (void);
+u32 arp_probe_ip (void);
+char arp_request (u32);
+
+void make_ip_header (u8 *,u32);
+void icmp_send (u32,u8,u8,u16,u16);
+void icmp_port_unreachable (void);
+void tcp_send_reset (void);
+u16 ICACHE_FLASH_ATTR checksum (u8 *pointer,u16 result16,u32 result32);
+
+void udp_socket_process(void);
+
+void tcp_entry_add (u8 *);
+void tcp_socket_process(void);
+char tcp_entry_search (u32 ,u16);
+void tcp_Port_close (u8);
+u8 tcp_port_open (u32, u16, u16);
+void tcp_index_del (u8);
+void create_new_tcp_packet(u16,u8);
+void create_new_udp_packet(	u16,u16,u16,u32);
+
+void find_and_start (u8 index);
+void tcp_entry_timer (u8 index, u8 time);
+void tcp_poll (void);
+s8 add_tcp_app (u16, void(*fp1)(u8, u8), struct espconn *espconn);
+void kill_tcp_app (u16 port);
+s8 add_udp_app (u16, void(*fp1)(u8, u8));
+void kill_udp_app (u16 port);
+void change_port_tcp_app (u16, u16);
+void pinging (void);
+
+#define ETHER_OFFSET			0x00
+#define ETHER_MACDEST			(ETHER_OFFSET)
+#define ETHER_MACSRC			(ETHER_MACDEST+6)
+#define ETHER_PKTYPE			(ETHER_MACSRC+6)
+
+#define ARP_OFFSET				0x0E
+#define ARP_HWTYPE        (ARP_OFFSET)
+#define ARP_PRTYPE		    (ARP_HWTYPE+2)
+#define ARP_HWLEN	        (ARP_PRTYPE+2)
+#define ARP_PRLEN         (ARP_HWLEN+1)
+#define ARP_OP            (ARP_PRLEN+1)
+#define ARP_SHADDR        (ARP_OP+2)
+#define ARP_SIPADDR       (ARP_SHADDR+6)
+#define ARP_THADDR        (ARP_SIPADDR+4)
+#define ARP_TIPADDR       (ARP_THADDR+6)
+
+#define IP_OFFSET				  0x0E
+#define IP_OFS_VER_LEN    (IP_OFFSET)
+#define IP_OFS_TOS        (IP_OFS_VER_LEN+1)
+#define IP_OFS_PKTLEN     (IP_OFS_TOS+1)
+#define IP_OFS_ID         (IP_OFS_PKTLEN+2)
+#define IP_OFS_FRAG_OFS   (IP_OFS_ID+2)
+#define IP_OFS_TTL        (IP_OFS_FRAG_OFS+2)
+#define IP_OFS_PROTO      (IP_OFS_TTL+1)
+#define IP_OFS_HDR_CHK    (IP_OFS_PROTO+1)
+#define IP_OFS_SRCADDR    (IP_OFS_HDR_CHK+2)
+#define IP_OFS_DESTADDR   (IP_OFS_SRCADDR+4)
+
+#define ICMP_OFFSET				0x22
+#define ICMP_OFS_TYPE     (ICMP_OFFSET)
+#define ICMP_OFS_CODE     (ICMP_OFS_TYPE+1)
+#define ICMP_OFS_CHKSUM   (ICMP_OFS_CODE+1)
+#define ICMP_OFS_ID       (ICMP_OFS_CHKSUM+2)
+#define ICMP_OFS_SEQNO    (ICMP_OFS_ID+2)
+
+#define ICMP_DATA				0x2A
+
+#define TCP_OFFSET				  0x22
+#define TCP_OFS_SCR_PORT    (TCP_OFFSET)
+#define TCP_OFS_DST_PORT    (TCP_OFS_SCR_PORT+2)
+#define TCP_OFS_SEQ_NUM     (TCP_OFS_DST_PORT+2)
+#define TCP_OFS_ACK_NUM     (TCP_OFS_SEQ_NUM+4)
+#define TCP_OFS_HDR_LEN     (TCP_OFS_ACK_NUM+4)
+#define TCP_OFS_HDR_FLAGS   (TCP_OFS_HDR_LEN+1)
+#define TCP_OFS_WINDOW      (TCP_OFS_HDR_FLAGS+1)
+#define TCP_OFS_CHKSUM      (TCP_OFS_WINDOW+2)
+#define TCP_OFS_URGENT_PTR  (TCP_OFS_CHKSUM+2)
+
+#define UDP_OFFSET				0x22
+
+extern arp_table arp_entry[MAX_ARP_ENTRY];
+extern tcp_table tcp_entry[MAX_TCP_ENTRY+1];
+
+//Data of ours not yet acked, in RAM or in flash
+#define tcp_tx_pending(index)  (tcp_entry[index].tx_buf != NULL || tcp_entry[index].tx_flash != 0)
+
+//IP Protocol Types
+#define	PROT_ICMP				0x01	//zeigt an die Nutzlasten enthalten das ICMP Prot
+#define	PROT_IGMP				0x02
+
+//IGMPv2 (RFC 2236), addresses in network order like everything else held as u32
+#define IGMP_LEN				8
+#define IGMP_QUERY				0x11
+#define IGMP_V2_REPORT			0x16
+#define IGMP_LEAVE				0x17
+#define IGMP_ALL_ROUTERS		0x020000E0UL	//224.0.0.2
+#define IP_MULTICAST(ip)		((((u32)(ip)) & 0xF0) == 0xE0)
+#define	PROT_TCP				0x06	//zeigt an die Nutzlasten enthalten das TCP Prot.
+#define	PROT_UDP				0x11	//zeigt an die Nutzlasten enthalten das UDP Prot.	
+
+//Defines fr IF Abfrage
+#define IF_MYIP 				(ip->IP_Destaddr==*((u32*)&eth_cur->myip[0]))
+#define IP_UDP_PACKET 			(ip->IP_Proto == PROT_UDP)
+#define IP_TCP_PACKET 			(ip->IP_Proto == PROT_TCP)
+#define IP_ICMP_PACKET 			(ip->IP_Proto == PROT_ICMP)
+
+//Defines fr if Abfrage
+#define ETHERNET_IP_DATAGRAMM	ethernet->EnetPacketType == 0x0008
+#define ETHERNET_ARP_DATAGRAMM 	ethernet->EnetPacketType == 0x0608
+
+#define IP_VERS_LEN 			20
+#define TCP_HDR_LEN 			20
+#define UDP_HDR_LEN				8
+#define ETH_HDR_LEN 			14
+#define TCP_DATA_START			(IP_VERS_LEN + TCP_HDR_LEN + ETH_HDR_LEN)
+#define UDP_DATA_START			(IP_VERS_LEN + UDP_HDR_LEN + ETH_HDR_LEN)
+
+//Frames are read into eth_buffer. With USE_IP_REASM it takes whole frames,
+//fragments come in complete, and a datagram of two full sized fragments
+//is handed on from here after reassembly
+#ifdef USE_IP_REASM
+  #define ETH_BUFFER_SIZE   (ETH_HDR_LEN + IP_VERS_LEN + 2 * (ETH_MAX_DATA - IP_VERS_LEN))
+#else
+  #define ETH_BUFFER_SIZE   MTU_SIZE
+#endif
+#define ETH_MAX_DATA        1500  //ethernet payload, IP header included
+
+extern u8 eth_buffer[ETH_BUFFER_SIZE+1];
+
+#define UDP_DATA_END_VAR        (ETH_HDR_LEN + ((eth_buffer[IP_PKTLEN]<<8)+eth_buffer[IP_PKTLEN+1]) - UDP_HDR_LEN + 8)
+
+#define	TCP_HDRFLAGS_FIX		0x2E
+#define TCP_DATA_START_VAR		(ETH_HDR_LEN + IP_VERS_LEN + ((eth_buffer[TCP_HDRFLAGS_FIX] & 0xF0) >>2))
+
+#define	IP_PKTLEN				0x10
+#define TCP_DATA_END_VAR 		(ETH_HDR_LEN + ((eth_buffer[IP_PKTLEN]<<8)+eth_buffer[IP_PKTLEN+1]))
+
+//TCP Flags
+#define  FIN_FLAG				0x01	//Datenbertragung beendet (finished)
+#define  SYN_FLAG				0x02	//Verbindungs aufbauen (synchronize)
+#define  RST_FLAG				0x04	//Verbindung neu initialisieren (reset)
+#define  PSH_FLAG				0x08	//Datenbergabe an Anwendung beschleunigen (push)
+#define  ACK_FLAG				0x10	//Datenbertragung besttigen (acknowledged)
+
+//----------------------------------------------------------------------------
+//Aufbau eines Ethernetheader
+//
+//
+//
+//
+typedef struct __attribute__((packed)) {
+	u8 EnetPacketDest[6];	//MAC Zieladresse 6 Byte
+	u8 EnetPacketSrc[6];	//MAC Quelladresse 6 Byte
+	u16 EnetPacketType;		//Nutzlast 0x0800=IP Datagramm;0x0806 = ARP
+} Ethernet_Header;
+
+//----------------------------------------------------------------------------
+//Aufbau eines ARP Header
+//	
+//	2 BYTE Hardware Typ				|	2 BYTE Protokoll Typ	
+//	1 BYTE Lnge Hardwareadresse	|	1 BYTE Lnge Protokolladresse
+//	2 BYTE Operation
+//	6 BYTE MAC Adresse Absender		|	4 BYTE IP Adresse Absender
+//	6 BYTE MAC Adresse Empfnger	|	4 BYTE IP Adresse Empfnger	
+typedef struct __attribute__((packed)) {
+		u16 ARP_HWType;		//Hardware Typ enthlt den Code fr Ethernet oder andere Link Layer
+		u16 ARP_PRType;		//Protokoll Typ enthlt den Code fr IP o. anderes bertragungsprotokoll
+		u8 ARP_HWLen;		//Lnge der Hardwareadresse enthlt 6 fr 6 Byte lange MAC Adressen
+		u8 ARP_PRLen;		//Lnge der Protocolladresse enthlt 4 fr 4 Byte lange IP Adressen
+		u16 ARP_Op;			//Enthlt Code der signalisiert ob es sich um eine Anfrage o. Antwort handelt
+		u8 ARP_SHAddr[6];	//Enthlt die MAC Adresse des Anfragenden  
+		u32 ARP_SIPAddr;    //Enthlt die IP Adresse des Absenders
+		u8 ARP_THAddr[6];	//MAC Adresse Ziel, ist in diesem Fall 6 * 00,da die Adresse erst noch herausgefunden werden soll (ARP Request)
+		u32 ARP_TIPAddr;    //IP Adresse enthlt die IP Adresse zu der die Kommunikation aufgebaut werden soll 
+} ARP_Header;
+
+//----------------------------------------------------------------------------
+//Aufbau eines IP Datagramms (B=BIT)
+//	
+//4B Version	|4B Headergr.	|8B Tos	|16B Gesamtlnge in Bytes	
+//16B Identifikation			|3B Schalter	|13B Fragmentierungsposition
+//8B Time to Live	|8B Protokoll	|16B Header Prfsumme 
+//32B IP Quelladresse
+//32B IB Zieladresse
+typedef struct __attribute__((packed)) {
+	u8	IP_Vers_Len;	//4 BIT Die Versionsnummer von IP, 
+									//meistens also 4 + 4Bit Headergre 	
+	u8	IP_Tos;			//Type of Service
+	u16	IP_Pktlen;		//16 Bit Komplette Lng des IP Datagrams in Bytes
+	u16	IP_Id;			//ID of the package for fragmentation 
+									//reassembling
+	u16	IP_Frag_Offset;	//wird benutzt um ein fragmentiertes 
+									//IP Packet wieder korrekt zusammenzusetzen
+	u8	IP_ttl;			//8 Bit Time to Live die lebenszeit eines Paket
+	u8	IP_Proto;		//Zeigt das hherschichtige Protokoll an 
+									//(TCP, UDP, ICMP)
+	u16	IP_Hdr_Cksum;	//Checksumme des IP Headers
+	u32	IP_Srcaddr;		//32 Bit IP Quelladresse
+	u32	IP_Destaddr;	//32 Bit IP Zieladresse
+} IP_Header;
+
+//----------------------------------------------------------------------------
+//Aufbau einer ICMP Nachricht
+//	
+//8 BIT Typ	|8 BIT Code	|16 BIT Prfsumme	
+//Je nach Typ			|Nachricht unterschiedlich
+//Testdaten
+//
+//8 BIT Typ = 0 Echo Reply oder 8 Echo request	
+typedef struct __attribute__((packed)) {
+		u8     	ICMP_Type;		//8 bit typ identifiziert Aufgabe der Nachricht 
+											//0 = Echo Reply 8 = Echo Request
+		u8     	ICMP_Code;		//8 Bit Code enthlt Detailangaben zu bestimmten Typen
+		u16     	ICMP_Cksum;		//16 Bit Prfsumme enthlt die CRC Prfsumme
+		u16     	ICMP_Id;		//2 byte Identifizierung
+		u16     	ICMP_SeqNum;	//Sequenznummer
+} ICMP_Header;
+
+
+//----------------------------------------------------------------------------
+//TCP Header Layout
+//
+//
+typedef struct __attribute__((packed)) {
+	u16 	TCP_SrcPort;	//der Quellport fr die Verbindung (Socket)
+	u16 	TCP_DestPort;	//der Zielport fr die Verbindung (Socket)
+	u32	TCP_Seqnum;	//numerierter Bytestrom
+	u32	TCP_Acknum;	//numerierter Bytestrom (Gegenrichtung)
+	u8  TCP_Hdrlen;
+	u8 	TCP_HdrFlags;//4Bit Lnge des Headers in 32 Bit schritten rest Flags
+	u16	TCP_Window;	//Fenstergre max. 64K Byte
+	u16	TCP_Chksum;	//Enthlt eine Prfsumme ber Header und Datenbereich
+	u16	TCP_UrgentPtr;	//16 Bit fr dringende bertragung
+} TCP_Header;
+
+//----------------------------------------------------------------------------
+//UDP Header Layout
+//
+//
+typedef struct __attribute__((packed)) {
+	u16 	udp_SrcPort;	//der Quellport fr die Verbindung (Socket)
+	u16 	udp_DestPort;	//der Zielport fr die Verbindung (Socket)
+	u16   udp_Hdrlen;
+	u16	udp_Chksum;	//Enthlt eine Prfsumme ber Header und Datenbereich
+} UDP_Header;
+
+/* HTTDP specific functions */
+void ICACHE_FLASH_ATTR serveHTTPD (u8 index, u8 port_index);
+sint8 ICACHE_FLASH_ATTR stack_sendData(struct espconn *conn, uint8_t *dataIn, u16 data_length);
+struct esp_enc_iovec;  //esp_enc_api.h
+sint8 ICACHE_FLASH_ATTR stack_sendv(struct espconn *conn, const struct esp_enc_iovec *iov, u8 iovcnt);
+sint8 ICACHE_FLASH_ATTR stack_sendFlash(struct espconn *conn, u32 flash_addr, u16 data_length);
+sint8 ICACHE_FLASH_ATTR stack_setTxClass(struct espconn *conn, u8 tx_class);
+sint8 ICACHE_FLASH_ATTR stack_recvHold(struct espconn *conn, u8 hold);
+sint8 ICACHE_FLASH_ATTR stack_connect(struct espconn *conn);
+sint8 ICACHE_FLASH_ATTR stack_connAlive(struct espconn *conn);
+sint8 ICACHE_FLASH_ATTR stack_connAbort(struct espconn *conn);
+sint8 ICACHE_FLASH_ATTR stack_setIdlePolicy(u16 port, u16 idle_time, u8 keepalive_intvl, u8 keepalive_cnt);
+void ICACHE_FLASH_ATTR stack_startEthTask (void);
+
+/* UDP sockets */
+void ICACHE_FLASH_ATTR serveUDP (u8 index, u8 port_index);
+sint8 ICACHE_FLASH_ATTR stack_udpCreate(struct espconn *conn);
+sint8 ICACHE_FLASH_ATTR stack_udpDelete(struct espconn *conn);
+sint8 ICACHE_FLASH_ATTR stack_udpSendTo(struct espconn *conn, u8 *dataIn, u16 data_length);
+sint8 ICACHE_FLASH_ATTR stack_igmpJoin(u32 group);
+sint8 ICACHE_FLASH_ATTR stack_igmpLeave(u32 group);
+sint8 ICACHE_FLASH_ATTR stack_connDisconnect(struct espconn *conn);
+
+
+#endif // #define _STACK_H
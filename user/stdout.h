@@ -1,6 +1,6 @@
-#ifndef STDOUT_H
-#define STDOUT_H
-
-void stdoutInit();
-
+#ifndef STDOUT_H
+#define STDOUT_H
+
+void stdoutInit();
+
 #endif
\ No newline at end of file
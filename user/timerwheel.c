@@ -0,0 +1,284 @@
+/*-----------------------------------------------------------------------------------------
+Description:    Hierarchical timer wheel for the enc28j60 stack timers
+
+-----------------------------------------------------------------------------------------
+License:
+  This program is free software; you can redistribute it and/or modify it under
+  the terms of the GNU General Public License as published by the Free Software
+  Foundation; either version 2 of the License, or (at your option) any later
+  version.
+  This program is distributed in the hope that it will be useful, but
+
+  WITHOUT ANY WARRANTY;
+
+  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 51
+  Franklin St, Fifth Floor, Boston, MA 02110, USA
+
+  http://www.gnu.de/gpl-ger.html
+-----------------------------------------------------------------------------------------*/
+#include "esp8266.h"
+#include "globals.h"
+#include "timerwheel.h"
+
+static TW_TIMER *tw_l0[TW_L0_SIZE];
+static TW_TIMER *tw_l1[TW_LN_SIZE];
+static TW_TIMER *tw_l2[TW_LN_SIZE];
+static u32 tw_l0_map[TW_L0_SIZE / 32];  //non-empty level 0 slots
+
+static u32 tw_clock;      //ticks elapsed up to tw_last_us
+static u32 tw_last_us;
+static u32 tw_base;       //next tick to run
+static u32 tw_wake;       //tick the SDK timer is armed for
+static u8  tw_wake_armed;
+static u8  tw_running;
+static u16 tw_count;      //armed timers
+static ETSTimer twTimer;
+
+static void twTimerCb (void *arg);
+
+//----------------------------------------------------------------------------
+//Current tick
+u32 ICACHE_FLASH_ATTR tw_now (void)
+{
+  return tw_clock + (system_get_time() - tw_last_us) / 1000;
+}
+
+//----------------------------------------------------------------------------
+//Sorts a timer into the level its expiry falls in, relative to tw_base
+static void ICACHE_FLASH_ATTR tw_insert (TW_TIMER *timer)
+{
+  u32 idx = timer->expires - tw_base;
+  TW_TIMER **slot;
+
+  if ((s32)idx < 0)
+  {
+    //Already due - run with the next tick
+    slot = &tw_l0[tw_base & (TW_L0_SIZE - 1)];
+    tw_l0_map[(tw_base & (TW_L0_SIZE - 1)) >> 5] |= 1UL << (tw_base & 31);
+  }
+  else if (idx < TW_L0_SIZE)
+  {
+    slot = &tw_l0[timer->expires & (TW_L0_SIZE - 1)];
+    tw_l0_map[(timer->expires & (TW_L0_SIZE - 1)) >> 5] |= 1UL << (timer->expires & 31);
+  }
+  else if (idx < (1UL << (TW_L0_BITS + TW_LN_BITS)))
+  {
+    slot = &tw_l1[(timer->expires >> TW_L0_BITS) & (TW_LN_SIZE - 1)];
+  }
+  else if (idx < TW_MAX_SPAN)
+  {
+    slot = &tw_l2[(timer->expires >> (TW_L0_BITS + TW_LN_BITS)) & (TW_LN_SIZE - 1)];
+  }
+  else
+  {
+    //Too far out - park it in the last level 2 slot, it gets re-sorted from there
+    slot = &tw_l2[((tw_base + TW_MAX_SPAN - 1) >> (TW_L0_BITS + TW_LN_BITS)) & (TW_LN_SIZE - 1)];
+  }
+
+  timer->next  = *slot;
+  timer->pprev = slot;
+  if (*slot) (*slot)->pprev = &timer->next;
+  *slot = timer;
+}
+
+static void ICACHE_FLASH_ATTR tw_unlink (TW_TIMER *timer)
+{
+  *timer->pprev = timer->next;
+  if (timer->next) timer->next->pprev = timer->pprev;
+  timer->next  = NULL;
+  timer->pprev = NULL;
+}
+
+//----------------------------------------------------------------------------
+//Moves one slot of a higher level down, returns the slot index
+static u8 ICACHE_FLASH_ATTR tw_cascade (TW_TIMER **level, u8 index)
+{
+  TW_TIMER *timer = level[index];
+
+  level[index] = NULL;
+  while (timer)
+  {
+    TW_TIMER *next = timer->next;
+    tw_insert(timer);
+    timer = next;
+  }
+  return index;
+}
+
+//----------------------------------------------------------------------------
+//Arms the SDK timer for the given tick
+static void ICACHE_FLASH_ATTR tw_schedule (u32 tick)
+{
+  s32 wait = (s32)(tick - tw_now());
+
+  if (wait < 1) wait = 1;
+  os_timer_disarm(&twTimer);
+  os_timer_setfn(&twTimer, twTimerCb, NULL);
+  os_timer_arm(&twTimer, wait, 0);
+  tw_wake       = tick;
+  tw_wake_armed = 1;
+}
+
+//----------------------------------------------------------------------------
+//First set level 0 slot from index on, TW_L0_SIZE if there is none
+static u16 ICACHE_FLASH_ATTR tw_l0_first (u16 index)
+{
+  for (; index < TW_L0_SIZE; index++)
+  {
+    if (tw_l0_map[index >> 5] == 0)
+    {
+      index += 31 - (index & 31);   //whole word empty, skip to the next one
+      continue;
+    }
+    if (tw_l0_map[index >> 5] & (1UL << (index & 31))) return index;
+  }
+  return TW_L0_SIZE;
+}
+
+//----------------------------------------------------------------------------
+//Whether the cascade at this tick (a level 0 turn) moves any timers down
+static u8 ICACHE_FLASH_ATTR tw_cascade_due (u32 tick)
+{
+  u8 index = (tick >> TW_L0_BITS) & (TW_LN_SIZE - 1);
+
+  return tw_l1[index] != NULL ||
+         (!index && tw_l2[(tick >> (TW_L0_BITS + TW_LN_BITS)) & (TW_LN_SIZE - 1)] != NULL);
+}
+
+//----------------------------------------------------------------------------
+//Next tick with something to do - a level 0 slot, or a cascade that moves
+//timers down. Empty cascades are passed over, so a wheel that only holds
+//timers further out sleeps until the first of them comes close
+static u32 ICACHE_FLASH_ATTR tw_next (void)
+{
+  u16 index = tw_l0_first(tw_base & (TW_L0_SIZE - 1));
+  u32 tick  = (tw_base + TW_L0_SIZE - 1) & ~(TW_L0_SIZE - 1UL);  //first cascade
+  u8  n;
+
+  //A cascade at tw_base itself runs before its level 0 slot
+  if (tick == tw_base && tw_cascade_due(tick)) return tick;
+  if (index < TW_L0_SIZE) return (tw_base & ~(TW_L0_SIZE - 1UL)) + index;
+
+  //One turn of level 1, level 0 slots below tw_base belong to the turn after
+  //the first cascade
+  for (n = 0; n < TW_LN_SIZE; n++, tick += TW_L0_SIZE)
+  {
+    if (tw_cascade_due(tick)) return tick;
+    if (n == 0 && (index = tw_l0_first(0)) < TW_L0_SIZE) return tick + index;
+  }
+
+  //Level 1 is empty, only the other level 2 cascades are left
+  tick = (tick + TW_L1_SPAN - 1) & ~(TW_L1_SPAN - 1);
+  for (n = 1; n < TW_LN_SIZE; n++, tick += TW_L1_SPAN)
+  {
+    if (tw_cascade_due(tick)) return tick;
+  }
+  return tick;
+}
+
+//----------------------------------------------------------------------------
+//Brings tw_clock up to date
+static void ICACHE_FLASH_ATTR tw_sync (void)
+{
+  u32 ticks = (system_get_time() - tw_last_us) / 1000;
+
+  tw_clock   += ticks;
+  tw_last_us += ticks * 1000;
+}
+
+//----------------------------------------------------------------------------
+//Runs every tick that has passed, then sleeps until the next one due. Ticks
+//with nothing to do are skipped, so a run stays short after a long sleep
+static void ICACHE_FLASH_ATTR twTimerCb (void *arg)
+{
+  tw_sync();
+  tw_wake_armed = 0;
+  tw_running    = 1;
+
+  while (tw_count && (s32)(tw_clock - tw_base) >= 0)
+  {
+    u32 next = tw_next();
+    u8  index;
+    TW_TIMER *timer;
+
+    if ((s32)(next - tw_clock) > 0)
+    {
+      tw_base = tw_clock + 1;
+      break;
+    }
+    tw_base = next;
+    index   = tw_base & (TW_L0_SIZE - 1);
+
+    if (!index &&
+        !tw_cascade(tw_l1, (tw_base >> TW_L0_BITS) & (TW_LN_SIZE - 1)))
+    {
+      tw_cascade(tw_l2, (tw_base >> (TW_L0_BITS + TW_LN_BITS)) & (TW_LN_SIZE - 1));
+    }
+    tw_base++;
+
+    //Callbacks may re-arm, that always lands in a later slot
+    while ((timer = tw_l0[index]) != NULL)
+    {
+      tw_unlink(timer);
+      tw_count--;
+      if (timer->fn) timer->fn(timer->arg);
+    }
+    tw_l0_map[index >> 5] &= ~(1UL << (index & 31));
+  }
+
+  tw_running = 0;
+  if (tw_count) tw_schedule(tw_next());
+}
+
+//----------------------------------------------------------------------------
+//(Re)arms a timer to call fn(arg) in ms milliseconds. fn may be NULL for
+//timers that are only polled with tw_active()
+void ICACHE_FLASH_ATTR tw_arm (TW_TIMER *timer, u32 ms, tw_func_t fn, void *arg)
+{
+  u32 next;
+
+  if (tw_active(timer))
+  {
+    tw_unlink(timer);
+    tw_count--;
+  }
+  if (tw_count == 0 && !tw_running)
+  {
+    //Wheel is empty, skip the idle ticks instead of running them
+    tw_sync();
+    tw_base = tw_clock;
+    os_memset(tw_l0_map, 0, sizeof(tw_l0_map));
+  }
+  timer->fn      = fn;
+  timer->arg     = arg;
+  timer->expires = tw_now() + ms;
+  tw_insert(timer);
+  tw_count++;
+
+  if (!tw_running)
+  {
+    next = tw_next();
+    if (!tw_wake_armed || (s32)(next - tw_wake) < 0) tw_schedule(next);
+  }
+}
+
+//----------------------------------------------------------------------------
+void ICACHE_FLASH_ATTR tw_cancel (TW_TIMER *timer)
+{
+  if (tw_active(timer))
+  {
+    tw_unlink(timer);
+    tw_count--;
+  }
+}
+
+//----------------------------------------------------------------------------
+void ICACHE_FLASH_ATTR tw_init (void)
+{
+  os_timer_disarm(&twTimer);
+  tw_last_us = system_get_time();
+}
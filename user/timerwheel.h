@@ -0,0 +1,57 @@
+/*-----------------------------------------------------------------------------------------
+Description:    Hierarchical timer wheel for the enc28j60 stack timers
+
+  1ms ticks. Level 0 holds the next 256ms one slot per tick, level 1 the next
+  16s in 256ms slots, level 2 the next 17min in 16s slots - timers further
+  out are parked in level 2 and re-sorted as it turns. Arming and cancelling
+  are O(1), the SDK timer behind it is only armed for the next due slot.
+
+-----------------------------------------------------------------------------------------
+License:
+  This program is free software; you can redistribute it and/or modify it under
+  the terms of the GNU General Public License as published by the Free Software
+  Foundation; either version 2 of the License, or (at your option) any later
+  version.
+  This program is distributed in the hope that it will be useful, but
+
+  WITHOUT ANY WARRANTY;
+
+  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 51
+  Franklin St, Fifth Floor, Boston, MA 02110, USA
+
+  http://www.gnu.de/gpl-ger.html
+-----------------------------------------------------------------------------------------*/
+#ifndef _TIMERWHEEL_H
+  #define _TIMERWHEEL_H
+  #include "globals.h"
+
+  #define TW_L0_BITS    8
+  #define TW_LN_BITS    6
+  #define TW_L0_SIZE    (1 << TW_L0_BITS)
+  #define TW_LN_SIZE    (1 << TW_LN_BITS)
+  #define TW_L1_SPAN    (1UL << (TW_L0_BITS + TW_LN_BITS))      //ticks levels 0-1 cover
+  #define TW_MAX_SPAN   (1UL << (TW_L0_BITS + 2 * TW_LN_BITS))  //ticks levels 0-2 cover
+
+  typedef void (*tw_func_t)(void *arg);
+
+  typedef struct tw_timer
+  {
+    struct tw_timer  *next;
+    struct tw_timer **pprev;  //NULL while not armed
+    u32       expires;        //tick
+    tw_func_t fn;             //may be NULL, see tw_active()
+    void     *arg;
+  } TW_TIMER;
+
+  void tw_init   (void);
+  void tw_arm    (TW_TIMER *timer, u32 ms, tw_func_t fn, void *arg);
+  void tw_cancel (TW_TIMER *timer);
+  u32  tw_now    (void);
+
+  #define tw_active(timer)  ((timer)->pprev != NULL)
+
+#endif //_TIMERWHEEL_H
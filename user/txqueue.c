@@ -0,0 +1,312 @@
+/*-----------------------------------------------------------------------------------------
+Description:    Prioritised transmit queue in front of the enc28j60 driver
+
+-----------------------------------------------------------------------------------------
+License:
+  This program is free software; you can redistribute it and/or modify it under
+  the terms of the GNU General Public License as published by the Free Software
+  Foundation; either version 2 of the License, or (at your option) any later
+  version.
+  This program is distributed in the hope that it will be useful, but
+
+  WITHOUT ANY WARRANTY;
+
+  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 51
+  Franklin St, Fifth Floor, Boston, MA 02110, USA
+
+  http://www.gnu.de/gpl-ger.html
+-----------------------------------------------------------------------------------------*/
+#include "esp8266.h"
+#include "globals.h"
+#include "enc28j60.h"
+#include "stack.h"
+#include "txqueue.h"
+
+typedef struct
+{
+  u8  *buf;       //depth * slot_len bytes
+  u16 *len;
+  u8  *dev;       //ENC each frame was built for
+  u16 slot_len;
+  u8  depth;
+  u8  head;
+  u8  count;
+} tx_queue_table;
+
+static u8  txq_control_buf[TXQ_CONTROL_DEPTH][TXQ_CONTROL_LEN];
+static u8  txq_interactive_buf[TXQ_INTERACTIVE_DEPTH][MTU_SIZE];
+static u8  txq_bulk_buf[TXQ_BULK_DEPTH][MTU_SIZE];
+static u16 txq_control_len[TXQ_CONTROL_DEPTH];
+static u16 txq_interactive_len[TXQ_INTERACTIVE_DEPTH];
+static u16 txq_bulk_len[TXQ_BULK_DEPTH];
+static u8  txq_control_dev[TXQ_CONTROL_DEPTH];
+static u8  txq_interactive_dev[TXQ_INTERACTIVE_DEPTH];
+static u8  txq_bulk_dev[TXQ_BULK_DEPTH];
+
+static tx_queue_table tx_queue[TX_CLASSES] =
+{
+  { &txq_control_buf[0][0],     txq_control_len,     txq_control_dev,     TXQ_CONTROL_LEN, TXQ_CONTROL_DEPTH,     0, 0 },
+  { &txq_interactive_buf[0][0], txq_interactive_len, txq_interactive_dev, MTU_SIZE,        TXQ_INTERACTIVE_DEPTH, 0, 0 },
+  { &txq_bulk_buf[0][0],        txq_bulk_len,        txq_bulk_dev,        MTU_SIZE,        TXQ_BULK_DEPTH,        0, 0 },
+};
+
+static ETSTimer txQueueTimer;
+txQueueStats tx_queue_stats;
+
+//----------------------------------------------------------------------------
+//Works out the class of a finished frame. The hint from the connection only
+//applies to data, handshakes and pure ACKs always go as control
+static u8 ICACHE_FLASH_ATTR tx_classify (u16 len, u8 *buf, u8 hint)
+{
+  Ethernet_Header *ethernet = (Ethernet_Header *)&buf[ETHER_OFFSET];
+  IP_Header       *ip       = (IP_Header       *)&buf[IP_OFFSET];
+  TCP_Header      *tcp      = (TCP_Header      *)&buf[TCP_OFFSET];
+  UDP_Header      *udp      = (UDP_Header      *)&buf[UDP_OFFSET];
+  u16 data_len;
+
+  if (ethernet->EnetPacketType != HTONS(0x0800)) return TX_CLASS_CONTROL;  //ARP
+
+  switch (ip->IP_Proto)
+  {
+    case PROT_ICMP:
+      return TX_CLASS_CONTROL;
+    case PROT_UDP:
+      if (udp->udp_DestPort == HTONS(67) || udp->udp_DestPort == HTONS(68)) return TX_CLASS_CONTROL;
+      return (hint != TX_CLASS_AUTO) ? hint : TX_CLASS_INTERACTIVE;
+    case PROT_TCP:
+      data_len = htons(ip->IP_Pktlen) - ((ip->IP_Vers_Len & 0x0F) << 2) - ((tcp->TCP_Hdrlen & 0xF0) >> 2);
+      if ((tcp->TCP_HdrFlags & (SYN_FLAG | FIN_FLAG | RST_FLAG)) || data_len == 0) return TX_CLASS_CONTROL;
+      if (hint != TX_CLASS_AUTO) return hint;
+      return (data_len <= TXQ_SMALL_LEN) ? TX_CLASS_INTERACTIVE : TX_CLASS_BULK;
+  }
+  return TX_CLASS_BULK;
+}
+
+//----------------------------------------------------------------------------
+//Frames of one connection must not overtake each other, a short tail segment
+//or the FIN would go out ahead of the bulk data queued before it. Returns the
+//lowest class that still holds a frame of the same flow, c if there is none.
+//That way a flow's frames are queued in falling classes and leave in order
+static u8 ICACHE_FLASH_ATTR tx_flow_class (u8 *buf, u8 c)
+{
+  Ethernet_Header *ethernet = (Ethernet_Header *)&buf[ETHER_OFFSET];
+  IP_Header       *ip       = (IP_Header       *)&buf[IP_OFFSET];
+  TCP_Header      *tcp      = (TCP_Header      *)&buf[TCP_OFFSET];
+
+  if (ethernet->EnetPacketType != HTONS(0x0800)) return c;
+  if (ip->IP_Proto != PROT_TCP && ip->IP_Proto != PROT_UDP) return c;
+
+  for (u8 lc = TX_CLASSES - 1; lc > c; lc--)
+  {
+    tx_queue_table *q = &tx_queue[lc];
+
+    for (u8 i = 0; i < q->count; i++)
+    {
+      u8 slot = (q->head + i) % q->depth;
+      u8 *frame = &q->buf[slot * q->slot_len];
+      IP_Header  *fip  = (IP_Header  *)&frame[IP_OFFSET];
+      TCP_Header *ftcp = (TCP_Header *)&frame[TCP_OFFSET];  //UDP has its ports in the same place
+
+      if (q->dev[slot] == ETH_DEVICE() &&
+          ((Ethernet_Header *)&frame[ETHER_OFFSET])->EnetPacketType == HTONS(0x0800) &&
+          fip->IP_Proto == ip->IP_Proto && fip->IP_Destaddr == ip->IP_Destaddr &&
+          ftcp->TCP_SrcPort == tcp->TCP_SrcPort && ftcp->TCP_DestPort == tcp->TCP_DestPort)
+      {
+        return lc;
+      }
+    }
+  }
+  return c;
+}
+
+//----------------------------------------------------------------------------
+//Hands the oldest frame of the highest non-empty class to the driver of the
+//ENC it was built for. The driver waits for the previous frame itself if the
+//ENC is still busy
+static u8 ICACHE_FLASH_ATTR tx_queue_pop (void)
+{
+  u8 cur = ETH_DEVICE();
+
+  for (u8 c = 0; c < TX_CLASSES; c++)
+  {
+    tx_queue_table *q = &tx_queue[c];
+
+    if (q->count)
+    {
+      ETH_USE(q->dev[q->head]);
+      ETH_PACKET_SEND(q->len[q->head], &q->buf[q->head * q->slot_len]);
+      ETH_USE(cur);
+      q->head = (q->head + 1) % q->depth;
+      q->count--;
+      tx_queue_stats.sent[c]++;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static u8 ICACHE_FLASH_ATTR tx_queue_pending (void)
+{
+  return tx_queue[0].count || tx_queue[1].count || tx_queue[2].count;
+}
+
+//Is the ENC the next frame goes to still transmitting?
+static u8 ICACHE_FLASH_ATTR tx_queue_next_busy (void)
+{
+  u8 cur = ETH_DEVICE();
+  u8 busy;
+
+  for (u8 c = 0; c < TX_CLASSES; c++)
+  {
+    tx_queue_table *q = &tx_queue[c];
+
+    if (q->count)
+    {
+      ETH_USE(q->dev[q->head]);
+      busy = ETH_TX_BUSY();
+      ETH_USE(cur);
+      return busy;
+    }
+  }
+  return 0;
+}
+
+static void ICACHE_FLASH_ATTR txQueueTimerCb (void *arg)
+{
+  tx_queue_run();
+}
+
+//----------------------------------------------------------------------------
+//Sends whatever the ENC will take right now, comes back for the rest
+void ICACHE_FLASH_ATTR tx_queue_run (void)
+{
+  os_timer_disarm(&txQueueTimer);
+
+  while (tx_queue_pending() && !tx_queue_next_busy())
+  {
+    tx_queue_pop();
+  }
+  if (tx_queue_pending())
+  {
+    os_timer_setfn(&txQueueTimer, txQueueTimerCb, NULL);
+    os_timer_arm(&txQueueTimer, 1, 0);
+  }
+}
+
+//----------------------------------------------------------------------------
+//Reads len bytes of mapped flash into a queue slot
+static void ICACHE_FLASH_ATTR tx_flash_copy (u8 *dst, u32 addr, u16 len)
+{
+  u32 word  = FLASH_WORD(addr);
+  u8  shift = (addr & 3) << 3;
+
+  while (len--)
+  {
+    *dst++ = word >> shift;
+    addr++;
+    shift += 8;
+    if (shift == 32 && len)
+    {
+      word  = FLASH_WORD(addr);
+      shift = 0;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+//Hands a frame in up to two pieces to the driver
+static void ICACHE_FLASH_ATTR tx_queue_direct (u16 len, u8 *buf, u16 data_len, const u8 *data, u32 flash_addr)
+{
+  if (data && data_len) ETH_PACKET_SEND_V(len, buf, data_len, data);
+  else if (data_len)    ETH_PACKET_SEND_FLASH(len, buf, data_len, flash_addr);
+  else                  ETH_PACKET_SEND(len, buf);
+}
+
+//----------------------------------------------------------------------------
+//Sends a frame, or queues a copy of it if the ENC is still transmitting -
+//either way buf is free again on return. The payload follows the headers in
+//buf (data_len 0), is in data, or if data is NULL in flash at flash_addr
+static void ICACHE_FLASH_ATTR tx_queue_put (u16 len, u8 *buf, u16 data_len, const u8 *data, u32 flash_addr, u8 tx_class)
+{
+  tx_queue_table *q;
+  u8 *slot;
+  u8 c;
+
+  #ifdef ETH_LOSS_TEST
+    if (ETH_LOSS_DROP())
+    {
+      stack_stats.loss_tx++;
+      return;
+    }
+  #endif
+
+  tx_class = tx_classify(len, buf, tx_class);
+  if (tx_class == TX_CLASS_CONTROL && len + data_len > TXQ_CONTROL_LEN) tx_class = TX_CLASS_INTERACTIVE;
+  c = tx_class - 1;
+
+  //Idle and nothing waiting - straight out
+  if (!tx_queue_pending() && !ETH_TX_BUSY())
+  {
+    tx_queue_direct(len, buf, data_len, data, flash_addr);
+    tx_queue_stats.sent[c]++;
+    return;
+  }
+
+  //Behind the frames of the same connection still waiting
+  c = tx_flow_class(buf, c);
+
+  //Too big for a slot - flush the queue and send it in order
+  q = &tx_queue[c];
+  if (len + data_len > q->slot_len)
+  {
+    while (tx_queue_pop());
+    tx_queue_direct(len, buf, data_len, data, flash_addr);
+    tx_queue_stats.sent[c]++;
+    return;
+  }
+
+  //No room - wait for the ENC, frames of a higher class go first
+  while (q->count >= q->depth)
+  {
+    tx_queue_stats.blocked[c]++;
+    tx_queue_pop();
+  }
+
+  slot = &q->buf[((q->head + q->count) % q->depth) * q->slot_len];
+  os_memcpy(slot, buf, len);
+  if (data && data_len) os_memcpy(&slot[len], data, data_len);
+  else if (data_len)    tx_flash_copy(&slot[len], flash_addr, data_len);
+  q->len[(q->head + q->count) % q->depth] = len + data_len;
+  q->dev[(q->head + q->count) % q->depth] = ETH_DEVICE();
+  q->count++;
+  tx_queue_stats.queued[c]++;
+  if (q->count > tx_queue_stats.depth_peak[c]) tx_queue_stats.depth_peak[c] = q->count;
+
+  tx_queue_run();
+}
+
+//----------------------------------------------------------------------------
+void ICACHE_FLASH_ATTR tx_queue_send (u16 len, u8 *buf, u8 tx_class)
+{
+  tx_queue_put(len, buf, 0, NULL, 0, tx_class);
+}
+
+//----------------------------------------------------------------------------
+//Headers in buf and the payload in data - sent straight out they go to the
+//ENC without being put together first
+void ICACHE_FLASH_ATTR tx_queue_send_v (u16 len, u8 *buf, u16 data_len, const u8 *data, u8 tx_class)
+{
+  tx_queue_put(len, buf, data_len, data, 0, tx_class);
+}
+
+//----------------------------------------------------------------------------
+//Same with the payload in flash, only a frame that has to wait for the ENC
+//is ever read into RAM
+void ICACHE_FLASH_ATTR tx_queue_send_flash (u16 len, u8 *buf, u16 data_len, u32 flash_addr, u8 tx_class)
+{
+  tx_queue_put(len, buf, data_len, NULL, flash_addr, tx_class);
+}
@@ -0,0 +1,66 @@
+/*-----------------------------------------------------------------------------------------
+Description:    Prioritised transmit queue in front of the enc28j60 driver
+
+  Frames go straight to the ENC when it is idle. While it is still busy with
+  the previous frame they are queued by class, and handed to the driver
+  highest class first as soon as the transmitter frees up. Frames of one
+  connection keep their order, a frame never goes ahead of one of its own
+  connection queued in a lower class. The queue is shared by the ENCs, a
+  frame goes out of the one that was current when it was sent.
+
+-----------------------------------------------------------------------------------------
+License:
+  This program is free software; you can redistribute it and/or modify it under
+  the terms of the GNU General Public License as published by the Free Software
+  Foundation; either version 2 of the License, or (at your option) any later
+  version.
+  This program is distributed in the hope that it will be useful, but
+
+  WITHOUT ANY WARRANTY;
+
+  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE. See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along with
+  this program; if not, write to the Free Software Foundation, Inc., 51
+  Franklin St, Fifth Floor, Boston, MA 02110, USA
+
+  http://www.gnu.de/gpl-ger.html
+-----------------------------------------------------------------------------------------*/
+#ifndef _TXQUEUE_H
+  #define _TXQUEUE_H
+  #include "globals.h"
+  #include "stack.h"
+
+  //Transmit classes, highest priority first. AUTO lets the frame decide
+  #define TX_CLASS_AUTO         0
+  #define TX_CLASS_CONTROL      1   //ARP, ICMP, DHCP, pure ACK, SYN/FIN/RST
+  #define TX_CLASS_INTERACTIVE  2   //small segments, UDP, websockets
+  #define TX_CLASS_BULK         3   //everything else
+  #define TX_CLASSES            3
+
+  //Queue depth per class, control frames are small so their slots are too
+  #define TXQ_CONTROL_DEPTH     4
+  #define TXQ_CONTROL_LEN       128
+  #define TXQ_INTERACTIVE_DEPTH 2
+  #define TXQ_BULK_DEPTH        1
+  #define TXQ_SMALL_LEN         256 //TCP payload up to this counts as interactive
+
+  typedef struct
+  {
+    u32 sent[TX_CLASSES];       //frames handed to the driver
+    u32 queued[TX_CLASSES];     //of which had to wait for the ENC
+    u32 blocked[TX_CLASSES];    //queue was full, sender waited for the ENC
+    u8  depth_peak[TX_CLASSES];
+  } txQueueStats;
+
+  extern txQueueStats tx_queue_stats;
+
+  void tx_queue_send       (u16 len, u8 *buf, u8 tx_class);
+  void tx_queue_send_v     (u16 len, u8 *buf, u16 data_len, const u8 *data, u8 tx_class);
+  void tx_queue_send_flash (u16 len, u8 *buf, u16 data_len, u32 flash_addr, u8 tx_class);
+  void tx_queue_run        (void);
+
+  #define TX_PACKET_SEND(len, buf)  tx_queue_send((len), (buf), TX_CLASS_AUTO)
+
+#endif //_TXQUEUE_H
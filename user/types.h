@@ -1,40 +1,40 @@
-#ifndef _TYPES_H
-  #define _TYPES_H
-	
-	#ifndef NULL
-		#define NULL      0
-	#endif
-
-  //#define FAIL      1
-  //#define PASS      0
-  
-  typedef unsigned char   u_char;
-  typedef unsigned char   Uchar;
-  typedef unsigned char   u8;
-  typedef unsigned char	  U8;
-  
-  typedef unsigned short  u_short;
-  typedef unsigned short  u16;
-  typedef unsigned short	U16;
-  
-  typedef unsigned int    u_int;
-  typedef unsigned int	  u32;
-  typedef unsigned int	  U32;
-  
-  typedef unsigned long   u_long;
-  //typedef unsigned long	  u64;
-  typedef unsigned long	  U64;  
-  
-  //typedef char			      s8;
-  typedef char			      S8;
-  
-  typedef short			      s16;
-  typedef short			      S16;
-  
-  typedef int				      s32;
-  typedef int				      S32;
-  
-  typedef long			      s64;
-  typedef long			      S64;
-
-#endif
+#ifndef _TYPES_H
+  #define _TYPES_H
+	
+	#ifndef NULL
+		#define NULL      0
+	#endif
+
+  //#define FAIL      1
+  //#define PASS      0
+  
+  typedef unsigned char   u_char;
+  typedef unsigned char   Uchar;
+  typedef unsigned char   u8;
+  typedef unsigned char	  U8;
+  
+  typedef unsigned short  u_short;
+  typedef unsigned short  u16;
+  typedef unsigned short	U16;
+  
+  typedef unsigned int    u_int;
+  typedef unsigned int	  u32;
+  typedef unsigned int	  U32;
+  
+  typedef unsigned long   u_long;
+  //typedef unsigned long	  u64;
+  typedef unsigned long	  U64;  
+  
+  //typedef char			      s8;
+  typedef char			      S8;
+  
+  typedef short			      s16;
+  typedef short			      S16;
+  
+  typedef int				      s32;
+  typedef int				      S32;
+  
+  typedef long			      s64;
+  typedef long			      S64;
+
+#endif